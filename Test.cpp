@@ -1,15 +1,36 @@
 #include "test.h"
 
+#include <algorithm>
+#include <array>
+#include <atomic>
 #include <cassert>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
 #include <iostream>
 #include <random>
+#include <sstream>
 #include <string>
+#include <thread>
 #include <vector>
 
+#include "document_store.h"
+#include "durable_search_server.h"
 #include "log_duration.h"
+#include "memory_stats.h"
+#include "metrics.h"
 #include "process_queries.h"
 #include "remove_duplicates.h"
+#include "request_queue.h"
+#include "request_statistics.h"
 #include "search_server.h"
+#include "sharded_search_server.h"
+#include "stop_word_filter.h"
+#include "string_processing.h"
+#include "thread_pool.h"
 
 using namespace std::string_literals;
 
@@ -307,6 +328,1490 @@ void TestParallelQueries() {
     ASSERT_HINT(documents_even_ids.size() == 2, "FindTopDocuments with execution::par has error");
 }
 
+void TestRemoveDocument() {
+    SearchServer search_server("and with"s);
+
+    search_server.AddDocument(3, "funny pet and nasty rat"s, DocumentStatus::kActual, {7, 2, 7});
+    search_server.AddDocument(1, "funny pet with curly hair"s, DocumentStatus::kActual, {1, 2});
+    search_server.AddDocument(2, "nasty rat with curly hair"s, DocumentStatus::kActual, {1, 2});
+
+    ASSERT_EQUAL(search_server.FindTopDocuments("curly rat"s).size(), 3u);
+
+    search_server.RemoveDocument(2);
+
+    const auto documents = search_server.FindTopDocuments("curly rat"s);
+    ASSERT_EQUAL(documents.size(), 2u);
+    ASSERT_HINT(std::none_of(documents.begin(), documents.end(),
+                             [](const Document& document) { return document.id == 2; }),
+                "Removed document should not be found");
+    ASSERT_EQUAL(search_server.GetDocumentCount(), 2);
+    ASSERT_HINT(search_server.GetWordFrequencies(2).empty(), "Removed document should have no words");
+
+    search_server.RemoveDocument(std::execution::par, 3);
+
+    const auto [words, status] = search_server.MatchDocument("curly rat"s, 1);
+    ASSERT_EQUAL(words.size(), 1u);
+    ASSERT_EQUAL(search_server.FindTopDocuments("rat"s).size(), 0u);
+}
+
+void TestParallelSearchMatchesSequential() {
+    const std::vector<std::string> dictionary = {"cat"s,   "dog"s,   "rat"s,   "pet"s,   "funny"s, "nasty"s,
+                                                 "curly"s, "hair"s,  "tail"s,  "eyes"s,  "white"s, "black"s,
+                                                 "big"s,   "small"s, "city"s,  "park"s,  "with"s,  "and"s};
+    std::mt19937 generator(42);
+    SearchServer search_server("and with"s);
+
+    for (int id = 0; id < 20000; ++id) {
+        std::string text;
+
+        for (int i = 0; i < 8; ++i) {
+            text += dictionary[generator() % dictionary.size()] + " "s;
+        }
+        text.pop_back();
+        search_server.AddDocument(id, text, DocumentStatus::kActual, {static_cast<int>(generator() % 10)});
+    }
+
+    for (int id = 0; id < 20000; id += 7) {
+        search_server.RemoveDocument(id);
+    }
+
+    for (const std::string& query : {"curly cat"s, "nasty rat -dog"s, "white black -big -small"s, "park city tail"s}) {
+        const auto sequential = search_server.FindTopDocuments(std::execution::seq, query,
+                                                               [](int, DocumentStatus, int) { return true; });
+        const auto parallel = search_server.FindTopDocuments(std::execution::par, query,
+                                                             [](int, DocumentStatus, int) { return true; });
+
+        ASSERT_EQUAL(sequential.size(), parallel.size());
+
+        for (size_t i = 0; i < sequential.size(); ++i) {
+            ASSERT_EQUAL_HINT(sequential[i].id, parallel[i].id, "Parallel search should rank like sequential search");
+            ASSERT_HINT(std::abs(sequential[i].relevance - parallel[i].relevance) < 1e-6,
+                        "Parallel search should rank like sequential search");
+        }
+    }
+}
+
+void TestTopDocumentCount() {
+    SearchServer search_server("and with"s);
+
+    for (int id = 0; id < 50; ++id) {
+        search_server.AddDocument(id, "curly cat number "s + std::to_string(id % 7), DocumentStatus::kActual, {id});
+    }
+
+    ASSERT_EQUAL(search_server.FindTopDocuments("curly cat"s).size(), SearchServer::kMaxResultDocumentCount);
+    ASSERT_EQUAL(search_server.FindTopDocuments("curly cat"s, DocumentStatus::kActual, 0).size(), 0u);
+
+    const auto all_documents = [](int, DocumentStatus, int) { return true; };
+
+    for (const size_t top_document_count : {1u, 10u, 50u, 100u}) {
+        const auto sequential =
+            search_server.FindTopDocuments(std::execution::seq, "curly cat"s, all_documents, top_document_count);
+        const auto parallel =
+            search_server.FindTopDocuments(std::execution::par, "curly cat"s, all_documents, top_document_count);
+
+        ASSERT_EQUAL(sequential.size(), std::min<size_t>(top_document_count, 50));
+        ASSERT_EQUAL(parallel.size(), sequential.size());
+
+        for (size_t i = 0; i < sequential.size(); ++i) {
+            ASSERT_EQUAL_HINT(sequential[i].id, 49 - static_cast<int>(i), "Equal relevance should rank by rating");
+            ASSERT_EQUAL(parallel[i].id, sequential[i].id);
+        }
+    }
+}
+
+void TestShardedSearchServer() {
+    SearchServer search_server("and with"s);
+    ShardedSearchServer sharded_search_server("and with"s, 3);
+
+    for (int id = 0; const std::string& text : {
+                         "funny pet and nasty rat"s,
+                         "funny pet with curly hair"s,
+                         "funny pet and not very nasty rat"s,
+                         "pet with rat and rat and rat"s,
+                         "nasty rat with curly hair"s,
+                         "white cat and yellow hat"s,
+                         "curly cat curly tail"s,
+                         "nasty dog with big eyes"s,
+                         "funny pet with curly hair"s,
+                     }) {
+        ++id;
+        search_server.AddDocument(id, text, DocumentStatus::kActual, {id % 3});
+        sharded_search_server.AddDocument(id, text, DocumentStatus::kActual, {id % 3});
+    }
+
+    ASSERT_EQUAL(sharded_search_server.GetDocumentCount(), search_server.GetDocumentCount());
+
+    const std::vector<std::string> queries = {"curly nasty cat"s, "funny pet -hair"s, "rat"s, "yellow -cat"s};
+
+    for (const std::string& query : queries) {
+        const auto expected = search_server.FindTopDocuments(query);
+        const auto sequential = sharded_search_server.FindTopDocuments(query);
+        const auto parallel = sharded_search_server.FindTopDocuments(
+            std::execution::par, query,
+            [](int, DocumentStatus status, int) { return status == DocumentStatus::kActual; });
+
+        ASSERT_EQUAL(sequential.size(), expected.size());
+        ASSERT_EQUAL(parallel.size(), expected.size());
+
+        for (size_t i = 0; i < expected.size(); ++i) {
+            ASSERT_EQUAL_HINT(sequential[i].id, expected[i].id, "Sharding should not change ranking");
+            ASSERT_EQUAL_HINT(parallel[i].id, expected[i].id, "Sharding should not change ranking");
+            ASSERT_HINT(std::abs(sequential[i].relevance - expected[i].relevance) < 1e-6,
+                        "Shards should rank with global document frequencies");
+        }
+    }
+
+    const auto [words, status] = sharded_search_server.MatchDocument("curly cat -dog"s, 7);
+    ASSERT_EQUAL(words.size(), 2u);
+
+    ASSERT_EQUAL(ProcessQueries(sharded_search_server, queries).size(), queries.size());
+
+    RequestQueue request_queue(sharded_search_server);
+    request_queue.AddFindRequest("empty request"s);
+    ASSERT_EQUAL(request_queue.GetNoResultRequests(), 1);
+
+    RemoveDuplicates(sharded_search_server);
+    ASSERT_EQUAL(sharded_search_server.GetDocumentCount(), 8);
+    ASSERT_HINT(sharded_search_server.GetWordFrequencies(9).empty(), "Duplicate should be removed from its shard");
+}
+
+void TestAddDocuments() {
+    std::mt19937 generator(7);
+    std::uniform_int_distribution<int> word_distribution(0, 499);
+    std::uniform_int_distribution<int> length_distribution(0, 12);
+    std::vector<std::string> texts(3000);
+
+    for (std::string& text : texts) {
+        for (int i = length_distribution(generator); i > 0; --i) {
+            text += "w"s + std::to_string(word_distribution(generator)) + (i % 5 == 0 ? " and "s : " "s);
+        }
+    }
+
+    SearchServer expected_search_server("and with"s);
+    SearchServer sequential_search_server("and with"s);
+    SearchServer parallel_search_server("and with"s);
+    std::vector<SearchServer::DocumentToAdd> documents;
+
+    for (int id = 0; id < static_cast<int>(texts.size()); ++id) {
+        const auto status = id % 7 == 0 ? DocumentStatus::kBanned : DocumentStatus::kActual;
+
+        expected_search_server.AddDocument(id * 2, texts[id], status, {id % 10, 3});
+        documents.push_back({id * 2, texts[id], status, {id % 10, 3}});
+    }
+
+    sequential_search_server.AddDocuments(documents);
+    parallel_search_server.AddDocument(1, "w1 w2 w3"s, DocumentStatus::kActual, {1});
+    parallel_search_server.RemoveDocument(1);
+    parallel_search_server.AddDocuments(std::execution::par, documents);
+
+    for (const SearchServer* search_server : {&sequential_search_server, &parallel_search_server}) {
+        ASSERT_EQUAL(search_server->GetDocumentCount(), expected_search_server.GetDocumentCount());
+
+        for (const std::string& query : {"w1 w2 w3 -w4"s, "w17 w250 w499"s, "w0"s}) {
+            const auto expected = expected_search_server.FindTopDocuments(query);
+            const auto found = search_server->FindTopDocuments(query);
+
+            ASSERT_EQUAL(found.size(), expected.size());
+
+            for (size_t i = 0; i < expected.size(); ++i) {
+                ASSERT_EQUAL(found[i].id, expected[i].id);
+                ASSERT_HINT(std::abs(found[i].relevance - expected[i].relevance) < 1e-6,
+                            "Bulk build should rank like one-by-one insertion");
+            }
+        }
+        ASSERT_HINT(search_server->GetWordFrequencies(42) == expected_search_server.GetWordFrequencies(42),
+                    "Bulk build should keep the same forward index");
+    }
+
+    const std::vector<SearchServer::DocumentToAdd> invalid_batches[] = {
+        {{10001, "new text"s, DocumentStatus::kActual, {}}, {10001, "duplicate id"s, DocumentStatus::kActual, {}}},
+        {{10003, "new text"s, DocumentStatus::kActual, {}}, {0, "existing id"s, DocumentStatus::kActual, {}}},
+        {{10005, "new text"s, DocumentStatus::kActual, {}}, {10007, "wo\x12rd"s, DocumentStatus::kActual, {}}},
+    };
+
+    for (const auto& invalid_batch : invalid_batches) {
+        try {
+            parallel_search_server.AddDocuments(std::execution::par, invalid_batch);
+            ASSERT_HINT(false, "Invalid batch should be rejected");
+        } catch (const std::invalid_argument&) {
+        }
+        ASSERT_EQUAL_HINT(parallel_search_server.GetDocumentCount(), expected_search_server.GetDocumentCount(),
+                          "Rejected batch should not add any document");
+    }
+}
+
+void TestSegmentedIndex() {
+    std::mt19937 generator(11);
+    std::uniform_int_distribution<int> word_distribution(0, 299);
+    std::vector<std::string> texts(30000);
+
+    for (std::string& text : texts) {
+        for (int i = 0; i < 6; ++i) {
+            text += "w"s + std::to_string(word_distribution(generator)) + " "s;
+        }
+    }
+
+    SearchServer search_server(""s);
+    SearchServer expected_search_server(""s);
+
+    for (int id = 0; id < static_cast<int>(texts.size()); ++id) {
+        search_server.AddDocument(id, texts[id], DocumentStatus::kActual, {id % 5});
+
+        // Most of the oldest documents and a part of the newest ones are removed, some of them while merges run.
+        if (id > 3 && (id < 10000 ? id % 4 != 0 : id % 7 == 0)) {
+            search_server.RemoveDocument(id - 3);
+        }
+    }
+    search_server.WaitForMerges();
+
+    for (int id = 0; id < static_cast<int>(texts.size()); ++id) {
+        if (!search_server.GetWordFrequencies(id).empty()) {
+            expected_search_server.AddDocument(id, texts[id], DocumentStatus::kActual, {id % 5});
+        }
+    }
+
+    ASSERT_EQUAL(search_server.GetDocumentCount(), expected_search_server.GetDocumentCount());
+    ASSERT_HINT(search_server.GetSegmentCount() < texts.size() / 4096, "Sealed segments should be merged");
+
+    for (const std::string& query : {"w1 w2 w3 -w4"s, "w17 w250 -w299"s, "w0 w1"s}) {
+        const auto expected = expected_search_server.FindTopDocuments(query);
+        const auto sequential = search_server.FindTopDocuments(query);
+        const auto parallel = search_server.FindTopDocuments(
+            std::execution::par, query, [](int, DocumentStatus, int) { return true; });
+
+        ASSERT_EQUAL(sequential.size(), expected.size());
+        ASSERT_EQUAL(parallel.size(), expected.size());
+
+        for (size_t i = 0; i < expected.size(); ++i) {
+            ASSERT_EQUAL_HINT(sequential[i].id, expected[i].id, "Deleted documents should not be found");
+            ASSERT_EQUAL_HINT(parallel[i].id, expected[i].id, "Deleted documents should not be found");
+            ASSERT_HINT(std::abs(sequential[i].relevance - expected[i].relevance) < 1e-6,
+                        "Segmented index should rank like a single one");
+        }
+    }
+}
+
+void TestSaveAndOpenIndexFile() {
+    const std::string path = (std::filesystem::temp_directory_path() / "search_server_test.idx").string();
+    SearchServer search_server("and with"s);
+
+    search_server.AddDocument(1, "funny pet and nasty rat"s, DocumentStatus::kActual, {7, 2, 7});
+    search_server.AddDocument(2, "funny pet with curly hair"s, DocumentStatus::kActual, {1, 2});
+    search_server.AddDocument(3, "big cat nasty hair"s, DocumentStatus::kBanned, {1, 2, 8});
+    search_server.AddDocument(4, "big dog fancy collar"s, DocumentStatus::kActual, {1, 3, 2});
+    search_server.AddDocument(5, "nasty rat with curly tail"s, DocumentStatus::kActual, {4});
+    search_server.RemoveDocument(4);
+    search_server.SaveToFile(path);
+
+    SearchServer opened_search_server = SearchServer::OpenFile(path);
+    SearchServer::VerifyFile(path);
+
+    std::string bytes;
+    {
+        std::ifstream input(path, std::ios::binary);
+        bytes.assign(std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>());
+    }
+    index_file::Header header;
+    std::memcpy(&header, bytes.data(), sizeof(header));
+
+    // Writes a copy of the file with one value overwritten at the given byte offset.
+    const auto write_patched = [&path, &bytes](size_t offset, auto value) {
+        std::string patched_bytes = bytes;
+        std::memcpy(patched_bytes.data() + offset, &value, sizeof(value));
+
+        const std::string patched_path = path + ".patched"s;
+        std::ofstream(patched_path, std::ios::binary) << patched_bytes;
+        return patched_path;
+    };
+    const auto get_section_offset = [&header](index_file::Section section) {
+        return static_cast<size_t>(header.sections[static_cast<size_t>(section)].offset);
+    };
+    const auto expect_rejected = [&](index_file::Section section, size_t offset, auto value, const char* hint) {
+        const std::string patched_path = write_patched(get_section_offset(section) + offset, value);
+        bool rejected = false;
+
+        try {
+            SearchServer::VerifyFile(patched_path);
+        } catch (const index_file::FormatError&) {
+            rejected = true;
+        }
+        std::filesystem::remove(patched_path);
+        ASSERT_HINT(rejected, hint);
+    };
+
+    using index_file::Section;
+
+    expect_rejected(Section::kPostingOrdinals, 0, DocumentOrdinal{1000}, "Posting ordinals should be bounded");
+    expect_rejected(Section::kForwardIndex, 0, TermId{1000}, "Document terms should be bounded");
+    expect_rejected(Section::kBlockMaxOffsets, sizeof(uint64_t), uint64_t{0}, "Every block should have a maximum");
+    expect_rejected(Section::kDocuments, offsetof(index_file::DocumentRecord, status), int32_t{7},
+                    "Document statuses should be valid");
+    expect_rejected(Section::kDocuments, offsetof(index_file::DocumentRecord, id), int32_t{-1},
+                    "Document ids should be non-negative");
+    expect_rejected(Section::kDocuments, sizeof(index_file::DocumentRecord) + offsetof(index_file::DocumentRecord, id),
+                    int32_t{1}, "Document ids should be unique");
+    expect_rejected(Section::kTerms, 0, '~', "Terms should be sorted");
+    expect_rejected(Section::kOrdinalsById, 0, DocumentOrdinal{1000}, "Ordinals by id should be bounded");
+    expect_rejected(Section::kOrdinalsById, 0, DocumentOrdinal{1}, "Ordinals by id should be sorted by id");
+
+    // Files of version 2 keep terms unsorted and lack the ordinals by id; the appended section is simply not read.
+    {
+        const std::string patched_path = write_patched(offsetof(index_file::Header, format_version), uint32_t{2});
+        const SearchServer legacy_search_server = SearchServer::OpenFile(patched_path);
+
+        std::filesystem::remove(patched_path);
+        ASSERT_EQUAL(legacy_search_server.GetDocumentCount(), search_server.GetDocumentCount());
+        ASSERT_EQUAL(legacy_search_server.FindTopDocuments("curly nasty rat"s).size(),
+                     search_server.FindTopDocuments("curly nasty rat"s).size());
+        ASSERT_EQUAL(std::get<0>(legacy_search_server.MatchDocument("nasty cat -rat"s, 3)).size(), 2u);
+    }
+
+    // Version 1 files have their texts tokenized on opening, where invalid characters are a format error as well.
+    {
+        std::string patched_bytes = bytes;
+        const uint32_t format_version = 1;
+
+        std::memcpy(patched_bytes.data() + offsetof(index_file::Header, format_version), &format_version,
+                    sizeof(format_version));
+        patched_bytes[get_section_offset(Section::kTexts)] = '\x01';
+
+        const std::string patched_path = path + ".patched"s;
+        std::ofstream(patched_path, std::ios::binary) << patched_bytes;
+
+        bool rejected = false;
+
+        try {
+            (void)SearchServer::OpenFile(patched_path);
+        } catch (const index_file::FormatError&) {
+            rejected = true;
+        }
+        std::filesystem::remove(patched_path);
+        ASSERT_HINT(rejected, "Invalid texts of version 1 files should be a format error");
+    }
+    std::filesystem::remove(path);
+
+    ASSERT_EQUAL(opened_search_server.GetDocumentCount(), search_server.GetDocumentCount());
+
+    for (const std::string& query : {"curly nasty rat"s, "funny pet -hair"s, "big with"s, "collar"s}) {
+        for (const DocumentStatus status : {DocumentStatus::kActual, DocumentStatus::kBanned}) {
+            const auto expected = search_server.FindTopDocuments(query, status);
+            const auto found = opened_search_server.FindTopDocuments(query, status);
+
+            ASSERT_EQUAL(found.size(), expected.size());
+
+            for (size_t i = 0; i < expected.size(); ++i) {
+                ASSERT_EQUAL(found[i].id, expected[i].id);
+                ASSERT_EQUAL(found[i].rating, expected[i].rating);
+                ASSERT_HINT(std::abs(found[i].relevance - expected[i].relevance) < 1e-6,
+                            "Opened index should rank like the saved one");
+            }
+        }
+    }
+
+    const auto [words, status] = opened_search_server.MatchDocument("nasty cat -rat"s, 3);
+    ASSERT_EQUAL(words.size(), 2u);
+    ASSERT(status == DocumentStatus::kBanned);
+
+    opened_search_server.AddDocument(6, "nasty dog"s, DocumentStatus::kActual, {5});
+    opened_search_server.RemoveDocument(1);
+
+    const auto found = opened_search_server.FindTopDocuments("nasty"s);
+    ASSERT_EQUAL_HINT(found.size(), 2u, "Opened index should accept modifications");
+    ASSERT_EQUAL(found.front().id, 6);
+    ASSERT_EQUAL(opened_search_server.GetWordFrequencies(2).at("curly"s), 0.25);
+}
+
+void TestDurableSearchServer() {
+    const std::filesystem::path directory = std::filesystem::temp_directory_path() / "search_server_test_durable";
+    std::filesystem::remove_all(directory);
+
+    const auto expect_documents = [](const DurableSearchServer& search_server, const std::vector<int>& expected_ids) {
+        std::vector<int> ids;
+
+        for (const Document& document : search_server.GetIndex().FindTopDocuments("nasty rat"s)) {
+            ids.push_back(document.id);
+        }
+        std::sort(ids.begin(), ids.end());
+        ASSERT_EQUAL(static_cast<size_t>(search_server.GetIndex().GetDocumentCount()), expected_ids.size());
+        ASSERT_HINT(ids == expected_ids, "Restored index should hold every logged mutation");
+    };
+    {
+        DurableSearchServer search_server(directory.string(), "and with"s);
+        search_server.AddDocument(1, "funny pet and nasty rat"s, DocumentStatus::kActual, {7, 2, 7});
+        search_server.AddDocument(2, "nasty rat with curly hair"s, DocumentStatus::kActual, {1, 2});
+        search_server.AddDocument(3, "big nasty dog"s, DocumentStatus::kActual, {4});
+        search_server.RemoveDocument(2);
+
+        // Logged before the index rejects it, and rejected again on replay.
+        bool is_rejected = false;
+        try {
+            search_server.AddDocument(3, "nasty duplicate"s, DocumentStatus::kActual, {});
+        } catch (const std::invalid_argument&) {
+            is_rejected = true;
+        }
+        ASSERT(is_rejected);
+        search_server.Sync();
+    }
+    {
+        DurableSearchServer search_server(directory.string(), "and with"s);
+        expect_documents(search_server, {1, 3});
+
+        search_server.Checkpoint();
+        search_server.AddDocument(2, "rat with a tail"s, DocumentStatus::kActual, {3});
+    }
+
+    // A record torn by a crash is dropped together with anything after it.
+    for (const auto& entry : std::filesystem::directory_iterator(directory)) {
+        if (entry.path().extension() == ".wal") {
+            std::ofstream(entry.path(), std::ios::binary | std::ios::app) << "torn";
+        }
+    }
+    {
+        DurableSearchServer search_server(directory.string(), "and with"s, {.checkpoint_log_size = 1});
+        expect_documents(search_server, {1, 2, 3});
+
+        search_server.AddDocument(4, "rat"s, DocumentStatus::kActual, {});
+        search_server.RemoveDocument(1);
+    }
+    {
+        DurableSearchServer search_server(directory.string(), "and with"s);
+        expect_documents(search_server, {2, 3, 4});
+        ASSERT_EQUAL(search_server.GetIndex().FindTopDocuments("with"s).size(), 0u);
+    }
+    std::filesystem::remove_all(directory);
+
+    // Checkpoints run in the background while writes go on; every write lands in a snapshot or a log replayed after.
+    {
+        DurableSearchServer search_server(directory.string(), "and with"s, {.checkpoint_log_size = 256});
+
+        for (int id = 0; id < 500; ++id) {
+            search_server.AddDocument(id, "doc w"s + std::to_string(id), DocumentStatus::kActual, {id});
+        }
+        search_server.Sync();
+    }
+    {
+        DurableSearchServer search_server(directory.string(), "and with"s);
+
+        ASSERT_EQUAL(search_server.GetIndex().GetDocumentCount(), 500);
+        ASSERT_EQUAL(search_server.GetIndex().FindTopDocuments("w499"s).front().id, 499);
+    }
+    std::filesystem::remove_all(directory);
+}
+
+void TestConcurrentReadersDuringWrites() {
+    SearchServer search_server("and"s);
+
+    for (int id = 0; id < 100; ++id) {
+        search_server.AddDocument(id, "stable and w"s + std::to_string(id % 10), DocumentStatus::kActual, {id});
+    }
+
+    std::atomic<bool> is_writing = true;
+    std::vector<std::thread> readers;
+
+    // Writes never touch the documents or the word "stable" the readers check, so every read must see them intact.
+    for (int reader = 0; reader < 3; ++reader) {
+        readers.emplace_back([&search_server, &is_writing, reader] {
+            for (int iteration = 0; is_writing || iteration < 100; ++iteration) {
+                const int id = (iteration * 7 + reader) % 100;
+                const auto found = reader == 0 ? search_server.FindTopDocuments("stable -fresh"s)
+                                               : search_server.FindTopDocuments(
+                                                     std::execution::par, "stable w1 fresh"s,
+                                                     [](int, DocumentStatus, int) { return true; });
+
+                ASSERT_EQUAL_HINT(found.size(), SearchServer::kMaxResultDocumentCount,
+                                  "Readers should not see partial writes");
+                ASSERT_HINT(std::all_of(found.begin(), found.end(), [](const Document& document) {
+                                return document.id < 100 || document.id >= 1000;
+                            }),
+                            "Readers should not see partial writes");
+
+                const auto [words, status] = search_server.MatchDocument("stable fresh"s, id);
+                ASSERT_EQUAL(words, std::vector<std::string_view>{"stable"});
+                ASSERT_EQUAL(search_server.GetWordFrequencies(id).at("stable"s), 0.5);
+            }
+        });
+    }
+
+    for (int id = 1000; id < 6000; ++id) {
+        search_server.AddDocument(id, "fresh w1 fresh"s + std::to_string(id), DocumentStatus::kActual, {1});
+
+        if (id % 3 == 0) {
+            search_server.RemoveDocument(id - 2);
+        }
+        if (id % 5 == 0) {
+            search_server.RemoveDocument(id);
+            search_server.AddDocument(id, "fresh again"s, DocumentStatus::kBanned, {2});
+        }
+    }
+    is_writing = false;
+
+    for (std::thread& reader : readers) {
+        reader.join();
+    }
+    search_server.WaitForMerges();
+
+    ASSERT_EQUAL(search_server.GetDocumentCount(), 100 + 5000 - 5000 / 3);
+    ASSERT(std::get<1>(search_server.MatchDocument("fresh"s, 1005)) == DocumentStatus::kBanned);
+}
+
+void TestQueryCache() {
+    SearchServer search_server("and"s);
+
+    search_server.AddDocument(1, "white cat and fancy collar"s, DocumentStatus::kActual, {8, -3});
+    search_server.AddDocument(2, "fluffy cat fluffy tail"s, DocumentStatus::kActual, {7, 2, 7});
+    search_server.AddDocument(3, "groomed dog expressive eyes"s, DocumentStatus::kBanned, {5, -12, 2, 1});
+
+    const auto expect_stats = [&search_server](uint64_t hits, uint64_t misses) {
+        ASSERT_EQUAL(search_server.GetQueryCacheStats().hits, hits);
+        ASSERT_EQUAL(search_server.GetQueryCacheStats().misses, misses);
+    };
+
+    const auto first = search_server.FindTopDocuments("fluffy cat -dog"s);
+    expect_stats(0, 1);
+
+    // Word order, repeated words and stop words do not change the parsed query.
+    const auto second = search_server.FindTopDocuments("-dog cat and fluffy cat"s);
+    expect_stats(1, 1);
+    ASSERT_EQUAL(second.size(), first.size());
+
+    for (size_t i = 0; i < first.size(); ++i) {
+        ASSERT_EQUAL(second[i].id, first[i].id);
+        ASSERT_EQUAL(second[i].relevance, first[i].relevance);
+    }
+
+    // Both texts are cached now and found without parsing.
+    ASSERT_EQUAL(search_server.FindTopDocuments("fluffy cat -dog"s).size(), first.size());
+    ASSERT_EQUAL(search_server.FindTopDocuments("-dog cat and fluffy cat"s).size(), first.size());
+    expect_stats(3, 1);
+
+    ASSERT(search_server.FindTopDocuments("fluffy cat -dog"s, DocumentStatus::kBanned).empty());
+    ASSERT_EQUAL(search_server.FindTopDocuments("fluffy cat -dog"s, DocumentStatus::kActual, 1).size(), 1u);
+    expect_stats(3, 3);
+
+    search_server.AddDocument(4, "fluffy fluffy cat"s, DocumentStatus::kActual, {1});
+    const auto after_add = search_server.FindTopDocuments("fluffy cat -dog"s);
+    expect_stats(3, 4);
+    ASSERT_EQUAL_HINT(after_add.size(), 3u, "Modifications should invalidate cached results");
+
+    search_server.RemoveDocument(4);
+    ASSERT_EQUAL_HINT(search_server.FindTopDocuments("fluffy cat -dog"s).size(), 2u,
+                      "Modifications should invalidate cached results");
+    expect_stats(3, 5);
+
+    // Texts are aliases of the entry of their parsed query and take none of the capacity: one entry per shard is
+    // enough for a query under several texts.
+    QueryCache cache(1);
+    const auto documents = std::make_shared<const std::vector<Document>>(first);
+    const QueryCache::Key key{{1, 2}, {3}, DocumentStatus::kActual, 5};
+
+    for (const std::string& text : {"a b -c"s, "b a -c"s, "a a b -c"s}) {
+        cache.Insert({text, DocumentStatus::kActual, 5}, key, 1, documents);
+    }
+    for (const std::string& text : {"a b -c"s, "b a -c"s, "a a b -c"s}) {
+        ASSERT(cache.FindByText({text, DocumentStatus::kActual, 5}, 1) == documents);
+        ASSERT(cache.FindByText({text, DocumentStatus::kActual, 5}, 2) == nullptr);
+    }
+    ASSERT(cache.Find(key, 1) == documents);
+    ASSERT_EQUAL(cache.GetStats().hits, 4u);
+
+    // A newer generation drops the aliases, whose texts may parse differently now.
+    cache.Insert({"a b -c"s, DocumentStatus::kActual, 5}, key, 2, documents);
+    ASSERT(cache.FindByText({"a b -c"s, DocumentStatus::kActual, 5}, 2) == documents);
+    ASSERT(cache.FindByText({"b a -c"s, DocumentStatus::kActual, 5}, 2) == nullptr);
+}
+
+void TestThreadPool() {
+    ThreadPool thread_pool({.worker_count = 3});
+    std::vector<int> visits(1000, 0);
+
+    // Loops nested in pool tasks run on the same workers and must not deadlock.
+    thread_pool.ParallelFor(10, [&](size_t outer) {
+        thread_pool.ParallelFor(100, [&](size_t inner) { ++visits[outer * 100 + inner]; });
+    });
+    ASSERT_HINT(std::all_of(visits.begin(), visits.end(), [](int count) { return count == 1; }),
+                "Every index should be visited once");
+
+    bool is_thrown = false;
+
+    try {
+        thread_pool.ParallelFor(100, [](size_t index) {
+            if (index == 42) {
+                throw std::runtime_error("failed");
+            }
+        });
+    } catch (const std::runtime_error&) {
+        is_thrown = true;
+    }
+    ASSERT_HINT(is_thrown, "Exceptions should reach the caller");
+
+    SearchServer search_server("and"s);
+    std::vector<std::string> queries;
+
+    for (int id = 0; id < 20000; ++id) {
+        search_server.AddDocument(id, "w"s + std::to_string(id % 97) + " and w"s + std::to_string(id % 13),
+                                  DocumentStatus::kActual, {id % 7});
+    }
+    search_server.SetThreadPool(thread_pool);
+
+    for (int i = 0; i < 50; ++i) {
+        queries.push_back("w"s + std::to_string(i) + " w"s + std::to_string(i % 13) + " -w"s + std::to_string(i + 1));
+    }
+    const auto results = ProcessQueries(search_server, queries, thread_pool);
+
+    for (size_t i = 0; i < queries.size(); ++i) {
+        const auto parallel = search_server.FindTopDocuments(std::execution::par, queries[i],
+                                                             [](int, DocumentStatus, int) { return true; });
+
+        ASSERT_EQUAL(results[i].size(), parallel.size());
+
+        for (size_t j = 0; j < parallel.size(); ++j) {
+            ASSERT_EQUAL(results[i][j].id, parallel[j].id);
+        }
+    }
+}
+
+void TestBatchQueries() {
+    std::mt19937 generator(13);
+    std::uniform_int_distribution<int> word_distribution(0, 199);
+    SearchServer search_server("w0"s);
+
+    // Enough documents for sealed and merged segments next to the mutable one, some of them removed or banned.
+    for (int id = 0; id < 12000; ++id) {
+        std::string text;
+
+        for (int i = 0; i < 5; ++i) {
+            text += "w"s + std::to_string(word_distribution(generator)) + " "s;
+        }
+        search_server.AddDocument(id, text, id % 11 == 0 ? DocumentStatus::kBanned : DocumentStatus::kActual,
+                                  {id % 9});
+
+        if (id % 5 == 0) {
+            search_server.RemoveDocument(id / 2);
+        }
+    }
+
+    std::vector<std::string> queries;
+
+    for (int i = 0; i < 600; ++i) {
+        // Few distinct words, so queries of the batch share most of their terms.
+        queries.push_back("w"s + std::to_string(word_distribution(generator) % 20) + " w"s +
+                          std::to_string(word_distribution(generator) % 30) + " -w"s +
+                          std::to_string(word_distribution(generator)));
+    }
+    queries.push_back(""s);
+    queries.push_back("-w1"s);
+
+    const auto results = search_server.FindTopDocumentsBatch(queries);
+    const auto banned_results = search_server.FindTopDocumentsBatch(queries, DocumentStatus::kBanned, 3);
+
+    ASSERT_EQUAL(results.size(), queries.size());
+
+    for (size_t i = 0; i < queries.size(); ++i) {
+        for (const auto& [found, expected] :
+             {std::pair{results[i], search_server.FindTopDocuments(queries[i])},
+              std::pair{banned_results[i], search_server.FindTopDocuments(queries[i], DocumentStatus::kBanned, 3)}}) {
+            ASSERT_EQUAL(found.size(), expected.size());
+
+            for (size_t j = 0; j < expected.size(); ++j) {
+                ASSERT_EQUAL_HINT(found[j].id, expected[j].id, "Batch should rank like single queries");
+                ASSERT(std::abs(found[j].relevance - expected[j].relevance) < 1e-6);
+            }
+        }
+    }
+}
+
+void TestTokenizer() {
+    std::mt19937 generator(15);
+    // Spaces and control characters are frequent, so words and invalid bytes fall on every block boundary.
+    const std::string alphabet = "ab  \x01\x1f\x7f\x80\xff"s;
+    std::vector<std::string_view> words;
+
+    for (size_t length = 0; length < 200; ++length) {
+        for (int round = 0; round < 20; ++round) {
+            std::string text;
+
+            for (size_t i = 0; i < length; ++i) {
+                text += alphabet[generator() % alphabet.size()];
+            }
+            std::vector<std::string_view> expected_words;
+            bool expected_valid = true;
+            size_t word_begin = 0;
+
+            for (size_t i = 0; i <= text.size(); ++i) {
+                if (i == text.size() || text[i] == ' ') {
+                    if (i > word_begin) {
+                        expected_words.push_back(std::string_view(text).substr(word_begin, i - word_begin));
+                    }
+                    word_begin = i + 1;
+                } else if (static_cast<unsigned char>(text[i]) < ' ') {
+                    expected_valid = false;
+                }
+            }
+
+            ASSERT_EQUAL(string_processing::SplitIntoWordsView(text, words), expected_valid);
+            ASSERT_EQUAL(words.size(), expected_words.size());
+
+            for (size_t i = 0; i < words.size(); ++i) {
+                ASSERT(words[i] == expected_words[i]);
+                ASSERT(words[i].data() == expected_words[i].data());
+            }
+        }
+    }
+
+    SearchServer search_server("and"s);
+
+    search_server.AddDocument(1, "  white  cat and   fancy collar "s, DocumentStatus::kActual, {8});
+    search_server.AddDocument(2, "fluffy cat fluffy tail"s, DocumentStatus::kActual, {7});
+
+    const auto [matched_words, status] = search_server.MatchDocument(" fancy   cat  "s, 1);
+    ASSERT_EQUAL(matched_words.size(), 2u);
+    ASSERT_EQUAL(search_server.FindTopDocuments("   cat   -tail "s).size(), 1u);
+}
+
+void TestStopWordFilter() {
+    std::set<std::string> words;
+
+    for (int i = 0; i < 1000; ++i) {
+        words.insert("w"s + std::to_string(i * 7));
+    }
+    const StopWordFilter filter(words);
+
+    ASSERT_EQUAL(filter.size(), words.size());
+    ASSERT(std::equal(filter.begin(), filter.end(), words.begin(), words.end()));
+
+    for (int i = 0; i < 7000; ++i) {
+        const std::string word = "w"s + std::to_string(i);
+        ASSERT_EQUAL(filter.Contains(word), words.count(word) > 0);
+    }
+    ASSERT(!filter.Contains(std::string_view()));
+    ASSERT(!StopWordFilter().Contains("w0"));
+
+    static constexpr StaticStopWordFilter kStopWords(std::to_array<std::string_view>({"and", "in", "on", "the"}));
+    static_assert(kStopWords.Contains("and") && kStopWords.Contains("the"));
+    static_assert(!kStopWords.Contains("an") && !kStopWords.Contains("then") && !kStopWords.Contains(""));
+
+    SearchServer search_server(kStopWords);
+
+    search_server.AddDocument(1, "the cat in the hat"s, DocumentStatus::kActual, {1});
+    ASSERT(search_server.FindTopDocuments("the"s).empty());
+    ASSERT_EQUAL(search_server.FindTopDocuments("cat"s).size(), 1u);
+
+    search_server.SetStopWords("cat"s);
+    ASSERT(search_server.FindTopDocuments("cat"s).empty());
+    ASSERT_EQUAL(search_server.FindTopDocuments("hat"s).size(), 1u);
+}
+
+void TestScoringModels() {
+    const auto actual = [](int, DocumentStatus status, int) { return status == DocumentStatus::kActual; };
+    const std::vector<std::string> texts = {"funny pet and nasty rat"s, "rat"s, "curly rat with curly rat tail"s,
+                                            "nasty dog with big eyes and a very long and curly tail"s};
+    SearchServer search_server("and with"s);
+
+    for (int id = 0; id < static_cast<int>(texts.size()); ++id) {
+        search_server.AddDocument(id, texts[id], DocumentStatus::kActual, {1});
+    }
+
+    // Textbook BM25 over raw counts: lengths 4, 1, 5 and 9 words besides stop words, 19 / 4 on average.
+    const auto bm25 = [](double count, double length, double document_frequency) {
+        const double average_length = 19.0 / 4;
+        const double inverse_document_frequency =
+            std::log(1 + (4 - document_frequency + 0.5) / (document_frequency + 0.5));
+
+        return inverse_document_frequency * count * (Bm25Scoring::kK1 + 1) /
+               (count + Bm25Scoring::kK1 * (1 - Bm25Scoring::kB + Bm25Scoring::kB * length / average_length));
+    };
+    const std::map<int, double> expected = {{0, bm25(1, 4, 3)},
+                                            {1, bm25(1, 1, 3)},
+                                            {2, bm25(2, 5, 3) + bm25(2, 5, 2)},
+                                            {3, bm25(1, 9, 2)}};
+    const auto found = search_server.FindTopDocuments<Bm25Scoring>("rat curly"s, actual, 10);
+
+    ASSERT_EQUAL(found.size(), expected.size());
+
+    for (const Document& document : found) {
+        ASSERT_HINT(std::abs(document.relevance - expected.at(document.id)) < 1e-9, "BM25 relevance is wrong");
+    }
+    ASSERT_EQUAL(found.front().id, 2);
+
+    const auto tf_idf = search_server.FindTopDocuments("rat"s, actual, 10);
+    ASSERT_EQUAL_HINT(tf_idf.front().id, 1, "The default model should stay TF-IDF");
+    ASSERT(std::abs(tf_idf.front().relevance - std::log(4.0 / 3)) < 1e-9);
+
+    // Pruned and exhaustive search agree, also after removals and across an index file.
+    const std::string path = (std::filesystem::temp_directory_path() / "search_server_scoring_test.idx").string();
+    std::mt19937 generator(17);
+    SearchServer large_search_server("and with"s);
+
+    for (int id = 0; id < 3000; ++id) {
+        std::string text;
+
+        for (size_t i = 0, length = 1 + generator() % 30; i < length; ++i) {
+            text += "w"s + std::to_string(generator() % 50 * (generator() % 4)) + " "s;
+        }
+        large_search_server.AddDocument(id, text, DocumentStatus::kActual, {1});
+    }
+
+    for (int id = 0; id < 3000; id += 7) {
+        large_search_server.RemoveDocument(id);
+    }
+    large_search_server.SaveToFile(path);
+
+    const SearchServer opened_search_server = SearchServer::OpenFile(path);
+    std::filesystem::remove(path);
+
+    for (int i = 0; i < 50; ++i) {
+        const std::string query = "w"s + std::to_string(i) + " w"s + std::to_string(i * 3) + " -w"s +
+                                  std::to_string(i + 1);
+        const auto pruned = large_search_server.FindTopDocuments<Bm25Scoring>(query, actual);
+        const auto exhaustive = large_search_server.FindTopDocuments<Bm25Scoring>(std::execution::par, query, actual);
+        const auto opened = opened_search_server.FindTopDocuments<Bm25Scoring>(query, actual);
+
+        ASSERT_EQUAL(exhaustive.size(), pruned.size());
+        ASSERT_EQUAL(opened.size(), pruned.size());
+
+        for (size_t j = 0; j < pruned.size(); ++j) {
+            ASSERT_EQUAL(exhaustive[j].id, pruned[j].id);
+            ASSERT(std::abs(exhaustive[j].relevance - pruned[j].relevance) < 1e-6);
+            ASSERT_EQUAL(opened[j].id, pruned[j].id);
+            ASSERT(std::abs(opened[j].relevance - pruned[j].relevance) < 1e-6);
+        }
+    }
+
+    ShardedSearchServer sharded_search_server("and with"s, 3);
+
+    for (int id = 0; id < static_cast<int>(texts.size()); ++id) {
+        sharded_search_server.AddDocument(id, texts[id], DocumentStatus::kActual, {1});
+    }
+    const auto sharded = sharded_search_server.FindTopDocuments<Bm25Scoring>("rat curly"s, actual, 10);
+
+    ASSERT_EQUAL(sharded.size(), found.size());
+
+    for (size_t i = 0; i < found.size(); ++i) {
+        ASSERT_EQUAL_HINT(sharded[i].id, found[i].id, "Shards should rank with global statistics");
+        ASSERT(std::abs(sharded[i].relevance - found[i].relevance) < 1e-9);
+    }
+}
+
+void TestDocumentStore() {
+    const DocumentStatus actual = DocumentStatus::kActual;
+
+    {
+        Epoch epoch;
+        DocumentStore store;
+        std::vector<std::string> texts;
+        std::vector<TextLocation> locations;
+
+        // Repetitive texts compress, the large one fills blocks of its own and the empty one takes no space.
+        for (int i = 0; i < 5000; ++i) {
+            texts.push_back("document "s + std::to_string(i) + " about cats and dogs "s + std::to_string(i % 7));
+        }
+        texts.push_back(std::string(3 * DocumentStore::kBlockSize, 'a'));
+        texts.push_back(std::string());
+        texts.push_back("last"s);
+
+        for (const std::string& text : texts) {
+            locations.push_back(store.Append(text, epoch));
+        }
+        std::string owned_text(DocumentStore::kBlockSize, 'b');
+
+        texts.push_back(owned_text);
+        locations.push_back(store.Append(std::move(owned_text), epoch));
+
+        ASSERT(store.GetStoredSize() < store.GetTextSize() / 2);
+
+        DocumentStore::Reader reader(store);
+
+        for (size_t i = 0; i < texts.size(); ++i) {
+            ASSERT_EQUAL(reader.Read(locations[i]), texts[i]);
+        }
+        // Out of order, so blocks are decompressed again.
+        for (size_t i = texts.size(); i-- > 0;) {
+            ASSERT_EQUAL(reader.Read(locations[i]), texts[i]);
+        }
+    }
+
+    SearchServer search_server("and in"s);
+    std::string large_text;
+
+    for (int i = 0; i < 20000; ++i) {
+        large_text += "w"s + std::to_string(i % 1000) + ' ';
+    }
+    search_server.AddDocument(1, "funny pet and nasty rat"s, actual, {1});
+    search_server.AddDocument(2, std::string(large_text), actual, {1});
+    search_server.AddDocument(3, "cat in the city", actual, {1});
+
+    std::vector<std::string> batch_texts;
+    std::vector<SearchServer::DocumentToAdd> batch;
+
+    for (int i = 0; i < 3000; ++i) {
+        batch_texts.push_back("batch document "s + std::to_string(i));
+    }
+    for (int i = 0; i < static_cast<int>(batch_texts.size()); ++i) {
+        batch.push_back({100 + i, batch_texts[i], actual, {1}});
+    }
+    search_server.AddDocuments(std::execution::par, batch);
+    search_server.RemoveDocument(3);
+
+    const auto check_texts = [&](const SearchServer& server) {
+        ASSERT_EQUAL(server.GetDocumentText(1), "funny pet and nasty rat"s);
+        ASSERT_EQUAL(server.GetDocumentText(2), large_text);
+        ASSERT_HINT(server.GetDocumentText(3).empty(), "Removed documents should have no text");
+        ASSERT(server.GetDocumentText(42).empty());
+
+        for (int i = 0; i < static_cast<int>(batch_texts.size()); ++i) {
+            ASSERT_EQUAL(server.GetDocumentText(100 + i), batch_texts[i]);
+        }
+    };
+    check_texts(search_server);
+    ASSERT_EQUAL(search_server.FindTopDocuments("w7"s).size(), 1u);
+
+    const std::string path = (std::filesystem::temp_directory_path() / "search_server_store_test.idx").string();
+
+    search_server.SaveToFile(path);
+
+    SearchServer opened_search_server = SearchServer::OpenFile(path);
+    std::filesystem::remove(path);
+
+    check_texts(opened_search_server);
+    // Texts added after opening go to the store's own blocks, behind the mapped ones.
+    opened_search_server.AddDocument(4, "new document"s, actual, {1});
+    ASSERT_EQUAL(opened_search_server.GetDocumentText(4), "new document"s);
+    ASSERT_EQUAL(opened_search_server.GetDocumentText(1), "funny pet and nasty rat"s);
+
+    ShardedSearchServer sharded_search_server("and"s, 2);
+
+    sharded_search_server.AddDocument(5, "sharded text"s, actual, {1});
+    ASSERT_EQUAL(sharded_search_server.GetDocumentText(5), "sharded text"s);
+}
+
+void TestMemoryStats() {
+    const DocumentStatus actual = DocumentStatus::kActual;
+    SearchServer search_server("and in the"s);
+
+    const MemoryStats empty_stats = search_server.GetMemoryStats();
+
+    ASSERT_EQUAL(empty_stats.stop_words.object_count, 3u);
+    ASSERT_EQUAL(empty_stats.postings.object_count, 0u);
+    ASSERT_EQUAL(empty_stats.document_ids.object_count, 0u);
+
+    std::vector<std::string> texts;
+    std::vector<SearchServer::DocumentToAdd> documents;
+
+    for (int i = 0; i < 2000; ++i) {
+        texts.push_back("document number "s + std::to_string(i) + " about pets and their long names "s +
+                        std::to_string(i % 97));
+    }
+    for (int i = 0; i < static_cast<int>(texts.size()); ++i) {
+        documents.push_back({i, texts[i], actual, {1}});
+    }
+    search_server.AddDocuments(std::execution::par, documents);
+    search_server.AddDocument(5000, "one more document"s, actual, {1});
+
+    const MemoryStats stats = search_server.GetMemoryStats();
+    // Nine distinct words per document, but only eight in the first 97, where both numbers coincide.
+    const size_t posting_count = 2000 * 9 - 97 + 3;
+
+    ASSERT_EQUAL(stats.document_ids.object_count, 2001u);
+    ASSERT_EQUAL(stats.document_metadata.object_count, 2001u);
+    ASSERT_EQUAL(stats.document_texts.object_count, 2001u);
+    ASSERT_EQUAL(stats.postings.object_count, posting_count);
+    ASSERT_EQUAL(stats.forward_index.object_count, posting_count);
+    ASSERT(stats.term_dictionary.object_count >= 2000u);
+    ASSERT(stats.postings.bytes >= posting_count * (sizeof(DocumentOrdinal) + sizeof(double)));
+    ASSERT(stats.forward_index.bytes >= posting_count * sizeof(uint32_t));
+    ASSERT(stats.document_texts.bytes > 0);
+    ASSERT_EQUAL(stats.allocator_overhead_bytes % MemoryStats::kAllocationOverhead, 0u);
+    ASSERT(stats.allocator_overhead_bytes > 0);
+    ASSERT_EQUAL(stats.mapped_bytes, 0u);
+    ASSERT(stats.GetTotalBytes() > stats.postings.bytes + stats.forward_index.bytes);
+
+    // Removed documents give their forward index back at once; their postings wait for a merge.
+    for (int i = 0; i < 1000; ++i) {
+        search_server.RemoveDocument(i);
+    }
+    const MemoryStats removed_stats = search_server.GetMemoryStats();
+
+    ASSERT_EQUAL(removed_stats.document_ids.object_count, 1001u);
+    ASSERT_EQUAL(removed_stats.forward_index.object_count, 1000u * 9 + 3);
+    ASSERT(removed_stats.forward_index.bytes < stats.forward_index.bytes);
+
+    const std::string path = (std::filesystem::temp_directory_path() / "search_server_memory_test.idx").string();
+
+    search_server.SaveToFile(path);
+
+    const SearchServer opened_search_server = SearchServer::OpenFile(path);
+    std::filesystem::remove(path);
+
+    const MemoryStats opened_stats = opened_search_server.GetMemoryStats();
+
+    ASSERT(opened_stats.mapped_bytes > 0);
+    ASSERT_HINT(opened_stats.forward_index.bytes == 0 &&
+                    opened_stats.document_texts.bytes < removed_stats.document_texts.bytes,
+                "Data viewed in the mapped file should take no heap memory");
+    ASSERT_EQUAL(opened_stats.forward_index.object_count, 1000u * 9 + 3);
+
+    ShardedSearchServer sharded_search_server("and"s, 3);
+
+    for (int i = 0; i < 30; ++i) {
+        sharded_search_server.AddDocument(i, texts[i], actual, {1});
+    }
+    const MemoryStats sharded_stats = sharded_search_server.GetMemoryStats();
+
+    ASSERT_EQUAL(sharded_stats.stop_words.object_count, 3u);
+    ASSERT_EQUAL_HINT(sharded_stats.document_ids.object_count, 60u, "Shards and the sharded server keep ids each");
+}
+
+void TestMetrics() {
+    LatencyHistogram histogram;
+
+    ASSERT_EQUAL(histogram.GetSnapshot().GetPercentile(0.5), 0u);
+
+    // Exact below 128, within 1/64 of the value above.
+    const auto values = std::to_array<uint64_t>({0, 1, 127, 128, 1000, 123456789, LatencyHistogram::kMaxValue});
+
+    for (const uint64_t value : values) {
+        const size_t index = LatencyHistogram::GetBucketIndex(value);
+        const uint64_t upper_bound = LatencyHistogram::GetBucketUpperBound(index);
+
+        ASSERT(index < LatencyHistogram::kBucketCount);
+        ASSERT(upper_bound >= value && upper_bound - value <= value / 64);
+        ASSERT(index == 0 || LatencyHistogram::GetBucketUpperBound(index - 1) < value);
+    }
+
+    std::vector<std::thread> threads;
+
+    // One to a thousand microseconds spread over more threads than shards, then one value beyond the range.
+    constexpr int kThreadCount = 2 * LatencyHistogram::kShardCount;
+
+    for (int thread = 0; thread < kThreadCount; ++thread) {
+        threads.emplace_back([&histogram, thread] {
+            for (uint64_t value = 1 + thread; value <= 1000; value += kThreadCount) {
+                histogram.Record(value * 1000);
+            }
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    histogram.Record(uint64_t{1} << 50);
+
+    const LatencyHistogram::Snapshot snapshot = histogram.GetSnapshot();
+    const auto is_close = [](uint64_t actual, uint64_t expected) {
+        return actual >= expected && actual - expected <= expected / 64;
+    };
+
+    ASSERT_EQUAL(snapshot.count, 1001u);
+    ASSERT_EQUAL(snapshot.max, LatencyHistogram::kMaxValue);
+    ASSERT(is_close(snapshot.GetPercentile(0.5), 501'000));
+    ASSERT(is_close(snapshot.GetPercentile(0.99), 991'000));
+    ASSERT(is_close(snapshot.GetPercentile(0.999), 1'000'000));
+    ASSERT_EQUAL(snapshot.GetPercentile(1.0), LatencyHistogram::kMaxValue);
+
+    MetricsRegistry registry;
+
+    registry.GetCounter("requests_total").Add(3);
+    registry.GetCounter("requests_total").Add();
+    LatencyHistogram& histogram_a = registry.GetHistogram("latency_ns", "kind=\"a\"");
+
+    ASSERT_EQUAL(&registry.GetHistogram("latency_ns", "kind=\"a\""), &histogram_a);
+    ASSERT(&registry.GetHistogram("latency_ns", "kind=\"b\"") != &histogram_a);
+    {
+        LOG_DURATION_HISTOGRAM(histogram_a);
+    }
+    std::ostringstream text;
+
+    registry.WriteText(text);
+
+    const std::string exported = text.str();
+
+    ASSERT(exported.find("# TYPE requests_total counter\nrequests_total 4\n") != std::string::npos);
+    ASSERT(exported.find("# TYPE latency_ns summary\n") != std::string::npos);
+    ASSERT(exported.find("latency_ns{kind=\"a\",quantile=\"0.999\"} ") != std::string::npos);
+    ASSERT(exported.find("latency_ns_count{kind=\"a\"} 1\n") != std::string::npos);
+    ASSERT(exported.find("latency_ns_count{kind=\"b\"} 0\n") != std::string::npos);
+
+    std::ostringstream log;
+    {
+        LOG_DURATION_STREAM("operation"s, log);
+    }
+    ASSERT(log.str().starts_with("operation: ") && log.str().ends_with(" ms\n"));
+
+    // Operations of every server go to the default registry, separately per execution policy.
+    MetricsRegistry& metrics = MetricsRegistry::GetDefault();
+    const auto get_count = [&metrics](std::string_view name, std::string_view labels = {}) {
+        return metrics.GetHistogram(name, labels).GetSnapshot().count;
+    };
+    const uint64_t add_count = get_count("search_server_add_document_ns");
+    const uint64_t seq_count = get_count("search_server_find_top_documents_ns", "policy=\"seq\"");
+    const uint64_t par_count = get_count("search_server_find_top_documents_ns", "policy=\"par\"");
+    const uint64_t match_count = get_count("search_server_match_document_ns", "policy=\"par\"");
+    const uint64_t remove_count = get_count("search_server_remove_document_ns");
+    const uint64_t process_count = get_count("process_queries_ns");
+    const uint64_t query_count = metrics.GetCounter("process_queries_queries_total").Get();
+
+    SearchServer search_server("and"s);
+
+    search_server.AddDocument(1, "funny pet and nasty rat"s, DocumentStatus::kActual, {1});
+    search_server.AddDocument(2, "funny pet with curly hair"s, DocumentStatus::kActual, {1});
+    (void)search_server.FindTopDocuments("pet"s);
+    (void)search_server.FindTopDocuments("rat"s, [](int, DocumentStatus, int) { return true; });
+    (void)search_server.FindTopDocuments(std::execution::par, "rat"s, [](int, DocumentStatus, int) { return true; });
+    (void)search_server.MatchDocument(std::execution::par, "rat"s, 1);
+    search_server.RemoveDocument(2);
+    (void)ProcessQueries(search_server, {"pet"s, "rat"s, "hair"s});
+
+    ASSERT_EQUAL(get_count("search_server_add_document_ns"), add_count + 2);
+    ASSERT_EQUAL(get_count("search_server_find_top_documents_ns", "policy=\"seq\""), seq_count + 2);
+    ASSERT_EQUAL(get_count("search_server_find_top_documents_ns", "policy=\"par\""), par_count + 1);
+    ASSERT_EQUAL(get_count("search_server_match_document_ns", "policy=\"par\""), match_count + 1);
+    ASSERT_EQUAL(get_count("search_server_remove_document_ns"), remove_count + 1);
+    ASSERT_EQUAL(get_count("process_queries_ns"), process_count + 1);
+    ASSERT_EQUAL(metrics.GetCounter("process_queries_queries_total").Get(), query_count + 3);
+}
+
+void TestDuplicateDetection() {
+    // Every tenth document is repeated once in reverse word order and once with one word of twenty replaced, which
+    // leaves a similarity of 19 / 21.
+    const auto make_text = [](int document, int replaced_word) {
+        std::string text;
+
+        for (int word = 0; word < 20; ++word) {
+            text += word == replaced_word ? 'v' : 'w';
+            text += std::to_string(document) + "x"s + std::to_string(word) + ' ';
+        }
+
+        return text;
+    };
+    const auto reverse_words = [](const std::string& text) {
+        std::vector<std::string> words = string_processing::SplitIntoWords(text);
+        std::string reversed;
+
+        std::reverse(words.begin(), words.end());
+        for (const std::string& word : words) {
+            reversed += word + ' ';
+        }
+
+        return reversed;
+    };
+
+    SearchServer search_server(""s);
+    ShardedSearchServer sharded_search_server(""s, 3);
+    std::vector<int> exact_duplicate_ids;
+    std::vector<int> near_duplicate_ids;
+
+    for (int document = 0; document < 1000; ++document) {
+        std::vector<std::pair<int, std::string>> documents = {{document, make_text(document, -1)}};
+
+        if (document % 10 == 0) {
+            documents.emplace_back(1000 + document, reverse_words(documents.front().second));
+            documents.emplace_back(2000 + document, make_text(document, document % 20));
+            exact_duplicate_ids.push_back(1000 + document);
+            near_duplicate_ids.push_back(2000 + document);
+        }
+        for (const auto& [id, text] : documents) {
+            search_server.AddDocument(id, text, DocumentStatus::kActual, {1});
+            sharded_search_server.AddDocument(id, text, DocumentStatus::kActual, {1});
+        }
+    }
+    std::vector<int> all_duplicate_ids = exact_duplicate_ids;
+    all_duplicate_ids.insert(all_duplicate_ids.end(), near_duplicate_ids.begin(), near_duplicate_ids.end());
+
+    const DuplicateDetectionOptions near_options{.find_near_duplicates = true, .similarity_threshold = 0.7};
+
+    ASSERT_EQUAL(FindDuplicates(search_server), exact_duplicate_ids);
+    ASSERT_EQUAL(FindDuplicates(search_server, near_options), all_duplicate_ids);
+    ASSERT_EQUAL(FindDuplicates(sharded_search_server), exact_duplicate_ids);
+    ASSERT_EQUAL(FindDuplicates(sharded_search_server, near_options), all_duplicate_ids);
+    // Documents sharing 19 of 21 words are not near duplicates above that similarity.
+    ASSERT_EQUAL(FindDuplicates(search_server, {.find_near_duplicates = true, .similarity_threshold = 0.99}),
+                 exact_duplicate_ids);
+
+    bool is_rejected = false;
+    try {
+        (void)FindDuplicates(search_server, {.find_near_duplicates = true, .similarity_threshold = 1.5});
+    } catch (const std::invalid_argument&) {
+        is_rejected = true;
+    }
+    ASSERT(is_rejected);
+
+    // Unknown and repeated ids are skipped.
+    std::vector<int> removed_ids = exact_duplicate_ids;
+    removed_ids.push_back(exact_duplicate_ids.front());
+    removed_ids.push_back(5000);
+
+    search_server.RemoveDocuments(removed_ids);
+    sharded_search_server.RemoveDocuments(std::execution::par, removed_ids);
+
+    ASSERT_EQUAL(search_server.GetDocumentCount(), 1100);
+    ASSERT_EQUAL(sharded_search_server.GetDocumentCount(), 1100);
+    ASSERT(search_server.FindTopDocuments("w1000x0"s).empty());
+    ASSERT(sharded_search_server.FindTopDocuments("w1000x0"s).empty());
+    ASSERT(FindDuplicates(search_server).empty());
+    ASSERT_EQUAL(FindDuplicates(sharded_search_server, near_options), near_duplicate_ids);
+
+    std::vector<std::string_view> words;
+
+    search_server.ForEachWord(0, [&words](std::string_view word) { words.push_back(word); });
+    ASSERT_EQUAL(words.size(), 20u);
+    ASSERT(std::find(words.begin(), words.end(), "w0x19"s) != words.end());
+}
+
+void TestCompact() {
+    const DocumentStatus actual = DocumentStatus::kActual;
+    SearchServer search_server("and"s);
+
+    // Every document has a word of its own, and every tenth survives the removals.
+    for (int i = 0; i < 1000; ++i) {
+        search_server.AddDocument(i, "pet and rat "s + (i % 2 == 0 ? "cat"s : "dog"s) + " w"s + std::to_string(i),
+                                  i % 3 == 0 ? DocumentStatus::kBanned : actual, {i});
+    }
+    for (int i = 0; i < 1000; ++i) {
+        if (i % 10 != 0) {
+            search_server.RemoveDocument(i);
+        }
+    }
+    const std::vector<std::string> queries = {"pet"s, "cat -w20"s, "w30 w31"s, "dog"s, "w990 rat"s};
+    std::vector<std::vector<Document>> expected_results;
+
+    for (const std::string& query : queries) {
+        expected_results.push_back(search_server.FindTopDocuments(query));
+    }
+    const MemoryStats stats = search_server.GetMemoryStats();
+
+    // Words without live documents leave the dictionary one modification later, once no reader can look them up any
+    // more: only "dog" and "w999", which lost their last document in the last removal, are still there.
+    ASSERT_EQUAL(stats.term_dictionary.object_count, 3u + 100u + 2u);
+
+    // The term lookup is rebuilt over and over to clear the words that left, and the tables it replaces are released.
+    {
+        SearchServer churned_search_server(""s);
+
+        for (int i = 0; i < 5000; ++i) {
+            churned_search_server.AddDocument(i, "w"s + std::to_string(i), actual, {});
+            churned_search_server.RemoveDocument(i);
+        }
+        const MemoryUsage usage = churned_search_server.GetMemoryStats().term_dictionary;
+
+        // Ids are not reused, so the views of the words stay; every table kept would add two more allocations.
+        ASSERT_EQUAL(usage.object_count, 1u);
+        ASSERT(usage.allocation_count < 500u);
+    }
+
+    search_server.Compact();
+
+    const MemoryStats compacted_stats = search_server.GetMemoryStats();
+
+    ASSERT_EQUAL(search_server.GetDocumentCount(), 100);
+    ASSERT_EQUAL(compacted_stats.document_metadata.object_count, 100u);
+    // Four shared words, one of which no survivor contains, and one word per survivor.
+    ASSERT_EQUAL(compacted_stats.term_dictionary.object_count, 3u + 100u);
+    ASSERT_EQUAL(compacted_stats.postings.object_count, 100u * 4);
+    ASSERT_EQUAL(compacted_stats.document_texts.object_count, 100u);
+    ASSERT(compacted_stats.GetTotalBytes() < stats.GetTotalBytes());
+
+    for (size_t i = 0; i < queries.size(); ++i) {
+        const std::vector<Document> documents = search_server.FindTopDocuments(queries[i]);
+
+        ASSERT_EQUAL(documents.size(), expected_results[i].size());
+        for (size_t j = 0; j < documents.size(); ++j) {
+            ASSERT_EQUAL(documents[j].id, expected_results[i][j].id);
+            ASSERT_EQUAL(documents[j].rating, expected_results[i][j].rating);
+            ASSERT(std::abs(documents[j].relevance - expected_results[i][j].relevance) < 1e-9);
+        }
+    }
+    ASSERT(search_server.FindTopDocuments("dog"s).empty());
+    ASSERT(search_server.FindTopDocuments("w30"s, DocumentStatus::kBanned).size() == 1);
+    ASSERT_EQUAL(search_server.GetDocumentText(990), "pet and rat cat w990"s);
+    ASSERT_EQUAL(std::get<0>(search_server.MatchDocument("rat w40 w41"s, 40)).size(), 2u);
+
+    // The compacted index takes modifications as usual, and cached results of before are not returned.
+    search_server.RemoveDocument(990);
+    search_server.AddDocument(1, "pet w990"s, actual, {5});
+
+    ASSERT_EQUAL(search_server.FindTopDocuments("w990 rat"s).front().id, 1);
+    ASSERT_EQUAL(search_server.GetDocumentCount(), 100);
+
+    // Readers keep using the index of the version they hold while it is compacted, and writes wait for compaction
+    // instead of getting lost.
+    {
+        std::atomic<bool> is_compacting = true;
+        std::thread reader([&search_server, &is_compacting] {
+            do {
+                ASSERT_EQUAL(search_server.FindTopDocuments("w30"s, DocumentStatus::kBanned).size(), 1u);
+                ASSERT_EQUAL(search_server.GetDocumentText(30), "pet and rat cat w30"s);
+                ASSERT_EQUAL(std::get<0>(search_server.MatchDocument("rat w40 w41"s, 40)).size(), 2u);
+            } while (is_compacting);
+        });
+        std::thread writer([&search_server] {
+            for (int i = 2000; i < 2100; ++i) {
+                search_server.AddDocument(i, "fresh w"s + std::to_string(i), DocumentStatus::kActual, {1});
+            }
+        });
+
+        for (int round = 0; round < 5; ++round) {
+            search_server.Compact();
+        }
+        writer.join();
+        is_compacting = false;
+        reader.join();
+    }
+    ASSERT_EQUAL(search_server.GetDocumentCount(), 200);
+    ASSERT_EQUAL(search_server.FindTopDocuments("fresh w2050"s).front().id, 2050);
+
+    ShardedSearchServer sharded_search_server("and"s, 3);
+
+    for (int i = 0; i < 30; ++i) {
+        sharded_search_server.AddDocument(i, "pet w"s + std::to_string(i), actual, {1});
+    }
+    for (int i = 0; i < 30; i += 2) {
+        sharded_search_server.RemoveDocument(i);
+    }
+    sharded_search_server.Compact();
+
+    ASSERT_EQUAL(sharded_search_server.GetDocumentCount(), 15);
+    ASSERT_EQUAL(sharded_search_server.GetMemoryStats().term_dictionary.object_count, 3u + 15u);
+    ASSERT_EQUAL(sharded_search_server.FindTopDocuments("w7"s).front().id, 7);
+    ASSERT(sharded_search_server.FindTopDocuments("w8"s).empty());
+}
+
+void TestMatchDocuments() {
+    SearchServer search_server("and with"s);
+    ShardedSearchServer sharded_search_server("and with"s, 3);
+    const std::vector<std::string> words = {"cat"s, "dog"s, "rat"s, "pet"s, "hair"s, "tail"s, "funny"s, "curly"s};
+    std::vector<int> document_ids;
+
+    for (int id = 0; id < 2000; ++id) {
+        std::string text = "and"s;
+
+        for (size_t word = 0; word < words.size(); ++word) {
+            if ((id >> word) % 2 == 1) {
+                text += ' ' + words[word];
+            }
+        }
+        const DocumentStatus status = id % 5 == 0 ? DocumentStatus::kBanned : DocumentStatus::kActual;
+
+        search_server.AddDocument(id, text, status, {1});
+        sharded_search_server.AddDocument(id, text, status, {1});
+        document_ids.push_back((id * 7) % 2000);
+    }
+
+    for (const std::string& query : {"funny curly cat -tail"s, "rat pet hair dog with"s, "-cat -dog"s, "cat cat"s}) {
+        const auto results = search_server.MatchDocuments(query, document_ids);
+        const auto parallel_results = search_server.MatchDocuments(std::execution::par, query, document_ids);
+        const auto sharded_results = sharded_search_server.MatchDocuments(std::execution::par, query, document_ids);
+
+        ASSERT_EQUAL(results.size(), document_ids.size());
+        ASSERT_EQUAL(sharded_results.size(), document_ids.size());
+
+        for (size_t i = 0; i < document_ids.size(); ++i) {
+            const auto [expected_words, expected_status] = search_server.MatchDocument(query, document_ids[i]);
+
+            ASSERT_EQUAL(std::get<0>(results[i]), expected_words);
+            ASSERT(std::get<1>(results[i]) == expected_status);
+            ASSERT_EQUAL(std::get<0>(parallel_results[i]), expected_words);
+            ASSERT_EQUAL(std::get<0>(sharded_results[i]), expected_words);
+            ASSERT(std::get<1>(sharded_results[i]) == expected_status);
+        }
+    }
+    ASSERT(search_server.MatchDocuments("cat"s, {}).empty());
+
+    const std::vector<int> unknown_ids = {1, 5000};
+    bool is_rejected = false;
+    try {
+        (void)search_server.MatchDocuments(std::execution::par, "cat"s, unknown_ids);
+    } catch (const std::out_of_range&) {
+        is_rejected = true;
+    }
+    ASSERT(is_rejected);
+
+    is_rejected = false;
+    try {
+        (void)sharded_search_server.MatchDocuments(std::execution::par, "cat"s, unknown_ids);
+    } catch (const std::out_of_range&) {
+        is_rejected = true;
+    }
+    ASSERT(is_rejected);
+}
+
+void TestRequestStatistics() {
+    using namespace std::chrono_literals;
+
+    RequestStatistics statistics({.window = 32s});
+    const RequestStatistics::Clock::time_point start_time = RequestStatistics::Clock::now();
+
+    // Ten requests from one thread, three of them without results, then a hundred from each of forty threads, more
+    // than there are shards, so threads share them.
+    for (int i = 1; i <= 10; ++i) {
+        statistics.Record(i <= 3 ? 0 : 5, i * 1000ns, start_time);
+    }
+    const RequestStatistics::Snapshot first_snapshot = statistics.GetSnapshot(start_time + 1s);
+
+    ASSERT_EQUAL(first_snapshot.request_count, 10u);
+    ASSERT_EQUAL(first_snapshot.no_result_count, 3u);
+    ASSERT(std::abs(first_snapshot.GetNoResultRate() - 0.3) < 1e-9);
+    ASSERT_EQUAL(first_snapshot.latency.count, 10u);
+    ASSERT_EQUAL(first_snapshot.latency.sum, 55'000u);
+    ASSERT_EQUAL(first_snapshot.latency.max, 10'000u);
+
+    const uint64_t median = first_snapshot.latency.GetPercentile(0.5);
+
+    ASSERT(median >= 5000 && median <= 5000 + 5000 / 8);
+
+    std::vector<std::thread> threads;
+
+    for (int thread = 0; thread < 40; ++thread) {
+        threads.emplace_back([&statistics, start_time] {
+            for (int i = 0; i < 100; ++i) {
+                statistics.Record(1, 1ms, start_time + 10s);
+            }
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+
+    ASSERT_EQUAL(statistics.GetSnapshot(start_time + 10s).request_count, 4010u);
+    ASSERT_EQUAL(statistics.GetSnapshot(start_time + 10s).latency.max, 1'000'000u);
+
+    // The first requests fall out of the window, which is now a full one.
+    const RequestStatistics::Snapshot later_snapshot = statistics.GetSnapshot(start_time + 35s);
+
+    ASSERT_EQUAL(later_snapshot.request_count, 4000u);
+    ASSERT_EQUAL(later_snapshot.no_result_count, 0u);
+    ASSERT(later_snapshot.duration > 31s && later_snapshot.duration <= 32s);
+    ASSERT(later_snapshot.GetRequestRate() >= 4000.0 / 32 && later_snapshot.GetRequestRate() < 4000.0 / 31);
+
+    const RequestStatistics::Snapshot empty_snapshot = statistics.GetSnapshot(start_time + 100s);
+
+    ASSERT_EQUAL(empty_snapshot.request_count, 0u);
+    ASSERT_EQUAL(empty_snapshot.latency.GetPercentile(0.99), 0u);
+    ASSERT_EQUAL(empty_snapshot.GetNoResultRate(), 0.0);
+
+    bool is_rejected = false;
+    try {
+        RequestStatistics too_short_window({.window = 1ns});
+    } catch (const std::invalid_argument&) {
+        is_rejected = true;
+    }
+    ASSERT(is_rejected);
+
+    // A queue is shared by the workers of a pool.
+    SearchServer search_server("and"s);
+
+    search_server.AddDocument(1, "funny pet and nasty rat"s, DocumentStatus::kActual, {1});
+
+    RequestQueue request_queue(search_server, {.window = 1h});
+    ThreadPool thread_pool({.worker_count = 3});
+
+    thread_pool.ParallelFor(100, [&request_queue](size_t index) {
+        (void)request_queue.AddFindRequest(index % 4 == 0 ? "cat"s : "rat"s);
+    });
+
+    ASSERT_EQUAL(request_queue.GetNoResultRequests(), 25);
+    ASSERT_EQUAL(request_queue.GetStatistics().request_count, 100u);
+    ASSERT(request_queue.GetStatistics().latency.max > 0);
+}
+
 void TestSearchServer() {
     RUN_TEST(TestSearchServerConstructorsForDeniedSymbols);
     RUN_TEST(TestAddDocumentsWithInvalidIds);
@@ -317,4 +1822,26 @@ void TestSearchServer() {
     RUN_TEST(TestMatchingDocumentsWithInvalidMinusWords);
     RUN_TEST(TestRemoveDuplicates);
     RUN_TEST(TestParallelQueries);
+    RUN_TEST(TestRemoveDocument);
+    RUN_TEST(TestParallelSearchMatchesSequential);
+    RUN_TEST(TestTopDocumentCount);
+    RUN_TEST(TestShardedSearchServer);
+    RUN_TEST(TestAddDocuments);
+    RUN_TEST(TestSegmentedIndex);
+    RUN_TEST(TestSaveAndOpenIndexFile);
+    RUN_TEST(TestDurableSearchServer);
+    RUN_TEST(TestConcurrentReadersDuringWrites);
+    RUN_TEST(TestQueryCache);
+    RUN_TEST(TestThreadPool);
+    RUN_TEST(TestBatchQueries);
+    RUN_TEST(TestTokenizer);
+    RUN_TEST(TestStopWordFilter);
+    RUN_TEST(TestScoringModels);
+    RUN_TEST(TestDocumentStore);
+    RUN_TEST(TestMemoryStats);
+    RUN_TEST(TestMetrics);
+    RUN_TEST(TestDuplicateDetection);
+    RUN_TEST(TestCompact);
+    RUN_TEST(TestMatchDocuments);
+    RUN_TEST(TestRequestStatistics);
 }
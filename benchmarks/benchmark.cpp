@@ -0,0 +1,284 @@
+// Benchmarks of the search server on a synthetic corpus. Built apart from the server's own main, for example:
+//
+//     g++ -std=c++20 -O2 -pthread -I. -o search_server_benchmark benchmarks/*.cpp
+//         $(ls *.cpp | grep -v -e main.cpp -e Test.cpp) -ltbb
+//
+// run from the repository root as one command.
+//
+// Every benchmark prints one JSON object per line to stdout, so runs of different commits can be compared line by
+// line. The first line describes the corpus options; the same options always produce the same corpus and queries.
+//
+// Options, all of the form --name=value: documents, document-length, vocabulary, zipf, stop-words, stop-word-ratio,
+// duplicate-ratio, queries, query-length, minus-word-ratio and seed set the corpus (see CorpusOptions);
+// min-time-ms is the least time measured per benchmark; filter runs only benchmarks whose names contain it.
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <execution>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <numeric>
+#include <stdexcept>
+#include <streambuf>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "corpus_generator.h"
+#include "log_duration.h"
+#include "metrics.h"
+#include "process_queries.h"
+#include "remove_duplicates.h"
+#include "search_server.h"
+#include "string_processing.h"
+
+namespace {
+
+using namespace std::string_literals;
+using benchmarks::CorpusGenerator;
+using benchmarks::CorpusOptions;
+
+struct BenchmarkOptions {
+    CorpusOptions corpus;
+    uint64_t min_time_ns = 500'000'000;
+    std::string filter;
+};
+
+// Swallows output, such as the lines RemoveDuplicates prints for every duplicate.
+class NullBuffer : public std::streambuf {
+protected:
+    int overflow(int c) override { return c; }
+};
+
+BenchmarkOptions ParseOptions(int argc, char** argv) {
+    BenchmarkOptions options;
+    CorpusOptions& corpus = options.corpus;
+    const std::map<std::string, std::function<void(const std::string&)>> setters = {
+        {"documents", [&](const std::string& value) { corpus.document_count = std::stoull(value); }},
+        {"document-length", [&](const std::string& value) { corpus.average_document_length = std::stoull(value); }},
+        {"vocabulary", [&](const std::string& value) { corpus.vocabulary_size = std::stoull(value); }},
+        {"zipf", [&](const std::string& value) { corpus.zipf_exponent = std::stod(value); }},
+        {"stop-words", [&](const std::string& value) { corpus.stop_word_count = std::stoull(value); }},
+        {"stop-word-ratio", [&](const std::string& value) { corpus.stop_word_ratio = std::stod(value); }},
+        {"duplicate-ratio", [&](const std::string& value) { corpus.duplicate_ratio = std::stod(value); }},
+        {"queries", [&](const std::string& value) { corpus.query_count = std::stoull(value); }},
+        {"query-length", [&](const std::string& value) { corpus.query_length = std::stoull(value); }},
+        {"minus-word-ratio", [&](const std::string& value) { corpus.minus_word_ratio = std::stod(value); }},
+        {"seed", [&](const std::string& value) { corpus.seed = std::stoull(value); }},
+        {"min-time-ms", [&](const std::string& value) { options.min_time_ns = std::stoull(value) * 1'000'000; }},
+        {"filter", [&](const std::string& value) { options.filter = value; }},
+    };
+
+    for (int i = 1; i < argc; ++i) {
+        const std::string_view argument = argv[i];
+        const size_t equals = argument.find('=');
+
+        if (!argument.starts_with("--") || equals == std::string_view::npos) {
+            throw std::invalid_argument("Expected --name=value, got "s + std::string(argument));
+        }
+        const auto setter = setters.find(std::string(argument.substr(2, equals - 2)));
+
+        if (setter == setters.end()) {
+            throw std::invalid_argument("Unknown option "s + std::string(argument));
+        }
+        setter->second(std::string(argument.substr(equals + 1)));
+    }
+
+    return options;
+}
+
+// Runs rounds until the operations they time add up to the minimum time, then prints the results. A round times its
+// operations itself, so preparing a round, like building the server a removal benchmark empties, is not counted.
+// Items are what an operation processes, like the queries of a ProcessQueries call; the rate is given in items.
+class BenchmarkRunner {
+public:
+    BenchmarkRunner(const BenchmarkOptions& options, std::ostream& output) : options_(options), output_(output) {}
+
+public:
+    // round(histogram) records the latency of every operation to the histogram and returns the items processed.
+    template <typename Round>
+    void Run(std::string_view name, Round round) {
+        if (name.find(options_.filter) == std::string_view::npos) {
+            return;
+        }
+        LatencyHistogram histogram;
+        uint64_t item_count = 0;
+
+        do {
+            item_count += round(histogram);
+        } while (histogram.GetSnapshot().sum < options_.min_time_ns);
+
+        const LatencyHistogram::Snapshot snapshot = histogram.GetSnapshot();
+
+        output_ << "{\"benchmark\": \"" << name << "\", \"operations\": " << snapshot.count
+                << ", \"items\": " << item_count << ", \"total_ns\": " << snapshot.sum
+                << ", \"ns_per_operation\": " << snapshot.sum / std::max<uint64_t>(snapshot.count, 1)
+                << ", \"items_per_second\": "
+                << static_cast<uint64_t>(item_count * 1e9 / std::max<uint64_t>(snapshot.sum, 1))
+                << ", \"p50_ns\": " << snapshot.GetPercentile(0.5) << ", \"p99_ns\": " << snapshot.GetPercentile(0.99)
+                << ", \"p999_ns\": " << snapshot.GetPercentile(0.999) << "}" << std::endl;
+    }
+
+private:
+    const BenchmarkOptions& options_;
+    std::ostream& output_;
+};
+
+SearchServer BuildServer(const std::string& stop_words, const std::vector<std::string>& documents) {
+    SearchServer search_server(stop_words);
+
+    for (int id = 0; id < static_cast<int>(documents.size()); ++id) {
+        search_server.AddDocument(id, documents[id], DocumentStatus::kActual, {1, 2, 3});
+    }
+
+    return search_server;
+}
+
+void RunBenchmarks(const BenchmarkOptions& options) {
+    const CorpusOptions& corpus = options.corpus;
+    CorpusGenerator generator(corpus);
+    const std::string stop_words = generator.GetStopWords();
+    const std::vector<std::string> documents = generator.GenerateDocuments();
+    const std::vector<std::string> queries = generator.GenerateQueries();
+    const auto document_count = static_cast<int>(documents.size());
+
+    std::cout << "{\"corpus\": {\"documents\": " << corpus.document_count
+              << ", \"document_length\": " << corpus.average_document_length
+              << ", \"vocabulary\": " << corpus.vocabulary_size << ", \"zipf\": " << corpus.zipf_exponent
+              << ", \"stop_words\": " << corpus.stop_word_count << ", \"stop_word_ratio\": " << corpus.stop_word_ratio
+              << ", \"duplicate_ratio\": " << corpus.duplicate_ratio << ", \"queries\": " << corpus.query_count
+              << ", \"query_length\": " << corpus.query_length
+              << ", \"minus_word_ratio\": " << corpus.minus_word_ratio << ", \"seed\": " << corpus.seed << "}}"
+              << std::endl;
+
+    BenchmarkRunner runner(options, std::cout);
+    // Results go through the filter overloads, which bypass the query cache; only the cached benchmark uses it.
+    const auto is_actual = [](int, DocumentStatus status, int) { return status == DocumentStatus::kActual; };
+
+    runner.Run("split_into_words_view", [&](LatencyHistogram& histogram) {
+        std::vector<std::string_view> words;
+
+        for (const std::string& document : documents) {
+            LOG_DURATION_HISTOGRAM(histogram);
+
+            if (!string_processing::SplitIntoWordsView(document, words)) {
+                std::abort();
+            }
+        }
+
+        return documents.size();
+    });
+
+    runner.Run("add_document", [&](LatencyHistogram& histogram) {
+        SearchServer search_server(stop_words);
+
+        for (int id = 0; id < document_count; ++id) {
+            LOG_DURATION_HISTOGRAM(histogram);
+
+            search_server.AddDocument(id, documents[id], DocumentStatus::kActual, {1, 2, 3});
+        }
+
+        return documents.size();
+    });
+
+    const SearchServer search_server = BuildServer(stop_words, documents);
+
+    runner.Run("find_top_documents/seq", [&](LatencyHistogram& histogram) {
+        for (const std::string& query : queries) {
+            LOG_DURATION_HISTOGRAM(histogram);
+
+            (void)search_server.FindTopDocuments(std::execution::seq, query, is_actual);
+        }
+
+        return queries.size();
+    });
+
+    runner.Run("find_top_documents/par", [&](LatencyHistogram& histogram) {
+        for (const std::string& query : queries) {
+            LOG_DURATION_HISTOGRAM(histogram);
+
+            (void)search_server.FindTopDocuments(std::execution::par, query, is_actual);
+        }
+
+        return queries.size();
+    });
+
+    runner.Run("find_top_documents/cached", [&](LatencyHistogram& histogram) {
+        for (const std::string& query : queries) {
+            LOG_DURATION_HISTOGRAM(histogram);
+
+            (void)search_server.FindTopDocuments(query);
+        }
+
+        return queries.size();
+    });
+
+    // Every query against a document picked by its position in the query list, the same pairs for both policies.
+    const auto run_match_document = [&](auto policy) {
+        return [&, policy](LatencyHistogram& histogram) {
+            for (size_t i = 0; i < queries.size(); ++i) {
+                const int document_id = static_cast<int>(i * 7919 % documents.size());
+                LOG_DURATION_HISTOGRAM(histogram);
+
+                (void)search_server.MatchDocument(policy, queries[i], document_id);
+            }
+
+            return queries.size();
+        };
+    };
+
+    runner.Run("match_document/seq", run_match_document(std::execution::seq));
+    runner.Run("match_document/par", run_match_document(std::execution::par));
+
+    runner.Run("process_queries", [&](LatencyHistogram& histogram) {
+        LOG_DURATION_HISTOGRAM(histogram);
+
+        (void)ProcessQueries(search_server, queries);
+
+        return queries.size();
+    });
+
+    runner.Run("remove_document", [&](LatencyHistogram& histogram) {
+        SearchServer removed_server = BuildServer(stop_words, documents);
+
+        // A fixed permutation, so removals hit segments in no particular order.
+        for (size_t i = 0; i < documents.size(); ++i) {
+            const int document_id = static_cast<int>(i * 7919 % documents.size());
+            LOG_DURATION_HISTOGRAM(histogram);
+
+            removed_server.RemoveDocument(document_id);
+        }
+
+        return documents.size();
+    });
+
+    runner.Run("remove_duplicates", [&](LatencyHistogram& histogram) {
+        SearchServer deduplicated_server = BuildServer(stop_words, documents);
+        NullBuffer null_buffer;
+        std::streambuf* const output_buffer = std::cout.rdbuf(&null_buffer);
+
+        {
+            LOG_DURATION_HISTOGRAM(histogram);
+
+            RemoveDuplicates(deduplicated_server);
+        }
+        std::cout.rdbuf(output_buffer);
+
+        return documents.size();
+    });
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    try {
+        RunBenchmarks(ParseOptions(argc, argv));
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
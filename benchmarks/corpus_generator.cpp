@@ -0,0 +1,129 @@
+#include "corpus_generator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+
+namespace benchmarks {
+
+CorpusGenerator::CorpusGenerator(const CorpusOptions& options) : options_(options), engine_(options.seed) {
+    cumulative_weights_.reserve(options_.vocabulary_size);
+
+    double total_weight = 0.0;
+
+    for (size_t rank = 1; rank <= options_.vocabulary_size; ++rank) {
+        total_weight += 1.0 / std::pow(static_cast<double>(rank), options_.zipf_exponent);
+        cumulative_weights_.push_back(total_weight);
+    }
+
+    for (double& weight : cumulative_weights_) {
+        weight /= total_weight;
+    }
+
+    // Stop words are spelled apart from vocabulary words, which are letters only.
+    for (size_t i = 0; i < options_.stop_word_count; ++i) {
+        stop_words_.push_back("s" + std::to_string(i));
+    }
+}
+
+[[nodiscard]] std::string CorpusGenerator::GetStopWords() const {
+    std::string text;
+
+    for (const std::string& stop_word : stop_words_) {
+        text += stop_word + ' ';
+    }
+
+    return text;
+}
+
+[[nodiscard]] std::vector<std::string> CorpusGenerator::GenerateDocuments() {
+    std::vector<std::string> documents;
+    std::vector<std::string> words;
+
+    documents.reserve(options_.document_count);
+
+    for (size_t i = 0; i < options_.document_count; ++i) {
+        words.clear();
+
+        if (i > 0 && NextDouble() < options_.duplicate_ratio) {
+            std::istringstream original(documents[NextBelow(i)]);
+
+            for (std::string word; original >> word;) {
+                words.push_back(word);
+            }
+            // Fisher-Yates with the generator's own uniform numbers.
+            for (size_t j = words.size(); j > 1; --j) {
+                std::swap(words[j - 1], words[NextBelow(j)]);
+            }
+        } else {
+            const size_t length =
+                options_.average_document_length / 2 + NextBelow(options_.average_document_length + 1);
+
+            for (size_t j = 0; j < length; ++j) {
+                if (!stop_words_.empty() && NextDouble() < options_.stop_word_ratio) {
+                    words.push_back(stop_words_[NextBelow(stop_words_.size())]);
+                } else {
+                    words.push_back(GetWord(NextZipfRank()));
+                }
+            }
+        }
+        std::string& document = documents.emplace_back();
+
+        for (const std::string& word : words) {
+            if (!document.empty()) {
+                document += ' ';
+            }
+            document += word;
+        }
+    }
+
+    return documents;
+}
+
+[[nodiscard]] std::vector<std::string> CorpusGenerator::GenerateQueries() {
+    std::vector<std::string> queries;
+
+    queries.reserve(options_.query_count);
+
+    for (size_t i = 0; i < options_.query_count; ++i) {
+        std::string& query = queries.emplace_back();
+
+        for (size_t j = 0; j < options_.query_length; ++j) {
+            if (!query.empty()) {
+                query += ' ';
+            }
+            if (NextDouble() < options_.minus_word_ratio) {
+                query += '-';
+            }
+            query += GetWord(NextZipfRank());
+        }
+    }
+
+    return queries;
+}
+
+[[nodiscard]] std::string CorpusGenerator::GetWord(size_t rank) {
+    std::string word;
+
+    // Bijective base 26: a, b, ..., z, aa, ab, ...
+    for (size_t number = rank + 1; number > 0; number = (number - 1) / 26) {
+        word += static_cast<char>('a' + (number - 1) % 26);
+    }
+    std::reverse(word.begin(), word.end());
+
+    return word;
+}
+
+[[nodiscard]] double CorpusGenerator::NextDouble() { return static_cast<double>(engine_() >> 11) * 0x1.0p-53; }
+
+[[nodiscard]] size_t CorpusGenerator::NextBelow(size_t bound) {
+    return static_cast<size_t>(NextDouble() * static_cast<double>(bound));
+}
+
+[[nodiscard]] size_t CorpusGenerator::NextZipfRank() {
+    const auto it = std::upper_bound(cumulative_weights_.begin(), cumulative_weights_.end(), NextDouble());
+
+    return std::min(static_cast<size_t>(it - cumulative_weights_.begin()), cumulative_weights_.size() - 1);
+}
+
+}  // namespace benchmarks
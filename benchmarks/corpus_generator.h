@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace benchmarks {
+
+struct CorpusOptions {
+    size_t document_count = 20000;
+    // Document lengths in words are spread evenly between half and one and a half times the average.
+    size_t average_document_length = 60;
+    size_t vocabulary_size = 50000;
+    // Exponent s of the Zipf distribution of words: the word of rank k is drawn with probability proportional to
+    // 1 / k^s. Natural language is close to 1.
+    double zipf_exponent = 1.0;
+    size_t stop_word_count = 30;
+    // Share of the words of a document drawn from the stop words rather than from the vocabulary.
+    double stop_word_ratio = 0.3;
+    // Share of documents that repeat the words of an earlier document in another order, for RemoveDuplicates.
+    double duplicate_ratio = 0.05;
+    size_t query_count = 1000;
+    size_t query_length = 4;
+    // Share of query words that are minus words.
+    double minus_word_ratio = 0.1;
+    uint64_t seed = 42;
+};
+
+// Generates the same corpus and queries for the same options on every platform: the engine is std::mt19937_64,
+// whose output the standard fixes, and every distribution is computed here rather than by the standard library,
+// whose distributions differ between implementations. Words are letter strings numbered by their frequency rank.
+class CorpusGenerator {
+public:
+    explicit CorpusGenerator(const CorpusOptions& options);
+
+public:
+    // Space-separated, as SearchServer takes them.
+    [[nodiscard]] std::string GetStopWords() const;
+
+    [[nodiscard]] std::vector<std::string> GenerateDocuments();
+
+    [[nodiscard]] std::vector<std::string> GenerateQueries();
+
+    // Name of the word of the given rank among words, stop words excluded.
+    [[nodiscard]] static std::string GetWord(size_t rank);
+
+private:
+    // Uniform on [0, 1), from the top 53 bits of the engine output.
+    [[nodiscard]] double NextDouble();
+
+    // Uniform on [0, bound).
+    [[nodiscard]] size_t NextBelow(size_t bound);
+
+    [[nodiscard]] size_t NextZipfRank();
+
+private:
+    CorpusOptions options_;
+    std::mt19937_64 engine_;
+    // Cumulative Zipf weights of the vocabulary, normalized to end at 1.
+    std::vector<double> cumulative_weights_;
+    std::vector<std::string> stop_words_;
+};
+
+}  // namespace benchmarks
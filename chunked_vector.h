@@ -0,0 +1,79 @@
+#pragma once
+
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <memory>
+#include <utility>
+
+#include "memory_stats.h"
+
+// Append-only array whose elements never move. Storage grows by chunks of doubling size, so appending never
+// relocates what is already stored, and an element may be read by other threads while the owner appends after it.
+// Readers learn how many elements they may read from the index version they hold, never from size(), which belongs to
+// the writer.
+//
+// Chunks are allocated with default-constructed elements: appending assigns the next one in place.
+template <typename T>
+class ChunkedVector {
+public:
+    ChunkedVector() = default;
+
+public:
+    T& emplace_back() {
+        const auto [chunk, offset] = Locate(size_);
+
+        if (!chunks_[chunk]) {
+            chunks_[chunk] = std::make_unique<T[]>(kFirstChunkSize << chunk);
+        }
+        ++size_;
+
+        return chunks_[chunk][offset];
+    }
+
+    void push_back(T value) { emplace_back() = std::move(value); }
+
+    T& operator[](size_t index) {
+        const auto [chunk, offset] = Locate(index);
+
+        return chunks_[chunk][offset];
+    }
+
+    const T& operator[](size_t index) const {
+        const auto [chunk, offset] = Locate(index);
+
+        return chunks_[chunk][offset];
+    }
+
+    [[nodiscard]] size_t size() const { return size_; }
+
+    [[nodiscard]] bool empty() const { return size_ == 0; }
+
+    // Memory of the allocated chunks, whatever the elements themselves point to.
+    [[nodiscard]] MemoryUsage GetMemoryUsage() const {
+        MemoryUsage usage{0, size_, 0};
+
+        for (size_t chunk = 0; chunk < kMaxChunkCount && chunks_[chunk]; ++chunk) {
+            usage.bytes += (kFirstChunkSize << chunk) * sizeof(T);
+            ++usage.allocation_count;
+        }
+
+        return usage;
+    }
+
+private:
+    static constexpr size_t kFirstChunkSize = 64;
+    static constexpr size_t kMaxChunkCount = 32;
+
+private:
+    // Chunk i holds kFirstChunkSize << i elements and starts after kFirstChunkSize * (2^i - 1) of them.
+    [[nodiscard]] static std::pair<size_t, size_t> Locate(size_t index) {
+        const size_t chunk = std::bit_width(index / kFirstChunkSize + 1) - 1;
+
+        return {chunk, index - kFirstChunkSize * ((size_t{1} << chunk) - 1)};
+    }
+
+private:
+    std::array<std::unique_ptr<T[]>, kMaxChunkCount> chunks_;
+    size_t size_ = 0;
+};
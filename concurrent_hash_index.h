@@ -0,0 +1,209 @@
+#pragma once
+
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <utility>
+
+#include "epoch.h"
+#include "memory_stats.h"
+
+// Open-addressing hash table from keys to 32-bit values, filled by one writer while any number of threads look values
+// up without locking. Keys are not stored: a value identifies its key through the key_of function passed to every
+// call, so the table indexes data kept elsewhere, such as terms or documents stored by number.
+//
+// A value is published with a single atomic store after the data key_of reads for it, so a reader finds either the
+// previous value of a key or the new one. An erased entry leaves a marker that lookups probe past and new keys reuse.
+// When the table grows, or is rebuilt to clear markers once live entries take at most a quarter of it, readers that
+// are still probing the old one keep seeing the entries it had: the old table is retired to the epoch passed to Insert
+// and released once no reader of an older version is left, so the index holds only the current table.
+template <typename Key, typename Hash = std::hash<Key>>
+class ConcurrentHashIndex {
+public:
+    static constexpr uint32_t kNotFound = std::numeric_limits<uint32_t>::max();
+
+public:
+    ConcurrentHashIndex() = default;
+
+    // Moving is meant for building an index before it is shared and is not safe against concurrent readers.
+    ConcurrentHashIndex(ConcurrentHashIndex&& other) noexcept
+        : owned_table_(std::move(other.owned_table_)),
+          table_(other.table_.exchange(nullptr)),
+          size_(std::exchange(other.size_, 0)),
+          erased_count_(std::exchange(other.erased_count_, 0)) {}
+
+    ConcurrentHashIndex& operator=(ConcurrentHashIndex&& other) noexcept {
+        owned_table_ = std::move(other.owned_table_);
+        table_ = other.table_.exchange(nullptr);
+        size_ = std::exchange(other.size_, 0);
+        erased_count_ = std::exchange(other.erased_count_, 0);
+        return *this;
+    }
+
+public:
+    template <typename KeyOf>
+    [[nodiscard]] uint32_t Find(const Key& key, const KeyOf& key_of) const {
+        const Table* table = table_.load(std::memory_order_acquire);
+
+        if (table == nullptr) {
+            return kNotFound;
+        }
+
+        for (size_t slot = GetHomeSlot(*table, key);; slot = (slot + 1) & table->mask) {
+            const uint32_t value = table->slots[slot].load(std::memory_order_acquire);
+
+            if (value == kNotFound || (value != kErased && key_of(value) == key)) {
+                return value;
+            }
+        }
+    }
+
+    // Maps the key to the value, replacing the value an equal key had. A table replaced meanwhile is retired to the
+    // epoch.
+    template <typename KeyOf>
+    void Insert(const Key& key, uint32_t value, const KeyOf& key_of, Epoch& epoch) {
+        if (owned_table_ == nullptr ||
+            (size_ + erased_count_ + 1) * kMaxLoadDenominator > (owned_table_->mask + 1) * kMaxLoadNumerator) {
+            Grow(key_of, epoch);
+        }
+        const Table& table = *owned_table_;
+        std::atomic<uint32_t>* erased_slot = nullptr;
+
+        for (size_t slot = GetHomeSlot(table, key);; slot = (slot + 1) & table.mask) {
+            const uint32_t current = table.slots[slot].load(std::memory_order_relaxed);
+
+            if (current == kErased) {
+                erased_slot = erased_slot != nullptr ? erased_slot : &table.slots[slot];
+            } else if (current == kNotFound) {
+                // A new key takes the first erased slot on its probe sequence, if there is one.
+                if (erased_slot != nullptr) {
+                    --erased_count_;
+                } else {
+                    erased_slot = &table.slots[slot];
+                }
+                ++size_;
+                erased_slot->store(value, std::memory_order_release);
+                return;
+            } else if (key_of(current) == key) {
+                table.slots[slot].store(value, std::memory_order_release);
+                return;
+            }
+        }
+    }
+
+    // Removes the key, if present. Lookups that already read its value may still return it.
+    template <typename KeyOf>
+    void Erase(const Key& key, const KeyOf& key_of) {
+        if (owned_table_ == nullptr) {
+            return;
+        }
+        const Table& table = *owned_table_;
+
+        for (size_t slot = GetHomeSlot(table, key);; slot = (slot + 1) & table.mask) {
+            const uint32_t current = table.slots[slot].load(std::memory_order_relaxed);
+
+            if (current == kNotFound) {
+                return;
+            }
+
+            if (current != kErased && key_of(current) == key) {
+                table.slots[slot].store(kErased, std::memory_order_release);
+                --size_;
+                ++erased_count_;
+                return;
+            }
+        }
+    }
+
+    [[nodiscard]] size_t size() const { return size_; }
+
+    // Tables retired to an epoch are not included.
+    [[nodiscard]] MemoryUsage GetMemoryUsage() const {
+        MemoryUsage usage;
+
+        usage.object_count = size_;
+
+        if (owned_table_ != nullptr) {
+            usage.bytes = sizeof(Table) + (owned_table_->mask + 1) * sizeof(std::atomic<uint32_t>);
+            usage.allocation_count = 2;
+        }
+
+        return usage;
+    }
+
+private:
+    struct Table {
+        size_t mask = 0;
+        int shift = 0;
+        std::unique_ptr<std::atomic<uint32_t>[]> slots;
+    };
+
+private:
+    static constexpr size_t kInitialCapacity = 16;
+    static constexpr size_t kMaxLoadNumerator = 1;
+    static constexpr size_t kMaxLoadDenominator = 2;
+    // Value of a slot whose entry was erased; never a value of an entry, as kNotFound is not.
+    static constexpr uint32_t kErased = kNotFound - 1;
+
+private:
+    // Fibonacci hashing spreads the sequential numbers std::hash returns for integers over the whole table.
+    [[nodiscard]] static size_t GetHomeSlot(const Table& table, const Key& key) {
+        return static_cast<size_t>((static_cast<uint64_t>(Hash{}(key)) * 0x9E3779B97F4A7C15ull) >> table.shift);
+    }
+
+    template <typename KeyOf>
+    void Grow(const KeyOf& key_of, Epoch& epoch) {
+        size_t capacity = owned_table_ == nullptr ? kInitialCapacity : owned_table_->mask + 1;
+
+        // Live entries alone may leave enough room, if many were erased.
+        if ((size_ + 1) * kMaxLoadDenominator * 2 > capacity * kMaxLoadNumerator) {
+            capacity *= 2;
+        }
+        auto table = std::make_unique<Table>();
+
+        table->mask = capacity - 1;
+        table->shift = 64 - std::countr_zero(capacity);
+        table->slots = std::make_unique<std::atomic<uint32_t>[]>(capacity);
+
+        for (size_t slot = 0; slot < capacity; ++slot) {
+            table->slots[slot].store(kNotFound, std::memory_order_relaxed);
+        }
+
+        if (owned_table_ != nullptr) {
+            const Table& old_table = *owned_table_;
+
+            for (size_t old_slot = 0; old_slot <= old_table.mask; ++old_slot) {
+                const uint32_t value = old_table.slots[old_slot].load(std::memory_order_relaxed);
+
+                if (value == kNotFound || value == kErased) {
+                    continue;
+                }
+                size_t slot = GetHomeSlot(*table, key_of(value));
+
+                while (table->slots[slot].load(std::memory_order_relaxed) != kNotFound) {
+                    slot = (slot + 1) & table->mask;
+                }
+                table->slots[slot].store(value, std::memory_order_relaxed);
+            }
+        }
+        table_.store(table.get(), std::memory_order_release);
+
+        // Readers that loaded the old table before the store above hold a version of the epoch or an older one.
+        if (owned_table_ != nullptr) {
+            epoch.Retire(std::move(owned_table_));
+        }
+        owned_table_ = std::move(table);
+        erased_count_ = 0;
+    }
+
+private:
+    std::shared_ptr<const Table> owned_table_;
+    std::atomic<const Table*> table_ = nullptr;
+    size_t size_ = 0;
+    // Erased slots of the current table, counted towards its load: probes pass them as if they were occupied.
+    size_t erased_count_ = 0;
+};
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstddef>
+#include <span>
+#include <vector>
+
+#include "memory_stats.h"
+
+// Array that either owns its elements or views immutable memory owned elsewhere, such as a memory-mapped index file.
+// Reads go through a span in both cases; the first mutable access copies viewed elements into owned storage, so data
+// that is never modified is never copied.
+template <typename T>
+class CowArray {
+public:
+    CowArray() = default;
+
+    explicit CowArray(std::vector<T> elements) : elements_(std::move(elements)) {}
+
+    explicit CowArray(std::span<const T> view) : view_(view), is_view_(true) {}
+
+public:
+    [[nodiscard]] std::span<const T> GetSpan() const { return is_view_ ? view_ : std::span<const T>(elements_); }
+
+    [[nodiscard]] std::vector<T>& GetMutable() {
+        if (is_view_) {
+            elements_.assign(view_.begin(), view_.end());
+            view_ = {};
+            is_view_ = false;
+        }
+        return elements_;
+    }
+
+    [[nodiscard]] bool IsView() const { return is_view_; }
+
+    [[nodiscard]] size_t size() const { return is_view_ ? view_.size() : elements_.size(); }
+
+    [[nodiscard]] bool empty() const { return size() == 0; }
+
+    // Viewed elements are counted as objects but take no heap memory.
+    [[nodiscard]] MemoryUsage GetMemoryUsage() const {
+        return is_view_ ? MemoryUsage{0, view_.size(), 0} : ::GetMemoryUsage(elements_);
+    }
+
+    const T& operator[](size_t index) const { return is_view_ ? view_[index] : elements_[index]; }
+
+private:
+    std::vector<T> elements_;
+    std::span<const T> view_;
+    bool is_view_ = false;
+};
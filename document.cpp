@@ -1,9 +1,21 @@
 #include "document.h"
 
+#include <cmath>
+
 using namespace std::string_literals;
 
 Document::Document(int id, double relevance, int rating) : id(id), relevance(relevance), rating(rating) {}
 
+bool IsMoreRelevant(const Document& lhs, const Document& rhs) {
+    if (std::abs(lhs.relevance - rhs.relevance) < kRelevanceAccuracy) {
+        // Documents equal by relevance and rating are ordered by id, so every evaluation strategy returns them in
+        // the same order.
+        return lhs.rating != rhs.rating ? lhs.rating > rhs.rating : lhs.id < rhs.id;
+    }
+
+    return lhs.relevance > rhs.relevance;
+}
+
 std::ostream& operator<<(std::ostream& out, const Document& document) {
     out << "{ "s
         << "document_id = "s << document.id << ", "s
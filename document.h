@@ -18,6 +18,12 @@ struct Document {
     int rating = 0;
 };
 
+// Relevance values closer than this are considered equal and the documents are ranked by rating instead.
+const double kRelevanceAccuracy = 1e-6;
+
+// Ranking order of search results: by relevance, then by rating, then by id.
+bool IsMoreRelevant(const Document& lhs, const Document& rhs);
+
 std::ostream& operator<<(std::ostream& out, const Document& document);
 
 void PrintDocument(const Document& document);
\ No newline at end of file
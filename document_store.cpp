@@ -0,0 +1,283 @@
+#include "document_store.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+namespace {
+
+// Sequences of the codec: a token byte with the literal count in its high and the match length less kMinMatch in its
+// low nibble, each extended by bytes of 255 and a remainder when it reaches 15; the literals; a two-byte offset back
+// into the output and the match length extension. The last sequence of a block has literals only.
+constexpr size_t kMinMatch = 4;
+constexpr size_t kMaxOffset = 0xFFFF;
+constexpr int kHashBits = 14;
+constexpr uint32_t kNoPosition = UINT32_MAX;
+
+uint32_t Load32(const char* data) {
+    uint32_t value = 0;
+
+    std::memcpy(&value, data, sizeof(value));
+
+    return value;
+}
+
+uint32_t HashSequence(uint32_t sequence) { return (sequence * 2654435761u) >> (32 - kHashBits); }
+
+void AppendLength(std::string& output, size_t length) {
+    for (; length >= 255; length -= 255) {
+        output.push_back(static_cast<char>(255));
+    }
+    output.push_back(static_cast<char>(length));
+}
+
+void AppendSequence(std::string& output, std::span<const char> literals, size_t offset, size_t match_length) {
+    const size_t match_code = match_length == 0 ? 0 : match_length - kMinMatch;
+
+    const size_t token = (std::min<size_t>(literals.size(), 15) << 4) | std::min<size_t>(match_code, 15);
+
+    output.push_back(static_cast<char>(token));
+
+    if (literals.size() >= 15) {
+        AppendLength(output, literals.size() - 15);
+    }
+    output.append(literals.data(), literals.size());
+
+    if (match_length == 0) {
+        return;
+    }
+    output.push_back(static_cast<char>(offset & 0xFF));
+    output.push_back(static_cast<char>(offset >> 8));
+
+    if (match_code >= 15) {
+        AppendLength(output, match_code - 15);
+    }
+}
+
+// Greedy parse: every position is looked up in a table of the last position each hashed four-byte sequence was seen
+// at, and a verified match is extended as far as it goes.
+std::string Compress(std::span<const char> input) {
+    std::vector<uint32_t> positions(size_t{1} << kHashBits, kNoPosition);
+    std::string output;
+    size_t anchor = 0;
+    size_t position = 0;
+
+    output.reserve(input.size() / 2);
+
+    while (position + kMinMatch <= input.size()) {
+        const uint32_t sequence = Load32(input.data() + position);
+        uint32_t& candidate = positions[HashSequence(sequence)];
+        const uint32_t match_position = candidate;
+
+        candidate = static_cast<uint32_t>(position);
+
+        if (match_position == kNoPosition || position - match_position > kMaxOffset ||
+            Load32(input.data() + match_position) != sequence) {
+            ++position;
+            continue;
+        }
+        size_t match_length = kMinMatch;
+
+        while (position + match_length < input.size() &&
+               input[match_position + match_length] == input[position + match_length]) {
+            ++match_length;
+        }
+        AppendSequence(output, input.subspan(anchor, position - anchor), position - match_position, match_length);
+        position += match_length;
+        anchor = position;
+    }
+
+    if (anchor < input.size()) {
+        AppendSequence(output, input.subspan(anchor), 0, 0);
+    }
+
+    return output;
+}
+
+size_t ReadLength(std::span<const char> input, size_t& position, size_t length) {
+    if (length < 15) {
+        return length;
+    }
+    uint8_t byte = 0;
+
+    do {
+        byte = static_cast<uint8_t>(input[position++]);
+        length += byte;
+    } while (byte == 255);
+
+    return length;
+}
+
+void Decompress(std::span<const char> input, std::span<char> output) {
+    size_t position = 0;
+    size_t written = 0;
+
+    while (written < output.size()) {
+        const auto token = static_cast<uint8_t>(input[position++]);
+        const size_t literal_count = ReadLength(input, position, token >> 4);
+
+        std::memcpy(output.data() + written, input.data() + position, literal_count);
+        position += literal_count;
+        written += literal_count;
+
+        if (written == output.size()) {
+            break;
+        }
+        const size_t offset =
+            static_cast<uint8_t>(input[position]) | static_cast<size_t>(static_cast<uint8_t>(input[position + 1])) << 8;
+        position += 2;
+
+        const size_t match_length = ReadLength(input, position, token & 0x0F) + kMinMatch;
+
+        assert(offset != 0 && offset <= written && written + match_length <= output.size());
+
+        // Byte by byte: a match may overlap the bytes it produces.
+        for (size_t i = 0; i < match_length; ++i, ++written) {
+            output[written] = output[written - offset];
+        }
+    }
+}
+
+}  // namespace
+
+DocumentStore::Reader::Reader(const DocumentStore& store) : store_(store) {}
+
+[[nodiscard]] std::string_view DocumentStore::Reader::Read(TextLocation location) {
+    const OpenBlock* open_block = store_.open_block_.load(std::memory_order_acquire);
+
+    if (open_block != nullptr && open_block->index == location.block) {
+        return {open_block->data.get() + location.offset, location.length};
+    }
+    const Block& block = store_.blocks_[location.block];
+
+    if (!block.is_compressed) {
+        return {block.view.data() + location.offset, location.length};
+    }
+
+    if (!has_cached_block_ || cached_block_ != location.block) {
+        buffer_.resize(block.size);
+        Decompress(block.data, buffer_);
+        cached_block_ = location.block;
+        has_cached_block_ = true;
+    }
+
+    return {buffer_.data() + location.offset, location.length};
+}
+
+DocumentStore::DocumentStore() = default;
+
+DocumentStore::DocumentStore(DocumentStore&& other) noexcept
+    : blocks_(std::move(other.blocks_)),
+      open_block_(other.open_block_.load()),
+      open_block_owner_(std::move(other.open_block_owner_)),
+      open_block_size_(other.open_block_size_),
+      text_size_(other.text_size_),
+      text_count_(other.text_count_),
+      stored_size_(other.stored_size_) {}
+
+[[nodiscard]] TextLocation DocumentStore::Append(std::string_view text, Epoch& epoch) {
+    if (!open_block_owner_ || open_block_size_ + text.size() > open_block_owner_->capacity) {
+        OpenNextBlock(std::max(kBlockSize, text.size()), epoch);
+    }
+    const TextLocation location{open_block_owner_->index, static_cast<uint32_t>(text.size()), open_block_size_};
+
+    std::copy(text.begin(), text.end(), open_block_owner_->data.get() + open_block_size_);
+    open_block_size_ += text.size();
+    text_size_ += text.size();
+    ++text_count_;
+
+    return location;
+}
+
+[[nodiscard]] TextLocation DocumentStore::Append(std::string&& text, Epoch& epoch) {
+    if (text.size() < kBlockSize) {
+        return Append(std::string_view(text), epoch);
+    }
+    OpenNextBlock(0, epoch);
+
+    const TextLocation location{static_cast<uint32_t>(blocks_.size()), static_cast<uint32_t>(text.size()), 0};
+
+    Block& block = blocks_.emplace_back();
+
+    text_size_ += text.size();
+    ++text_count_;
+    FillBlock(block, std::move(text));
+    stored_size_ += block.data.size();
+    // As after a view, the open block has to follow.
+    OpenNextBlock(0, epoch);
+
+    return location;
+}
+
+[[nodiscard]] uint32_t DocumentStore::AddView(std::span<const char> texts, Epoch& epoch) {
+    OpenNextBlock(0, epoch);
+
+    const auto index = static_cast<uint32_t>(blocks_.size());
+    Block& block = blocks_.emplace_back();
+
+    block.view = texts;
+    block.size = static_cast<uint32_t>(std::min<size_t>(texts.size(), UINT32_MAX));
+    // The open block has to follow the view, which took the index it was opened with.
+    OpenNextBlock(0, epoch);
+
+    return index;
+}
+
+[[nodiscard]] uint64_t DocumentStore::GetTextSize() const { return text_size_; }
+
+[[nodiscard]] uint64_t DocumentStore::GetStoredSize() const { return stored_size_; }
+
+[[nodiscard]] MemoryUsage DocumentStore::GetMemoryUsage() const {
+    MemoryUsage usage = blocks_.GetMemoryUsage();
+
+    usage.object_count = text_count_;
+
+    for (size_t i = 0; i < blocks_.size(); ++i) {
+        const MemoryUsage block_usage = ::GetMemoryUsage(blocks_[i].data);
+
+        usage.bytes += block_usage.bytes;
+        usage.allocation_count += block_usage.allocation_count;
+    }
+
+    if (open_block_owner_) {
+        usage.bytes += sizeof(OpenBlock) + open_block_owner_->capacity;
+        usage.allocation_count += 2;
+    }
+
+    return usage;
+}
+
+void DocumentStore::FillBlock(Block& block, std::string&& text) {
+    std::string compressed = Compress(text);
+
+    block.size = static_cast<uint32_t>(text.size());
+    block.is_compressed = compressed.size() < text.size();
+
+    if (block.is_compressed) {
+        block.data = std::move(compressed);
+    } else {
+        block.data = std::move(text);
+        block.view = block.data;
+    }
+}
+
+void DocumentStore::OpenNextBlock(size_t capacity, Epoch& epoch) {
+    if (open_block_size_ > 0) {
+        Block& block = blocks_.emplace_back();
+
+        FillBlock(block, std::string(open_block_owner_->data.get(), open_block_size_));
+        stored_size_ += block.data.size();
+    }
+    auto open_block = std::make_shared<OpenBlock>();
+
+    open_block->index = static_cast<uint32_t>(blocks_.size());
+    open_block->capacity = capacity;
+    open_block->data = std::make_unique<char[]>(capacity);
+    open_block_.store(open_block.get(), std::memory_order_release);
+
+    if (open_block_owner_) {
+        epoch.Retire(std::move(open_block_owner_));
+    }
+    open_block_owner_ = std::move(open_block);
+    open_block_size_ = 0;
+}
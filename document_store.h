@@ -0,0 +1,107 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "chunked_vector.h"
+#include "epoch.h"
+#include "memory_stats.h"
+
+// Position of a document text in a DocumentStore.
+struct TextLocation {
+    uint32_t block = 0;
+    uint32_t length = 0;
+    uint64_t offset = 0;
+};
+
+// Append-only storage of document texts. Texts are packed one after another into blocks of kBlockSize bytes; once a
+// block fills up it is compressed with a byte-oriented LZ77 codec in the manner of LZ4 and the packing buffer is
+// released. The index never reads texts while searching: terms live in the dictionary, so texts are only decompressed
+// when they are asked for. Texts of an opened index file are viewed in place as an uncompressed block instead.
+//
+// One writer appends while any number of readers read texts appended before the version they hold. The block being
+// packed is reached through an atomic pointer and retired to the epoch when it is sealed, so readers never wait.
+class DocumentStore {
+public:
+    static constexpr size_t kBlockSize = 64 * 1024;
+
+    // Reads texts, keeping the block it decompressed last: texts of neighbouring documents usually share a block.
+    class Reader {
+    public:
+        explicit Reader(const DocumentStore& store);
+
+    public:
+        // The view stays valid until the next call and while the caller holds the index version the location is from.
+        [[nodiscard]] std::string_view Read(TextLocation location);
+
+    private:
+        const DocumentStore& store_;
+        uint32_t cached_block_ = 0;
+        bool has_cached_block_ = false;
+        std::vector<char> buffer_;
+    };
+
+public:
+    DocumentStore();
+
+    // Moving is not synchronized: no other thread may use either store meanwhile.
+    DocumentStore(DocumentStore&& other) noexcept;
+
+public:
+    // Packs the text into the current block; a sealed block is compressed and its packing buffer retired to the epoch.
+    [[nodiscard]] TextLocation Append(std::string_view text, Epoch& epoch);
+
+    // Takes ownership of the text. A text of at least kBlockSize bytes becomes a block of its own without being copied
+    // into the packing buffer; it is kept as is unless compression shrinks it.
+    [[nodiscard]] TextLocation Append(std::string&& text, Epoch& epoch);
+
+    // Adds memory that outlives the store, such as a mapped index file, as a block of its own and returns its index.
+    [[nodiscard]] uint32_t AddView(std::span<const char> texts, Epoch& epoch);
+
+    // Bytes of text appended so far, and bytes the store holds for them after compression. Called by the writer.
+    [[nodiscard]] uint64_t GetTextSize() const;
+
+    [[nodiscard]] uint64_t GetStoredSize() const;
+
+    // Objects are the texts appended; views take no heap memory. Called by the writer.
+    [[nodiscard]] MemoryUsage GetMemoryUsage() const;
+
+private:
+    // Sealed block: compressed or raw owned bytes, or a view of memory held elsewhere.
+    struct Block {
+        std::string data;
+        std::span<const char> view;
+        uint32_t size = 0;
+        bool is_compressed = false;
+    };
+
+    struct OpenBlock {
+        uint32_t index = 0;
+        size_t capacity = 0;
+        std::unique_ptr<char[]> data;
+    };
+
+private:
+    // Compresses the text into the block, or keeps it raw if that does not make it smaller.
+    static void FillBlock(Block& block, std::string&& text);
+
+    // Seals the open block, if it holds anything, and opens block index with at least the given capacity.
+    void OpenNextBlock(size_t capacity, Epoch& epoch);
+
+private:
+    ChunkedVector<Block> blocks_;
+    std::atomic<const OpenBlock*> open_block_ = nullptr;
+
+    // Writer state.
+    std::shared_ptr<OpenBlock> open_block_owner_;
+    size_t open_block_size_ = 0;
+    uint64_t text_size_ = 0;
+    size_t text_count_ = 0;
+    uint64_t stored_size_ = 0;
+};
@@ -0,0 +1,263 @@
+#include "durable_search_server.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <filesystem>
+#include <stdexcept>
+#include <system_error>
+#include <utility>
+
+namespace {
+
+const std::string kSnapshotPrefix = "snapshot-";
+const std::string kSnapshotSuffix = ".idx";
+const std::string kLogPrefix = "log-";
+const std::string kLogSuffix = ".wal";
+
+// Generation encoded in a snapshot or log file name, or 0 if the name has a different form.
+[[nodiscard]] uint64_t ParseGeneration(std::string_view file_name, std::string_view prefix, std::string_view suffix) {
+    if (file_name.size() <= prefix.size() + suffix.size() || !file_name.starts_with(prefix) ||
+        !file_name.ends_with(suffix)) {
+        return 0;
+    }
+    const std::string_view number = file_name.substr(prefix.size(), file_name.size() - prefix.size() - suffix.size());
+    uint64_t generation = 0;
+    const auto [end, error] = std::from_chars(number.data(), number.data() + number.size(), generation);
+
+    return error == std::errc() && end == number.data() + number.size() ? generation : 0;
+}
+
+[[nodiscard]] uint64_t FindLatestSnapshotGeneration(const std::string& directory) {
+    std::filesystem::create_directories(directory);
+
+    uint64_t latest_generation = 0;
+
+    for (const auto& entry : std::filesystem::directory_iterator(directory)) {
+        latest_generation = std::max(latest_generation, ParseGeneration(entry.path().filename().string(),
+                                                                         kSnapshotPrefix, kSnapshotSuffix));
+    }
+
+    return latest_generation;
+}
+
+// Makes file creations, renames and removals in the directory durable.
+void SyncDirectory(const std::string& directory) {
+    const int descriptor = ::open(directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+
+    if (descriptor < 0 || ::fsync(descriptor) != 0) {
+        const int error = errno;
+
+        if (descriptor >= 0) {
+            ::close(descriptor);
+        }
+        throw std::system_error(error, std::generic_category(), "Cannot sync directory " + directory);
+    }
+    ::close(descriptor);
+}
+}  // namespace
+
+DurableSearchServer::DurableSearchServer(const std::string& directory, const std::string& stop_words_text)
+    : DurableSearchServer(directory, stop_words_text, Options{}) {}
+
+DurableSearchServer::DurableSearchServer(const std::string& directory, const std::string& stop_words_text,
+                                         Options options)
+    : directory_(directory),
+      options_(options),
+      generation_(FindLatestSnapshotGeneration(directory)),
+      index_(generation_ > 0 ? SearchServer::OpenFile(GetSnapshotPath(generation_)) : SearchServer(stop_words_text)) {
+    // Files of older generations and unfinished snapshots are left behind by a crash during a checkpoint.
+    RemoveGenerationsBefore(generation_);
+
+    std::vector<uint64_t> log_generations;
+
+    for (const auto& entry : std::filesystem::directory_iterator(directory_)) {
+        const std::string file_name = entry.path().filename().string();
+
+        if (file_name.ends_with(".tmp")) {
+            std::filesystem::remove(entry.path());
+        } else if (file_name.starts_with(kLogPrefix)) {
+            log_generations.push_back(ParseGeneration(file_name, kLogPrefix, kLogSuffix));
+        }
+    }
+    std::sort(log_generations.begin(), log_generations.end());
+
+    for (size_t i = 0; i < log_generations.size(); ++i) {
+        generation_ = log_generations[i];
+
+        const bool is_intact = MutationLog::Replay(GetLogPath(generation_), [this](const MutationLog::Record& record) {
+            switch (record.type) {
+                case MutationLog::RecordType::kAddDocument:
+                    try {
+                        index_.AddDocument(record.document_id, record.text, record.status, record.ratings);
+                    } catch (const std::invalid_argument&) {
+                        // Rejected when it was made as well.
+                    }
+                    break;
+                case MutationLog::RecordType::kRemoveDocument:
+                    index_.RemoveDocument(record.document_id);
+                    break;
+            }
+        });
+
+        // Later logs only hold mutations made after the torn end of this one, none of which was acknowledged.
+        if (!is_intact) {
+            for (size_t j = i + 1; j < log_generations.size(); ++j) {
+                std::filesystem::remove(GetLogPath(log_generations[j]));
+            }
+            break;
+        }
+    }
+    log_ = std::make_shared<MutationLog>(GetLogPath(generation_), options_.sync_interval);
+    SyncDirectory(directory_);
+    checkpoint_thread_ = std::thread([this] { RunCheckpointLoop(); });
+}
+
+DurableSearchServer::~DurableSearchServer() {
+    {
+        std::lock_guard guard(mutex_);
+        is_stopping_ = true;
+    }
+    checkpoint_requested_.notify_one();
+    checkpoint_thread_.join();
+}
+
+void DurableSearchServer::AddDocument(int document_id, const std::string_view document,
+                                      DocumentStatus document_status, const std::vector<int>& document_ratings) {
+    std::lock_guard guard(mutex_);
+
+    log_->AppendAddDocument(document_id, document, document_status, document_ratings);
+    index_.AddDocument(document_id, document, document_status, document_ratings);
+    RequestCheckpointIfNeeded();
+}
+
+void DurableSearchServer::RemoveDocument(int document_id) {
+    std::lock_guard guard(mutex_);
+
+    // Removing an unknown document changes nothing and is not worth a record.
+    if (index_.FindDocumentOrdinal(*index_.PinVersion(), document_id) == SearchServer::kNoOrdinal) {
+        return;
+    }
+    log_->AppendRemoveDocument(document_id);
+    index_.RemoveDocument(document_id);
+    RequestCheckpointIfNeeded();
+}
+
+void DurableSearchServer::Sync() {
+    std::shared_ptr<MutationLog> previous_log;
+    std::shared_ptr<MutationLog> log;
+    std::exception_ptr checkpoint_error;
+    {
+        std::lock_guard guard(mutex_);
+        previous_log = previous_log_;
+        log = log_;
+        checkpoint_error = std::exchange(checkpoint_error_, nullptr);
+    }
+
+    // Mutations of the previous log come first, and recovery needs them until the snapshot replacing it is written.
+    if (previous_log) {
+        previous_log->Sync();
+    }
+    log->Sync();
+
+    if (checkpoint_error) {
+        std::rethrow_exception(checkpoint_error);
+    }
+}
+
+void DurableSearchServer::Checkpoint() {
+    std::lock_guard checkpoint_guard(checkpoint_mutex_);
+
+    const uint64_t next_generation = generation_ + 1;
+    std::shared_ptr<MutationLog> stale_log;
+    {
+        std::lock_guard guard(mutex_);
+        stale_log = previous_log_;
+    }
+
+    // Left behind by a checkpoint that failed: its mutations are made durable before Sync stops waiting for them.
+    if (stale_log) {
+        stale_log->Sync();
+    }
+    // The log is created and made durable in the directory before any mutation goes to it.
+    auto next_log = std::make_shared<MutationLog>(GetLogPath(next_generation), options_.sync_interval);
+    SyncDirectory(directory_);
+
+    std::shared_ptr<const SearchServer::Version> version;
+    {
+        std::lock_guard guard(mutex_);
+        version = index_.PinVersion();
+        stale_log = std::exchange(previous_log_, std::exchange(log_, std::move(next_log)));
+        generation_ = next_generation;
+    }
+    index_.SaveToFile(*version, GetSnapshotPath(next_generation));
+    SyncDirectory(directory_);
+
+    // Released outside the lock, as closing a log waits for its last records to be written.
+    std::shared_ptr<MutationLog> previous_log;
+    {
+        std::lock_guard guard(mutex_);
+        previous_log = std::move(previous_log_);
+    }
+    RemoveGenerationsBefore(next_generation);
+}
+
+[[nodiscard]] const SearchServer& DurableSearchServer::GetIndex() const { return index_; }
+
+[[nodiscard]] std::string DurableSearchServer::GetSnapshotPath(uint64_t generation) const {
+    return (std::filesystem::path(directory_) / (kSnapshotPrefix + std::to_string(generation) + kSnapshotSuffix))
+        .string();
+}
+
+[[nodiscard]] std::string DurableSearchServer::GetLogPath(uint64_t generation) const {
+    return (std::filesystem::path(directory_) / (kLogPrefix + std::to_string(generation) + kLogSuffix)).string();
+}
+
+void DurableSearchServer::RemoveGenerationsBefore(uint64_t generation) const {
+    for (const auto& entry : std::filesystem::directory_iterator(directory_)) {
+        const std::string file_name = entry.path().filename().string();
+        const uint64_t snapshot_generation = ParseGeneration(file_name, kSnapshotPrefix, kSnapshotSuffix);
+        const uint64_t log_generation = ParseGeneration(file_name, kLogPrefix, kLogSuffix);
+
+        if ((snapshot_generation > 0 && snapshot_generation < generation) ||
+            (file_name.starts_with(kLogPrefix) && log_generation < generation)) {
+            std::filesystem::remove(entry.path());
+        }
+    }
+}
+
+void DurableSearchServer::RequestCheckpointIfNeeded() {
+    if (!is_checkpoint_requested_ && !checkpoint_error_ && log_->GetSize() >= options_.checkpoint_log_size) {
+        is_checkpoint_requested_ = true;
+        checkpoint_requested_.notify_one();
+    }
+}
+
+void DurableSearchServer::RunCheckpointLoop() {
+    std::unique_lock lock(mutex_);
+
+    while (true) {
+        checkpoint_requested_.wait(lock, [this] { return is_checkpoint_requested_ || is_stopping_; });
+
+        if (is_stopping_) {
+            return;
+        }
+        lock.unlock();
+
+        std::exception_ptr error;
+        try {
+            Checkpoint();
+        } catch (...) {
+            error = std::current_exception();
+        }
+        lock.lock();
+
+        if (error) {
+            checkpoint_error_ = error;
+        }
+        is_checkpoint_requested_ = false;
+    }
+}
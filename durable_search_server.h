@@ -0,0 +1,101 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "document.h"
+#include "mutation_log.h"
+#include "search_server.h"
+
+// SearchServer whose mutations survive a restart. The state lives in a directory holding the latest snapshot, an index
+// file written by SearchServer::SaveToFile, and the mutation logs of everything applied after it. Opening the directory
+// maps the snapshot and replays the logs, so recovery time is bounded by the log size rather than by the whole history.
+//
+// A mutation is appended to the log before it is applied to the index, so a mutation that could not be logged is not
+// applied either. Appending only encodes the record in memory: the mutation becomes durable with the next group
+// commit, within one sync interval, and callers that need to acknowledge a write as durable call Sync. The index
+// validates the arguments when applying; a mutation it rejects is logged all the same and rejected again on replay.
+//
+// Snapshots and logs are numbered by generation: snapshot N contains every mutation logged before log N. A checkpoint
+// starts log N + 1 and pins the version of the index that matches it in one step, under the lock writers take; only
+// then, with writers going on, it writes snapshot N + 1 atomically and deletes generation N. Once a log outgrows the
+// checkpoint threshold, a checkpoint runs on a background thread, so writers never wait for a snapshot to be written.
+// Recovery replays every log from that of the latest snapshot on, so a crash at any point leaves a consistent state.
+class DurableSearchServer {
+public:
+    struct Options {
+        std::chrono::microseconds sync_interval = MutationLog::kDefaultSyncInterval;
+        uint64_t checkpoint_log_size = 64u << 20;
+    };
+
+public:
+    // Stop words are only used when the directory holds no snapshot yet; otherwise those of the snapshot apply.
+    DurableSearchServer(const std::string& directory, const std::string& stop_words_text);
+
+    DurableSearchServer(const std::string& directory, const std::string& stop_words_text, Options options);
+
+    DurableSearchServer(const DurableSearchServer&) = delete;
+    DurableSearchServer& operator=(const DurableSearchServer&) = delete;
+
+    // Waits for a running checkpoint to finish.
+    ~DurableSearchServer();
+
+public:
+    void AddDocument(int document_id, const std::string_view document, DocumentStatus document_status,
+                     const std::vector<int>& document_ratings);
+
+    void RemoveDocument(int document_id);
+
+    // Blocks until every mutation made so far is on disk. Rethrows the error of a background checkpoint that failed
+    // since the last call; automatic checkpoints are suspended until then.
+    void Sync();
+
+    // Writes a snapshot of the current index and starts a new log. Writers only wait for the log to be switched, not
+    // for the snapshot.
+    void Checkpoint();
+
+    [[nodiscard]] const SearchServer& GetIndex() const;
+
+private:
+    [[nodiscard]] std::string GetSnapshotPath(uint64_t generation) const;
+
+    [[nodiscard]] std::string GetLogPath(uint64_t generation) const;
+
+    // Deletes the snapshots and logs of generations before the given one.
+    void RemoveGenerationsBefore(uint64_t generation) const;
+
+    // Asks the background thread for a checkpoint if the log has outgrown the threshold. Called under mutex_.
+    void RequestCheckpointIfNeeded();
+
+    void RunCheckpointLoop();
+
+private:
+    std::string directory_;
+    Options options_;
+    // Generation of the current log. Changed only by a checkpoint, under both mutexes.
+    uint64_t generation_ = 0;
+    SearchServer index_;
+
+    // Held while a mutation is logged and applied, so the log has mutations in the order the index applied them.
+    std::mutex mutex_;
+    std::shared_ptr<MutationLog> log_;
+    // Log of the generation before while a checkpoint writes the snapshot that replaces it; Sync waits for it too.
+    std::shared_ptr<MutationLog> previous_log_;
+
+    // Held for the whole checkpoint, so two checkpoints never overlap.
+    std::mutex checkpoint_mutex_;
+    std::condition_variable checkpoint_requested_;
+    bool is_checkpoint_requested_ = false;
+    bool is_stopping_ = false;
+    std::exception_ptr checkpoint_error_;
+
+    std::thread checkpoint_thread_;
+};
@@ -0,0 +1,24 @@
+#include "epoch.h"
+
+#include <atomic>
+#include <utility>
+
+Epoch::~Epoch() {
+    // A reader holding an old version keeps every later epoch alive, so the chain may be long; it is released in a
+    // loop instead of through nested destructors. An epoch with a single owner cannot gain another one, so it is
+    // safe to unlink it here. The fence orders the release after the last use by the owner that let go of it.
+    std::shared_ptr<Epoch> next = std::move(next_);
+
+    while (next && next.use_count() == 1) {
+        std::atomic_thread_fence(std::memory_order_acquire);
+        next = std::move(next->next_);
+    }
+}
+
+void Epoch::Retire(std::shared_ptr<const void> memory) { retired_.push_back(std::move(memory)); }
+
+[[nodiscard]] std::shared_ptr<Epoch> Epoch::Advance() {
+    next_ = std::make_shared<Epoch>();
+
+    return next_;
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+// Deferred release of memory that readers of older index versions may still be using. Every published version holds
+// the epoch it was published in, and every epoch holds the epoch that followed it. An epoch therefore lives exactly as
+// long as some reader holds its version or an older one.
+//
+// A writer replacing or removing shared data retires the old memory to the epoch of the version that is current
+// before its own one is published: the memory is released once the last reader of that version, or of any older one,
+// lets go of it. Readers never wait for this and never take a lock.
+class Epoch {
+public:
+    Epoch() = default;
+
+    Epoch(const Epoch&) = delete;
+    Epoch& operator=(const Epoch&) = delete;
+
+    ~Epoch();
+
+public:
+    void Retire(std::shared_ptr<const void> memory);
+
+    // Starts the epoch of the next version. This epoch keeps it alive, so it must not receive retirements afterwards.
+    [[nodiscard]] std::shared_ptr<Epoch> Advance();
+
+private:
+    std::vector<std::shared_ptr<const void>> retired_;
+    std::shared_ptr<Epoch> next_;
+};
@@ -0,0 +1,167 @@
+#include "index_file.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <system_error>
+
+namespace index_file {
+
+namespace {
+
+const uint64_t kSectionAlignment = 8;
+
+[[noreturn]] void ThrowSystemError(const std::string& what) {
+    throw std::system_error(errno, std::generic_category(), what);
+}
+}  // namespace
+
+MappedFile::MappedFile(const std::string& path) {
+    const int descriptor = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+
+    if (descriptor < 0) {
+        ThrowSystemError("Cannot open index file " + path);
+    }
+    struct stat file_status {};
+
+    if (::fstat(descriptor, &file_status) != 0) {
+        ::close(descriptor);
+        ThrowSystemError("Cannot stat index file " + path);
+    }
+    size_ = static_cast<size_t>(file_status.st_size);
+
+    if (size_ > 0) {
+        void* data = ::mmap(nullptr, size_, PROT_READ, MAP_SHARED, descriptor, 0);
+
+        if (data == MAP_FAILED) {
+            ::close(descriptor);
+            ThrowSystemError("Cannot map index file " + path);
+        }
+        data_ = static_cast<const std::byte*>(data);
+    }
+    // The mapping keeps the file referenced, the descriptor is no longer needed.
+    ::close(descriptor);
+}
+
+MappedFile::~MappedFile() {
+    if (data_ != nullptr) {
+        ::munmap(const_cast<std::byte*>(data_), size_);
+    }
+}
+
+[[nodiscard]] std::span<const std::byte> MappedFile::GetData() const { return {data_, size_}; }
+
+Reader::Reader(std::shared_ptr<const MappedFile> file) : file_(std::move(file)) {
+    const std::span<const std::byte> data = file_->GetData();
+
+    if (data.size() < offsetof(Header, sections)) {
+        throw FormatError("Index file is truncated");
+    }
+    std::memcpy(static_cast<void*>(&header_), data.data(), offsetof(Header, sections));
+
+    if (std::memcmp(header_.magic, kMagic, sizeof(kMagic)) != 0) {
+        throw FormatError("Not an index file");
+    }
+
+    if (header_.format_version < kMinFormatVersion || header_.format_version > kFormatVersion) {
+        throw FormatError("Unsupported index file version " + std::to_string(header_.format_version));
+    }
+    // Sections older files lack stay empty.
+    const size_t section_bytes = GetSectionCount(header_.format_version) * sizeof(SectionEntry);
+
+    if (data.size() - offsetof(Header, sections) < section_bytes) {
+        throw FormatError("Index file is truncated");
+    }
+    std::memcpy(header_.sections, data.data() + offsetof(Header, sections), section_bytes);
+
+    if (header_.byte_order_mark != kByteOrderMark) {
+        throw FormatError("Index file was written with a different byte order");
+    }
+
+    for (const SectionEntry& section : header_.sections) {
+        if (section.offset > data.size() || section.size > data.size() - section.offset) {
+            throw FormatError("Index file section is out of bounds");
+        }
+    }
+}
+
+[[nodiscard]] const Header& Reader::GetHeader() const { return header_; }
+
+[[nodiscard]] std::span<const std::byte> Reader::GetSectionBytes(Section section) const {
+    const SectionEntry& entry = header_.sections[static_cast<size_t>(section)];
+
+    return file_->GetData().subspan(entry.offset, entry.size);
+}
+
+Writer::Writer(const std::string& path) : path_(path), temporary_path_(path + ".tmp") {
+    descriptor_ = ::open(temporary_path_.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+
+    if (descriptor_ < 0) {
+        ThrowSystemError("Cannot create index file " + temporary_path_);
+    }
+    // The header is written last, once all section offsets are known.
+    const Header placeholder;
+
+    WriteBytes(&placeholder, sizeof(placeholder));
+}
+
+Writer::~Writer() {
+    if (descriptor_ >= 0) {
+        ::close(descriptor_);
+        ::unlink(temporary_path_.c_str());
+    }
+}
+
+void Writer::Finish(uint64_t term_count, uint64_t document_count) {
+    std::memcpy(header_.magic, kMagic, sizeof(kMagic));
+    header_.format_version = kFormatVersion;
+    header_.byte_order_mark = kByteOrderMark;
+    header_.term_count = term_count;
+    header_.document_count = document_count;
+
+    if (::pwrite(descriptor_, &header_, sizeof(header_), 0) != static_cast<ssize_t>(sizeof(header_)) ||
+        ::fsync(descriptor_) != 0) {
+        ThrowSystemError("Cannot write index file " + temporary_path_);
+    }
+    ::close(descriptor_);
+    descriptor_ = -1;
+
+    if (std::rename(temporary_path_.c_str(), path_.c_str()) != 0) {
+        ThrowSystemError("Cannot replace index file " + path_);
+    }
+}
+
+void Writer::WriteSectionBytes(Section section, std::span<const std::byte> bytes) {
+    static const std::byte kPadding[kSectionAlignment] = {};
+
+    WriteBytes(kPadding, (kSectionAlignment - offset_ % kSectionAlignment) % kSectionAlignment);
+
+    header_.sections[static_cast<size_t>(section)] = {offset_, bytes.size()};
+    WriteBytes(bytes.data(), bytes.size());
+}
+
+void Writer::WriteBytes(const void* data, size_t size) {
+    const auto* bytes = static_cast<const char*>(data);
+
+    while (size > 0) {
+        const ssize_t written = ::write(descriptor_, bytes, size);
+
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            ThrowSystemError("Cannot write index file " + temporary_path_);
+        }
+        bytes += written;
+        size -= static_cast<size_t>(written);
+        offset_ += static_cast<uint64_t>(written);
+    }
+}
+
+}  // namespace index_file
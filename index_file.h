@@ -0,0 +1,156 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+
+// Binary index file. The file starts with a fixed header followed by 8-byte aligned sections of plain arrays, laid out
+// exactly as the index keeps them in memory, so an opened file is used in place through a read-only memory mapping
+// and pages are only loaded when a query touches them. The format is native-endian; the header records the byte
+// order so a file moved to an incompatible machine is rejected instead of misread.
+namespace index_file {
+
+inline constexpr char kMagic[8] = {'S', 'R', 'C', 'H', 'I', 'D', 'X', '\0'};
+inline constexpr uint32_t kFormatVersion = 3;
+// Version 1 files lack document lengths, which readers recompute from the texts. Files before version 3 neither keep
+// terms in sorted order nor have the ordinals by id, so readers build their lookups themselves.
+inline constexpr uint32_t kMinFormatVersion = 1;
+inline constexpr uint32_t kByteOrderMark = 0x01020304;
+
+enum class Section : uint32_t {
+    kStopWords,
+    kTermOffsets,
+    kTerms,
+    kPostingOffsets,
+    kPostingOrdinals,
+    kPostingTermFrequencies,
+    kBlockMaxOffsets,
+    kBlockMaxTermFrequencies,
+    kDocuments,
+    kForwardIndexOffsets,
+    kForwardIndex,
+    kTextOffsets,
+    kTexts,
+    // Document ordinals in ascending order of their ids. Since version 3; later versions only append sections.
+    kOrdinalsById,
+    kCount,
+};
+
+// Number of sections of a file of the given version, whose header ends after their entries.
+[[nodiscard]] constexpr size_t GetSectionCount(uint32_t format_version) {
+    return static_cast<size_t>(format_version >= 3 ? Section::kCount : Section::kOrdinalsById);
+}
+
+struct SectionEntry {
+    uint64_t offset = 0;
+    uint64_t size = 0;
+};
+
+struct Header {
+    char magic[8] = {};
+    uint32_t format_version = 0;
+    uint32_t byte_order_mark = 0;
+    uint64_t term_count = 0;
+    uint64_t document_count = 0;
+    SectionEntry sections[static_cast<size_t>(Section::kCount)] = {};
+};
+
+struct DocumentRecord {
+    int32_t id = 0;
+    int32_t rating = 0;
+    int32_t status = 0;
+    // Number of indexed words; zero in version 1 files.
+    uint32_t length = 0;
+};
+
+class FormatError : public std::runtime_error {
+public:
+    using std::runtime_error::runtime_error;
+};
+
+// Read-only memory mapping of a whole file, unmapped on destruction.
+class MappedFile {
+public:
+    explicit MappedFile(const std::string& path);
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    ~MappedFile();
+
+public:
+    [[nodiscard]] std::span<const std::byte> GetData() const;
+
+private:
+    const std::byte* data_ = nullptr;
+    size_t size_ = 0;
+};
+
+// Validated access to the sections of a mapped index file.
+class Reader {
+public:
+    explicit Reader(std::shared_ptr<const MappedFile> file);
+
+public:
+    [[nodiscard]] const Header& GetHeader() const;
+
+    template <typename T>
+    [[nodiscard]] std::span<const T> GetSection(Section section) const {
+        static_assert(std::is_trivially_copyable_v<T>);
+
+        const std::span<const std::byte> bytes = GetSectionBytes(section);
+
+        if (bytes.size() % sizeof(T) != 0 || reinterpret_cast<uintptr_t>(bytes.data()) % alignof(T) != 0) {
+            throw FormatError("Index file section has invalid size or alignment");
+        }
+
+        return {reinterpret_cast<const T*>(bytes.data()), bytes.size() / sizeof(T)};
+    }
+
+private:
+    [[nodiscard]] std::span<const std::byte> GetSectionBytes(Section section) const;
+
+private:
+    std::shared_ptr<const MappedFile> file_;
+    Header header_;
+};
+
+// Writes an index file section by section. Data goes to a temporary file that replaces the target path atomically in
+// Finish, after being flushed to disk, so readers never observe a partially written index.
+class Writer {
+public:
+    explicit Writer(const std::string& path);
+
+    Writer(const Writer&) = delete;
+    Writer& operator=(const Writer&) = delete;
+
+    ~Writer();
+
+public:
+    template <typename T>
+    void WriteSection(Section section, std::span<const T> elements) {
+        static_assert(std::is_trivially_copyable_v<T>);
+
+        WriteSectionBytes(section, std::as_bytes(elements));
+    }
+
+    void Finish(uint64_t term_count, uint64_t document_count);
+
+private:
+    void WriteSectionBytes(Section section, std::span<const std::byte> bytes);
+
+    void WriteBytes(const void* data, size_t size);
+
+private:
+    std::string path_;
+    std::string temporary_path_;
+    int descriptor_ = -1;
+    uint64_t offset_ = 0;
+    Header header_;
+};
+
+}  // namespace index_file
@@ -1,15 +1,28 @@
 #include "log_duration.h"
 
-LogDuration::LogDuration(std::string func_name, std::ostream& stream) : func_name_(func_name), stream_(stream) {}
+#include <utility>
+
+LogDuration::LogDuration(std::string func_name, std::ostream& stream)
+    : func_name_(std::move(func_name)), stream_(&stream) {}
+
+LogDuration::LogDuration(LatencyHistogram& histogram) : histogram_(&histogram) {}
 
 LogDuration::~LogDuration() {
     using namespace std::chrono;
     using namespace std::literals;
 
-    const auto end_time = Clock::now();
-    const auto duration = end_time - start_time_;
+    const nanoseconds duration = GetElapsed();
+
+    if (histogram_ != nullptr) {
+        histogram_->Record(static_cast<uint64_t>(duration.count()));
+        return;
+    }
 
-    func_name_.empty() ? stream_ << "Operation time: "s : stream_ << func_name_ << ": "s;
+    func_name_.empty() ? *stream_ << "Operation time: "s : *stream_ << func_name_ << ": "s;
+
+    *stream_ << duration_cast<milliseconds>(duration).count() << " ms"s << std::endl;
+}
 
-    stream_ << duration_cast<milliseconds>(duration).count() << " ms"s << std::endl;
+[[nodiscard]] std::chrono::nanoseconds LogDuration::GetElapsed() const {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start_time_);
 }
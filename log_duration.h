@@ -1,27 +1,42 @@
 #pragma once
 
 #include <chrono>
+#include <cstdint>
 #include <iostream>
+#include <string>
+
+#include "metrics.h"
 
 #define PROFILE_CONCAT_INTERNAL(X, Y) X##Y
 #define PROFILE_CONCAT(X, Y) PROFILE_CONCAT_INTERNAL(X, Y)
 #define UNIQUE_VAR_NAME_PROFILE PROFILE_CONCAT(profileGuard, __LINE__)
 #define LOG_DURATION(x) LogDuration UNIQUE_VAR_NAME_PROFILE(x)
-#define LOG_DURATION_STREAM(x, stream) \ LogDuration UNIQUE_VAR_NAME_PROFILE(x, stream)
+#define LOG_DURATION_STREAM(x, stream) LogDuration UNIQUE_VAR_NAME_PROFILE(x, stream)
+#define LOG_DURATION_HISTOGRAM(histogram) LogDuration UNIQUE_VAR_NAME_PROFILE(histogram)
 
+// Measures the time until it is destroyed. Then it either prints the time in milliseconds to a stream or records it in
+// nanoseconds to a histogram; recording allocates nothing and takes no locks, so it fits calls on hot paths.
 class LogDuration {
 public:
     using Clock = std::chrono::steady_clock;
 
 public:
-    LogDuration() = default;
-    LogDuration(std::string func_name, std::ostream& stream = std::cerr);
+    explicit LogDuration(std::string func_name, std::ostream& stream = std::cerr);
+
+    explicit LogDuration(LatencyHistogram& histogram);
+
+    LogDuration(const LogDuration&) = delete;
+    LogDuration& operator=(const LogDuration&) = delete;
 
 public:
     ~LogDuration();
 
+public:
+    [[nodiscard]] std::chrono::nanoseconds GetElapsed() const;
+
 private:
     const Clock::time_point start_time_ = Clock::now();
     const std::string func_name_;
-    std::ostream& stream_;
+    std::ostream* const stream_ = nullptr;
+    LatencyHistogram* const histogram_ = nullptr;
 };
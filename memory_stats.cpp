@@ -0,0 +1,55 @@
+#include "memory_stats.h"
+
+#include <initializer_list>
+
+MemoryUsage& MemoryUsage::operator+=(const MemoryUsage& other) {
+    bytes += other.bytes;
+    object_count += other.object_count;
+    allocation_count += other.allocation_count;
+
+    return *this;
+}
+
+MemoryUsage& MemoryUsage::operator-=(const MemoryUsage& other) {
+    bytes -= other.bytes;
+    object_count -= other.object_count;
+    allocation_count -= other.allocation_count;
+
+    return *this;
+}
+
+MemoryStats& MemoryStats::operator+=(const MemoryStats& other) {
+    term_dictionary += other.term_dictionary;
+    postings += other.postings;
+    forward_index += other.forward_index;
+    document_metadata += other.document_metadata;
+    document_texts += other.document_texts;
+    stop_words += other.stop_words;
+    document_ids += other.document_ids;
+    allocator_overhead_bytes += other.allocator_overhead_bytes;
+    mapped_bytes += other.mapped_bytes;
+
+    return *this;
+}
+
+[[nodiscard]] size_t MemoryStats::GetTotalBytes() const {
+    size_t total = allocator_overhead_bytes;
+
+    for (const MemoryUsage* usage :
+         {&term_dictionary, &postings, &forward_index, &document_metadata, &document_texts, &stop_words,
+          &document_ids}) {
+        total += usage->bytes;
+    }
+
+    return total;
+}
+
+[[nodiscard]] MemoryUsage GetMemoryUsage(const std::string& text) {
+    static const size_t kSmallStringCapacity = std::string().capacity();
+
+    if (text.capacity() <= kSmallStringCapacity) {
+        return {0, 1, 0};
+    }
+
+    return {text.capacity() + 1, 1, 1};
+}
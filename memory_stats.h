@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Heap memory held by one part of an index: the bytes it asked the allocator for, the number of allocations and the
+// number of elements it holds, such as terms, postings or documents. Memory viewed in a mapped index file is not
+// counted, since it belongs to the page cache and is shared with other processes.
+struct MemoryUsage {
+    size_t bytes = 0;
+    size_t object_count = 0;
+    size_t allocation_count = 0;
+
+    MemoryUsage& operator+=(const MemoryUsage& other);
+
+    MemoryUsage& operator-=(const MemoryUsage& other);
+};
+
+// Memory of a SearchServer by part. Every part keeps its usage up to date or derives it from a few sizes, so
+// collecting the statistics costs about as much as one small query.
+struct MemoryStats {
+    // Bookkeeping and size rounding of a typical general-purpose allocator per allocation, used for the estimate.
+    static constexpr size_t kAllocationOverhead = 16;
+
+    // Terms, their lookup table and document frequencies.
+    MemoryUsage term_dictionary;
+    // Segments, the mutable segment and the tombstones of both; objects are postings.
+    MemoryUsage postings;
+    // Terms and frequencies of every document; objects are entries.
+    MemoryUsage forward_index;
+    // Per-document records, lengths, removal versions and the id lookup table.
+    MemoryUsage document_metadata;
+    // Document store blocks; objects are texts. Compressed, so the bytes are usually well below the text size.
+    MemoryUsage document_texts;
+    MemoryUsage stop_words;
+    MemoryUsage document_ids;
+    // Estimated from the allocation counts of all parts.
+    size_t allocator_overhead_bytes = 0;
+    // Size of the index file the server was opened from, if any.
+    size_t mapped_bytes = 0;
+
+    // Adds up the statistics of several indexes, such as the shards of a ShardedSearchServer.
+    MemoryStats& operator+=(const MemoryStats& other);
+
+    // Heap bytes of all parts together with the allocator overhead, without the mapped file.
+    [[nodiscard]] size_t GetTotalBytes() const;
+};
+
+template <typename T>
+[[nodiscard]] MemoryUsage GetMemoryUsage(const std::vector<T>& elements) {
+    return {elements.capacity() * sizeof(T), elements.size(), elements.capacity() > 0 ? size_t{1} : 0};
+}
+
+// Heap memory of a string beyond the object itself: none while it fits the small string buffer.
+[[nodiscard]] MemoryUsage GetMemoryUsage(const std::string& text);
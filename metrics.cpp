@@ -0,0 +1,191 @@
+#include "metrics.h"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <utility>
+
+namespace {
+
+constexpr uint64_t kHalfSubBucketCount = uint64_t{1} << (LatencyHistogram::kSubBucketBits - 1);
+
+std::atomic<size_t> next_thread_index = 0;
+
+void StoreMax(std::atomic<uint64_t>& target, uint64_t value) {
+    uint64_t current = target.load(std::memory_order_relaxed);
+
+    while (value > current && !target.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+    }
+}
+
+void WriteSample(std::ostream& output, const std::string& name, const std::string& labels, std::string_view extra_label,
+                 uint64_t value) {
+    output << name;
+
+    if (!labels.empty() || !extra_label.empty()) {
+        output << '{' << labels << (!labels.empty() && !extra_label.empty() ? "," : "") << extra_label << '}';
+    }
+    output << ' ' << value << '\n';
+}
+
+}  // namespace
+
+[[nodiscard]] size_t GetThreadIndex() {
+    thread_local const size_t thread_index = next_thread_index.fetch_add(1, std::memory_order_relaxed);
+
+    return thread_index;
+}
+
+[[nodiscard]] uint64_t LatencyHistogram::Snapshot::GetPercentile(double share) const {
+    if (count == 0) {
+        return 0;
+    }
+    const auto rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(std::clamp(share, 0.0, 1.0) * count)));
+    uint64_t seen = 0;
+
+    for (size_t index = 0; index < buckets.size(); ++index) {
+        seen += buckets[index];
+
+        if (seen >= rank) {
+            return std::min(GetBucketUpperBound(index), max);
+        }
+    }
+
+    // Counts of a snapshot are read one by one while threads record, so they may add up to less than the total.
+    return max;
+}
+
+LatencyHistogram::~LatencyHistogram() {
+    for (std::atomic<Shard*>& shard : shards_) {
+        delete shard.load(std::memory_order_relaxed);
+    }
+}
+
+void LatencyHistogram::Record(uint64_t value) {
+    value = std::min(value, kMaxValue);
+
+    Shard& shard = GetLocalShard();
+
+    shard.buckets[GetBucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+    shard.sum.fetch_add(value, std::memory_order_relaxed);
+    StoreMax(shard.max, value);
+    // Last, so a snapshot rarely counts a value whose bucket it missed.
+    shard.count.fetch_add(1, std::memory_order_relaxed);
+}
+
+[[nodiscard]] LatencyHistogram::Snapshot LatencyHistogram::GetSnapshot() const {
+    Snapshot snapshot;
+
+    snapshot.buckets.resize(kBucketCount);
+
+    for (const std::atomic<Shard*>& pointer : shards_) {
+        const Shard* shard = pointer.load(std::memory_order_acquire);
+
+        if (shard == nullptr) {
+            continue;
+        }
+        snapshot.count += shard->count.load(std::memory_order_relaxed);
+        snapshot.sum += shard->sum.load(std::memory_order_relaxed);
+        snapshot.max = std::max(snapshot.max, shard->max.load(std::memory_order_relaxed));
+
+        for (size_t index = 0; index < kBucketCount; ++index) {
+            snapshot.buckets[index] += shard->buckets[index].load(std::memory_order_relaxed);
+        }
+    }
+
+    return snapshot;
+}
+
+[[nodiscard]] size_t LatencyHistogram::GetBucketIndex(uint64_t value) {
+    if (value < 2 * kHalfSubBucketCount) {
+        return value;
+    }
+    const int shift = std::bit_width(value) - kSubBucketBits;
+
+    return shift * kHalfSubBucketCount + (value >> shift);
+}
+
+[[nodiscard]] uint64_t LatencyHistogram::GetBucketUpperBound(size_t index) {
+    if (index < 2 * kHalfSubBucketCount) {
+        return index;
+    }
+    const uint64_t shift = index / kHalfSubBucketCount - 1;
+    const uint64_t sub_bucket = index - shift * kHalfSubBucketCount;
+
+    return ((sub_bucket + 1) << shift) - 1;
+}
+
+[[nodiscard]] LatencyHistogram::Shard& LatencyHistogram::GetLocalShard() {
+    std::atomic<Shard*>& pointer = shards_[GetThreadIndex() % kShardCount];
+    Shard* shard = pointer.load(std::memory_order_acquire);
+
+    if (shard == nullptr) {
+        auto created = std::make_unique<Shard>();
+
+        // Otherwise another thread of the shard created it meanwhile, and the pointer now holds that.
+        if (pointer.compare_exchange_strong(shard, created.get(), std::memory_order_acq_rel)) {
+            shard = created.release();
+        }
+    }
+
+    return *shard;
+}
+
+[[nodiscard]] MetricsRegistry& MetricsRegistry::GetDefault() {
+    static MetricsRegistry registry;
+
+    return registry;
+}
+
+[[nodiscard]] Counter& MetricsRegistry::GetCounter(std::string_view name, std::string_view labels) {
+    std::lock_guard guard(mutex_);
+    std::unique_ptr<Counter>& counter = counters_[{std::string(name), std::string(labels)}];
+
+    if (!counter) {
+        counter = std::make_unique<Counter>();
+    }
+
+    return *counter;
+}
+
+[[nodiscard]] LatencyHistogram& MetricsRegistry::GetHistogram(std::string_view name, std::string_view labels) {
+    std::lock_guard guard(mutex_);
+    std::unique_ptr<LatencyHistogram>& histogram = histograms_[{std::string(name), std::string(labels)}];
+
+    if (!histogram) {
+        histogram = std::make_unique<LatencyHistogram>();
+    }
+
+    return *histogram;
+}
+
+void MetricsRegistry::WriteText(std::ostream& output) const {
+    static constexpr std::pair<double, std::string_view> kQuantiles[] = {
+        {0.5, "quantile=\"0.5\""}, {0.99, "quantile=\"0.99\""}, {0.999, "quantile=\"0.999\""}};
+
+    std::lock_guard guard(mutex_);
+    std::string last_name;
+
+    for (const auto& [key, counter] : counters_) {
+        if (key.name != last_name) {
+            output << "# TYPE " << key.name << " counter\n";
+            last_name = key.name;
+        }
+        WriteSample(output, key.name, key.labels, {}, counter->Get());
+    }
+
+    for (const auto& [key, histogram] : histograms_) {
+        if (key.name != last_name) {
+            output << "# TYPE " << key.name << " summary\n";
+            last_name = key.name;
+        }
+        const LatencyHistogram::Snapshot snapshot = histogram->GetSnapshot();
+
+        for (const auto& [share, label] : kQuantiles) {
+            WriteSample(output, key.name, key.labels, label, snapshot.GetPercentile(share));
+        }
+        WriteSample(output, key.name + "_sum", key.labels, {}, snapshot.sum);
+        WriteSample(output, key.name + "_count", key.labels, {}, snapshot.count);
+        WriteSample(output, key.name + "_max", key.labels, {}, snapshot.max);
+    }
+}
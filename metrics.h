@@ -0,0 +1,126 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Small number of the calling thread, assigned in the order threads first ask for it, for picking a shard: threads of
+// a pool get distinct shards of a fixed count as long as they are not more than the count.
+[[nodiscard]] size_t GetThreadIndex();
+
+// Monotonic count of events. Adding is a single relaxed atomic increment.
+class Counter {
+public:
+    void Add(uint64_t value = 1) { value_.fetch_add(value, std::memory_order_relaxed); }
+
+    [[nodiscard]] uint64_t Get() const { return value_.load(std::memory_order_relaxed); }
+
+private:
+    // Counters of a registry are allocated one by one; the alignment keeps two of them off the same cache line.
+    alignas(64) std::atomic<uint64_t> value_ = 0;
+};
+
+// Histogram of latencies in nanoseconds in the manner of HdrHistogram: values below 2^kSubBucketBits are counted
+// exactly, and every larger power-of-two range is split into 2^(kSubBucketBits - 1) buckets, so a percentile is off
+// by less than 2^(1 - kSubBucketBits) of its value. Values beyond kMaxValue are counted as kMaxValue.
+//
+// Values are recorded to kShardCount shards of buckets, created on first use; a thread picks its shard by its thread
+// index, so threads rarely share one, and updates it with relaxed atomic additions. A snapshot merges the buckets of
+// all shards. Memory does not grow with the number of threads.
+class LatencyHistogram {
+public:
+    static constexpr size_t kShardCount = 16;
+    static constexpr int kSubBucketBits = 7;
+    static constexpr int kMaxValueBits = 40;
+    // About eighteen minutes.
+    static constexpr uint64_t kMaxValue = (uint64_t{1} << kMaxValueBits) - 1;
+    static constexpr size_t kBucketCount = size_t{kMaxValueBits - kSubBucketBits + 2} << (kSubBucketBits - 1);
+
+    struct Snapshot {
+        uint64_t count = 0;
+        uint64_t sum = 0;
+        uint64_t max = 0;
+        std::vector<uint64_t> buckets;
+
+        // Smallest recorded value at least the given share of values do not exceed, up to bucket precision; zero if
+        // nothing was recorded. The share is between 0 and 1.
+        [[nodiscard]] uint64_t GetPercentile(double share) const;
+    };
+
+public:
+    LatencyHistogram() = default;
+
+    LatencyHistogram(const LatencyHistogram&) = delete;
+    LatencyHistogram& operator=(const LatencyHistogram&) = delete;
+
+    ~LatencyHistogram();
+
+public:
+    void Record(uint64_t value);
+
+    [[nodiscard]] Snapshot GetSnapshot() const;
+
+    [[nodiscard]] static size_t GetBucketIndex(uint64_t value);
+
+    // Largest value counted in the bucket.
+    [[nodiscard]] static uint64_t GetBucketUpperBound(size_t index);
+
+private:
+    struct Shard {
+        std::array<std::atomic<uint64_t>, kBucketCount> buckets{};
+        std::atomic<uint64_t> count = 0;
+        std::atomic<uint64_t> sum = 0;
+        std::atomic<uint64_t> max = 0;
+    };
+
+private:
+    [[nodiscard]] Shard& GetLocalShard();
+
+private:
+    // Owned; null until a thread records to the shard.
+    std::array<std::atomic<Shard*>, kShardCount> shards_{};
+};
+
+// Named counters and histograms. A metric is created on first request and lives as long as the registry, so callers
+// look it up once and keep the reference. Labels are Prometheus label pairs without braces, such as policy="par";
+// metrics of the same name with different labels are separate.
+class MetricsRegistry {
+public:
+    MetricsRegistry() = default;
+
+    MetricsRegistry(const MetricsRegistry&) = delete;
+    MetricsRegistry& operator=(const MetricsRegistry&) = delete;
+
+public:
+    // Registry the search server records its operations to.
+    [[nodiscard]] static MetricsRegistry& GetDefault();
+
+    [[nodiscard]] Counter& GetCounter(std::string_view name, std::string_view labels = {});
+
+    [[nodiscard]] LatencyHistogram& GetHistogram(std::string_view name, std::string_view labels = {});
+
+    // Writes every metric in the Prometheus text format, sorted by name: a counter as one sample, a histogram as a
+    // summary with its 0.5, 0.99 and 0.999 quantiles, sum, count and maximum.
+    void WriteText(std::ostream& output) const;
+
+private:
+    struct MetricKey {
+        std::string name;
+        std::string labels;
+
+        auto operator<=>(const MetricKey& other) const = default;
+    };
+
+private:
+    mutable std::mutex mutex_;
+    std::map<MetricKey, std::unique_ptr<Counter>> counters_;
+    std::map<MetricKey, std::unique_ptr<LatencyHistogram>> histograms_;
+};
@@ -0,0 +1,111 @@
+#include "mutable_segment.h"
+
+#include <algorithm>
+#include <numeric>
+
+MutableSegment::MutableSegment(DocumentOrdinal first_ordinal)
+    : first_ordinal_(first_ordinal), end_ordinal_(first_ordinal) {}
+
+void MutableSegment::AddDocument(DocumentOrdinal ordinal) { end_ordinal_ = ordinal + 1; }
+
+void MutableSegment::AddPosting(TermId term_id, double term_frequency, Epoch& epoch) {
+    const auto key_of = [this](uint32_t index) { return term_postings_[index].term_id; };
+    uint32_t index = term_indexes_.Find(term_id, key_of);
+
+    if (index == ConcurrentHashIndex<TermId>::kNotFound) {
+        index = static_cast<uint32_t>(term_postings_.size());
+
+        TermPostings& new_postings = term_postings_.emplace_back();
+
+        new_postings.term_id = term_id;
+        new_postings.arrays.store(&AllocateArrays(kInitialCapacity), std::memory_order_relaxed);
+        term_indexes_.Insert(term_id, index, key_of, epoch);
+    }
+    TermPostings& postings = term_postings_[index];
+    const uint32_t size = postings.size.load(std::memory_order_relaxed);
+    const PostingArrays* arrays = postings.arrays.load(std::memory_order_relaxed);
+
+    if (size == arrays->capacity) {
+        const PostingArrays& grown_arrays = AllocateArrays(arrays->capacity * 2);
+
+        std::copy(arrays->ordinals.get(), arrays->ordinals.get() + size, grown_arrays.ordinals.get());
+        std::copy(arrays->term_frequencies.get(), arrays->term_frequencies.get() + size,
+                  grown_arrays.term_frequencies.get());
+        postings.arrays.store(&grown_arrays, std::memory_order_release);
+        arrays = &grown_arrays;
+    }
+    arrays->ordinals[size] = end_ordinal_ - 1;
+    arrays->term_frequencies[size] = term_frequency;
+    postings.size.store(size + 1, std::memory_order_release);
+    ++posting_count_;
+}
+
+[[nodiscard]] Segment MutableSegment::Seal(const Tombstones& tombstones) const {
+    std::vector<uint32_t> indexes(term_postings_.size());
+
+    std::iota(indexes.begin(), indexes.end(), 0);
+    std::sort(indexes.begin(), indexes.end(),
+              [this](uint32_t lhs, uint32_t rhs) { return term_postings_[lhs].term_id < term_postings_[rhs].term_id; });
+
+    SegmentBuilder builder;
+
+    for (const uint32_t index : indexes) {
+        const TermPostings& postings = term_postings_[index];
+        const PostingArrays& arrays = *postings.arrays.load(std::memory_order_relaxed);
+        const uint32_t size = postings.size.load(std::memory_order_relaxed);
+
+        for (uint32_t i = 0; i < size; ++i) {
+            if (!tombstones.Contains(arrays.ordinals[i] - first_ordinal_)) {
+                builder.AddPosting(postings.term_id, arrays.ordinals[i], arrays.term_frequencies[i]);
+            }
+        }
+    }
+
+    return builder.Finish(first_ordinal_, end_ordinal_, GetDocumentCount() - tombstones.count());
+}
+
+[[nodiscard]] DocumentOrdinal MutableSegment::GetFirstOrdinal() const { return first_ordinal_; }
+
+[[nodiscard]] DocumentOrdinal MutableSegment::GetEndOrdinal() const { return end_ordinal_; }
+
+[[nodiscard]] size_t MutableSegment::GetDocumentCount() const { return end_ordinal_ - first_ordinal_; }
+
+[[nodiscard]] PostingList MutableSegment::GetPostings(TermId term_id, DocumentOrdinal end_ordinal) const {
+    const uint32_t index = term_indexes_.Find(term_id, [this](uint32_t i) { return term_postings_[i].term_id; });
+
+    if (index == ConcurrentHashIndex<TermId>::kNotFound) {
+        return {};
+    }
+    const TermPostings& postings = term_postings_[index];
+    // The length is read first: whichever arrays are current afterwards hold at least that many postings.
+    const uint32_t size = postings.size.load(std::memory_order_acquire);
+    const PostingArrays& arrays = *postings.arrays.load(std::memory_order_acquire);
+    const std::span<const DocumentOrdinal> ordinals(arrays.ordinals.get(), size);
+    const auto visible_size =
+        static_cast<size_t>(std::lower_bound(ordinals.begin(), ordinals.end(), end_ordinal) - ordinals.begin());
+
+    return {ordinals.first(visible_size), std::span<const double>(arrays.term_frequencies.get(), visible_size)};
+}
+
+[[nodiscard]] const MutableSegment::PostingArrays& MutableSegment::AllocateArrays(size_t capacity) {
+    auto arrays = std::make_unique<PostingArrays>();
+
+    arrays->capacity = capacity;
+    arrays->ordinals = std::make_unique<DocumentOrdinal[]>(capacity);
+    arrays->term_frequencies = std::make_unique<double[]>(capacity);
+    arrays_.push_back(std::move(arrays));
+    posting_array_bytes_ += sizeof(PostingArrays) + capacity * (sizeof(DocumentOrdinal) + sizeof(double));
+
+    return *arrays_.back();
+}
+
+[[nodiscard]] MemoryUsage MutableSegment::GetMemoryUsage() const {
+    MemoryUsage usage{sizeof(MutableSegment) + posting_array_bytes_, 0, 1 + arrays_.size() * 3};
+
+    usage += term_indexes_.GetMemoryUsage();
+    usage += term_postings_.GetMemoryUsage();
+    usage += ::GetMemoryUsage(arrays_);
+    usage.object_count = posting_count_;
+
+    return usage;
+}
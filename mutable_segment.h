@@ -0,0 +1,87 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "chunked_vector.h"
+#include "concurrent_hash_index.h"
+#include "epoch.h"
+#include "memory_stats.h"
+#include "posting_list.h"
+#include "segment.h"
+#include "term_dictionary.h"
+#include "tombstones.h"
+
+// In-memory segment receiving newly added documents. Postings are kept in appendable per-term arrays, so adding a
+// document costs one append per distinct term. Once it holds enough documents, the owner seals it into an immutable
+// Segment and starts a new one after it.
+//
+// The owner appends while readers of published index versions search the segment. A posting is stored before the
+// length of its array is published, and a full array is copied into a larger one instead of growing in place, so a
+// reader always finds a consistent prefix; GetPostings cuts it at the end of the reader's version. Replaced arrays
+// are released with the segment, since readers may still be scanning them.
+class MutableSegment {
+public:
+    static constexpr size_t kMaxDocumentCount = 4096;
+
+public:
+    explicit MutableSegment(DocumentOrdinal first_ordinal = 0);
+
+    MutableSegment(const MutableSegment&) = delete;
+    MutableSegment& operator=(const MutableSegment&) = delete;
+
+public:
+    // Starts the next document; postings added afterwards belong to it. Ordinals must grow.
+    void AddDocument(DocumentOrdinal ordinal);
+
+    // The term lookup the segment outgrows is retired to the epoch.
+    void AddPosting(TermId term_id, double term_frequency, Epoch& epoch);
+
+    // Builds an immutable segment from the documents added so far, leaving out those marked in the tombstones.
+    [[nodiscard]] Segment Seal(const Tombstones& tombstones) const;
+
+    [[nodiscard]] DocumentOrdinal GetFirstOrdinal() const;
+
+    // Only the owner may call GetEndOrdinal and GetDocumentCount: readers use the bounds of their version.
+    [[nodiscard]] DocumentOrdinal GetEndOrdinal() const;
+
+    [[nodiscard]] size_t GetDocumentCount() const;
+
+    // View of the postings of a term in documents with ordinals below end_ordinal. Block maxima are computed on the
+    // fly: the segment is small, and maintaining them would mean updating memory readers may be looking at.
+    [[nodiscard]] PostingList GetPostings(TermId term_id, DocumentOrdinal end_ordinal) const;
+
+    // Only the owner may call it. Objects are postings; outgrown posting arrays are counted until the segment goes.
+    [[nodiscard]] MemoryUsage GetMemoryUsage() const;
+
+private:
+    struct PostingArrays {
+        size_t capacity = 0;
+        std::unique_ptr<DocumentOrdinal[]> ordinals;
+        std::unique_ptr<double[]> term_frequencies;
+    };
+
+    struct TermPostings {
+        TermId term_id = TermDictionary::kNoTerm;
+        std::atomic<const PostingArrays*> arrays = nullptr;
+        std::atomic<uint32_t> size = 0;
+    };
+
+private:
+    static constexpr size_t kInitialCapacity = 4;
+
+private:
+    [[nodiscard]] const PostingArrays& AllocateArrays(size_t capacity);
+
+private:
+    DocumentOrdinal first_ordinal_ = 0;
+    DocumentOrdinal end_ordinal_ = 0;
+    ConcurrentHashIndex<TermId> term_indexes_;
+    ChunkedVector<TermPostings> term_postings_;
+    std::vector<std::unique_ptr<PostingArrays>> arrays_;
+    size_t posting_count_ = 0;
+    size_t posting_array_bytes_ = 0;
+};
@@ -0,0 +1,296 @@
+#include "mutation_log.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <system_error>
+#include <utility>
+
+namespace {
+
+struct RecordHeader {
+    uint32_t payload_size = 0;
+    uint32_t checksum = 0;
+};
+
+[[noreturn]] void ThrowSystemError(const std::string& what) {
+    throw std::system_error(errno, std::generic_category(), what);
+}
+
+[[nodiscard]] uint32_t ComputeCrc32(std::string_view data) {
+    static const std::array<uint32_t, 256> kTable = [] {
+        std::array<uint32_t, 256> table{};
+
+        for (uint32_t i = 0; i < table.size(); ++i) {
+            uint32_t value = i;
+
+            for (int bit = 0; bit < 8; ++bit) {
+                value = (value & 1) != 0 ? 0xEDB88320u ^ (value >> 1) : value >> 1;
+            }
+            table[i] = value;
+        }
+        return table;
+    }();
+
+    uint32_t crc = 0xFFFFFFFFu;
+
+    for (const char c : data) {
+        crc = kTable[(crc ^ static_cast<uint8_t>(c)) & 0xFFu] ^ (crc >> 8);
+    }
+
+    return crc ^ 0xFFFFFFFFu;
+}
+
+template <typename T>
+void AppendValue(std::string& out, const T& value) {
+    out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+// Reads fixed-size values from a record payload, failing instead of reading past its end.
+class PayloadReader {
+public:
+    explicit PayloadReader(std::string_view payload) : payload_(payload) {}
+
+public:
+    template <typename T>
+    [[nodiscard]] T Read() {
+        T value{};
+
+        if (payload_.size() < sizeof(value)) {
+            throw std::runtime_error("Mutation log record is malformed");
+        }
+        std::memcpy(&value, payload_.data(), sizeof(value));
+        payload_.remove_prefix(sizeof(value));
+
+        return value;
+    }
+
+    [[nodiscard]] std::string_view ReadRest() { return std::exchange(payload_, {}); }
+
+    [[nodiscard]] bool empty() const { return payload_.empty(); }
+
+private:
+    std::string_view payload_;
+};
+
+[[nodiscard]] MutationLog::Record DecodeRecord(std::string_view payload) {
+    PayloadReader reader(payload);
+    MutationLog::Record record;
+
+    record.type = static_cast<MutationLog::RecordType>(reader.Read<uint8_t>());
+    record.document_id = reader.Read<int32_t>();
+
+    switch (record.type) {
+        case MutationLog::RecordType::kAddDocument: {
+            record.status = static_cast<DocumentStatus>(reader.Read<int32_t>());
+            record.ratings.resize(reader.Read<uint32_t>());
+
+            for (int& rating : record.ratings) {
+                rating = reader.Read<int32_t>();
+            }
+            record.text = reader.ReadRest();
+            break;
+        }
+        case MutationLog::RecordType::kRemoveDocument:
+            if (!reader.empty()) {
+                throw std::runtime_error("Mutation log record is malformed");
+            }
+            break;
+        default:
+            throw std::runtime_error("Mutation log record has unknown type");
+    }
+
+    return record;
+}
+}  // namespace
+
+MutationLog::MutationLog(const std::string& path, std::chrono::microseconds sync_interval)
+    : sync_interval_(sync_interval) {
+    descriptor_ = ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+
+    if (descriptor_ < 0) {
+        ThrowSystemError("Cannot open mutation log " + path);
+    }
+    size_ = static_cast<uint64_t>(::lseek(descriptor_, 0, SEEK_END));
+    sync_thread_ = std::thread([this] { RunSyncLoop(); });
+}
+
+MutationLog::~MutationLog() {
+    {
+        std::lock_guard guard(mutex_);
+        is_stopping_ = true;
+    }
+    sync_requested_.notify_one();
+    sync_thread_.join();
+    ::close(descriptor_);
+}
+
+bool MutationLog::Replay(const std::string& path, const std::function<void(const Record&)>& apply) {
+    std::ifstream input(path, std::ios::binary);
+
+    if (!input) {
+        return true;
+    }
+    const std::string data{std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>()};
+    size_t offset = 0;
+
+    while (data.size() - offset >= sizeof(RecordHeader)) {
+        RecordHeader header;
+        std::memcpy(&header, data.data() + offset, sizeof(header));
+
+        const size_t payload_offset = offset + sizeof(header);
+
+        if (data.size() - payload_offset < header.payload_size) {
+            break;
+        }
+        const std::string_view payload(data.data() + payload_offset, header.payload_size);
+
+        if (ComputeCrc32(payload) != header.checksum) {
+            break;
+        }
+        apply(DecodeRecord(payload));
+        offset = payload_offset + header.payload_size;
+    }
+
+    // Whatever follows the last intact record was being written when the process stopped and was never
+    // acknowledged as durable.
+    if (offset < data.size()) {
+        input.close();
+        std::filesystem::resize_file(path, offset);
+
+        return false;
+    }
+
+    return true;
+}
+
+uint64_t MutationLog::AppendAddDocument(int document_id, std::string_view document, DocumentStatus document_status,
+                                        const std::vector<int>& document_ratings) {
+    std::string payload;
+    payload.reserve(sizeof(uint8_t) + 3 * sizeof(int32_t) + document_ratings.size() * sizeof(int32_t) +
+                    document.size());
+
+    AppendValue(payload, static_cast<uint8_t>(RecordType::kAddDocument));
+    AppendValue(payload, static_cast<int32_t>(document_id));
+    AppendValue(payload, static_cast<int32_t>(document_status));
+    AppendValue(payload, static_cast<uint32_t>(document_ratings.size()));
+
+    for (const int rating : document_ratings) {
+        AppendValue(payload, static_cast<int32_t>(rating));
+    }
+    payload.append(document);
+
+    return Append(payload);
+}
+
+uint64_t MutationLog::AppendRemoveDocument(int document_id) {
+    std::string payload;
+
+    AppendValue(payload, static_cast<uint8_t>(RecordType::kRemoveDocument));
+    AppendValue(payload, static_cast<int32_t>(document_id));
+
+    return Append(payload);
+}
+
+void MutationLog::WaitDurable(uint64_t sequence_number) {
+    std::unique_lock lock(mutex_);
+
+    if (durable_count_ < sequence_number && !error_) {
+        is_sync_requested_ = true;
+        sync_requested_.notify_one();
+        synced_.wait(lock, [this, sequence_number] { return durable_count_ >= sequence_number || error_; });
+    }
+
+    if (error_) {
+        std::rethrow_exception(error_);
+    }
+}
+
+void MutationLog::Sync() {
+    uint64_t appended_count = 0;
+    {
+        std::lock_guard guard(mutex_);
+        appended_count = appended_count_;
+    }
+    WaitDurable(appended_count);
+}
+
+[[nodiscard]] uint64_t MutationLog::GetSize() const {
+    std::lock_guard guard(mutex_);
+
+    return size_;
+}
+
+uint64_t MutationLog::Append(const std::string& payload) {
+    const RecordHeader header{static_cast<uint32_t>(payload.size()), ComputeCrc32(payload)};
+
+    std::lock_guard guard(mutex_);
+
+    if (error_) {
+        std::rethrow_exception(error_);
+    }
+    AppendValue(pending_, header);
+    pending_ += payload;
+    size_ += sizeof(header) + payload.size();
+
+    return ++appended_count_;
+}
+
+void MutationLog::RunSyncLoop() {
+    std::string batch;
+    std::unique_lock lock(mutex_);
+
+    while (true) {
+        sync_requested_.wait_for(lock, sync_interval_, [this] { return is_sync_requested_ || is_stopping_; });
+
+        if (pending_.empty()) {
+            is_sync_requested_ = false;
+
+            if (is_stopping_) {
+                return;
+            }
+            continue;
+        }
+        batch.swap(pending_);
+        is_sync_requested_ = false;
+        const uint64_t batch_end = appended_count_;
+
+        // Appends go on filling the next batch while this one is written.
+        lock.unlock();
+        try {
+            for (size_t written = 0; written < batch.size();) {
+                const ssize_t result = ::write(descriptor_, batch.data() + written, batch.size() - written);
+
+                if (result < 0) {
+                    if (errno == EINTR) {
+                        continue;
+                    }
+                    ThrowSystemError("Cannot write mutation log");
+                }
+                written += static_cast<size_t>(result);
+            }
+
+            if (::fdatasync(descriptor_) != 0) {
+                ThrowSystemError("Cannot sync mutation log");
+            }
+            lock.lock();
+            durable_count_ = batch_end;
+        } catch (...) {
+            lock.lock();
+            error_ = std::current_exception();
+        }
+        batch.clear();
+        synced_.notify_all();
+
+        if (error_) {
+            return;
+        }
+    }
+}
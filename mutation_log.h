@@ -0,0 +1,91 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "document.h"
+
+// Append-only log of index mutations with group commit. Appending only encodes the record into an in-memory buffer;
+// a background thread writes the buffer and syncs it to disk once per sync interval, or as soon as someone waits for
+// durability, so one fsync covers every record appended since the previous one.
+//
+// Every record is framed with its size and a CRC-32 of its payload. A crash can leave a partially written record at
+// the end of the log; Replay stops at the first record that fails the check and cuts the log there.
+class MutationLog {
+public:
+    enum class RecordType : uint8_t {
+        kAddDocument = 1,
+        kRemoveDocument = 2,
+    };
+
+    // Decoded record; text views into the replay buffer and is only valid during the replay callback.
+    struct Record {
+        RecordType type = RecordType::kAddDocument;
+        int document_id = 0;
+        DocumentStatus status = DocumentStatus::kActual;
+        std::vector<int> ratings;
+        std::string_view text;
+    };
+
+    static constexpr std::chrono::microseconds kDefaultSyncInterval{2000};
+
+public:
+    explicit MutationLog(const std::string& path, std::chrono::microseconds sync_interval = kDefaultSyncInterval);
+
+    MutationLog(const MutationLog&) = delete;
+    MutationLog& operator=(const MutationLog&) = delete;
+
+    // Syncs the records appended so far before closing the log.
+    ~MutationLog();
+
+public:
+    // Applies every intact record of the log at path in order and truncates whatever follows the last one. A missing
+    // file is an empty log. Returns false if anything was truncated.
+    static bool Replay(const std::string& path, const std::function<void(const Record&)>& apply);
+
+    // Both return the sequence number of the appended record, to be passed to WaitDurable.
+    uint64_t AppendAddDocument(int document_id, std::string_view document, DocumentStatus document_status,
+                               const std::vector<int>& document_ratings);
+
+    uint64_t AppendRemoveDocument(int document_id);
+
+    // Blocks until the record with the given sequence number and all records before it are on disk. Rethrows the
+    // error if the log could not be written.
+    void WaitDurable(uint64_t sequence_number);
+
+    // Waits for every record appended so far.
+    void Sync();
+
+    // Size of the log file including records that are not written yet.
+    [[nodiscard]] uint64_t GetSize() const;
+
+private:
+    uint64_t Append(const std::string& payload);
+
+    void RunSyncLoop();
+
+private:
+    int descriptor_ = -1;
+    std::chrono::microseconds sync_interval_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable sync_requested_;
+    std::condition_variable synced_;
+    std::string pending_;
+    uint64_t size_ = 0;
+    uint64_t appended_count_ = 0;
+    uint64_t durable_count_ = 0;
+    bool is_sync_requested_ = false;
+    bool is_stopping_ = false;
+    std::exception_ptr error_;
+
+    std::thread sync_thread_;
+};
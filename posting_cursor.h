@@ -0,0 +1,86 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <span>
+
+#include "posting_list.h"
+
+// Forward-only iterator over a posting list used by document-at-a-time evaluation. Scores are the scoring model's term
+// scores multiplied by the term weight (its inverse document frequency), and the cursor exposes the upper bounds of
+// those scores for the whole list and for the block it currently points into.
+class PostingCursor {
+public:
+    static constexpr DocumentOrdinal kEnd = std::numeric_limits<DocumentOrdinal>::max();
+
+public:
+    // A cursor only used to test which documents contain the term.
+    explicit PostingCursor(const PostingList& postings) : ordinals_(postings.GetOrdinals()) {}
+
+    template <typename Scoring>
+    PostingCursor(const PostingList& postings, double weight, const Scoring& scoring)
+        : ordinals_(postings.GetOrdinals()),
+          term_frequencies_(postings.GetTermFrequencies()),
+          block_max_term_frequencies_(postings.GetBlockMaxTermFrequencies()),
+          weight_(weight),
+          max_score_(scoring.GetMaxScore(postings.GetMaxTermFrequency()) * weight) {}
+
+public:
+    [[nodiscard]] DocumentOrdinal GetOrdinal() const {
+        return position_ < ordinals_.size() ? ordinals_[position_] : kEnd;
+    }
+
+    template <typename Scoring>
+    [[nodiscard]] double GetScore(const Scoring& scoring, uint32_t document_length) const {
+        return scoring.Score(term_frequencies_[position_], document_length) * weight_;
+    }
+
+    [[nodiscard]] double GetMaxScore() const { return max_score_; }
+
+    template <typename Scoring>
+    [[nodiscard]] double GetBlockMaxScore(const Scoring& scoring) const {
+        return scoring.GetMaxScore(block_max_term_frequencies_[position_ / PostingList::kBlockSize]) * weight_;
+    }
+
+    // Last ordinal of the block the cursor points into; nothing in the list up to it can score above the block max.
+    [[nodiscard]] DocumentOrdinal GetBlockLastOrdinal() const {
+        const size_t block_end = (position_ / PostingList::kBlockSize + 1) * PostingList::kBlockSize;
+
+        return ordinals_[std::min(block_end, ordinals_.size()) - 1];
+    }
+
+    void Next() { ++position_; }
+
+    // Moves to the first posting with an ordinal not less than target.
+    void Advance(DocumentOrdinal target) {
+        const auto& ordinals = ordinals_;
+
+        if (position_ >= ordinals.size() || ordinals[position_] >= target) {
+            return;
+        }
+        // Gallop from the current position first: targets are usually close, and the binary search that follows then
+        // works on a small window instead of the whole tail of the list.
+        size_t step = 1;
+        size_t low = position_;
+
+        while (low + step < ordinals.size() && ordinals[low + step] < target) {
+            low += step;
+            step *= 2;
+        }
+        const auto window_end = ordinals.begin() + static_cast<std::ptrdiff_t>(std::min(low + step, ordinals.size()));
+
+        position_ = static_cast<size_t>(
+            std::lower_bound(ordinals.begin() + static_cast<std::ptrdiff_t>(low), window_end, target) -
+            ordinals.begin());
+    }
+
+private:
+    std::span<const DocumentOrdinal> ordinals_;
+    std::span<const double> term_frequencies_;
+    std::span<const double> block_max_term_frequencies_;
+    double weight_ = 0.0;
+    double max_score_ = 0.0;
+    size_t position_ = 0;
+};
@@ -0,0 +1,111 @@
+#include "posting_list.h"
+
+#include <algorithm>
+#include <iterator>
+
+PostingList::PostingList(std::span<const DocumentOrdinal> ordinals, std::span<const double> term_frequencies,
+                         std::span<const double> block_max_term_frequencies)
+    : ordinals_(ordinals),
+      term_frequencies_(term_frequencies),
+      block_max_term_frequencies_(block_max_term_frequencies) {
+    const auto max_it = std::max_element(block_max_term_frequencies.begin(), block_max_term_frequencies.end());
+
+    max_term_frequency_ = max_it == block_max_term_frequencies.end() ? 0.0 : *max_it;
+}
+
+PostingList::PostingList(std::span<const DocumentOrdinal> ordinals, std::span<const double> term_frequencies)
+    : ordinals_(ordinals), term_frequencies_(term_frequencies) {
+    UpdateBlockMaxima(0);
+}
+
+void PostingList::Add(DocumentOrdinal ordinal, double term_frequency) {
+    auto& ordinals = ordinals_.GetMutable();
+    auto& term_frequencies = term_frequencies_.GetMutable();
+
+    // Ordinals are handed out in growing order, so the common case is a plain append.
+    if (ordinals.empty() || ordinals.back() < ordinal) {
+        ordinals.push_back(ordinal);
+        term_frequencies.push_back(term_frequency);
+
+        auto& block_max_term_frequencies = block_max_term_frequencies_.GetMutable();
+
+        if (ordinals.size() % kBlockSize == 1) {
+            block_max_term_frequencies.push_back(term_frequency);
+        } else {
+            block_max_term_frequencies.back() = std::max(block_max_term_frequencies.back(), term_frequency);
+        }
+        max_term_frequency_ = std::max(max_term_frequency_, term_frequency);
+        return;
+    }
+
+    const auto it = std::lower_bound(ordinals.begin(), ordinals.end(), ordinal);
+    const auto index = std::distance(ordinals.begin(), it);
+
+    if (it != ordinals.end() && *it == ordinal) {
+        term_frequencies[index] += term_frequency;
+    } else {
+        ordinals.insert(it, ordinal);
+        term_frequencies.insert(term_frequencies.begin() + index, term_frequency);
+    }
+    UpdateBlockMaxima(static_cast<size_t>(index));
+}
+
+bool PostingList::Remove(DocumentOrdinal ordinal) {
+    if (!Contains(ordinal)) {
+        return false;
+    }
+    auto& ordinals = ordinals_.GetMutable();
+    auto& term_frequencies = term_frequencies_.GetMutable();
+
+    const auto it = std::lower_bound(ordinals.begin(), ordinals.end(), ordinal);
+    const auto index = std::distance(ordinals.begin(), it);
+
+    ordinals.erase(it);
+    term_frequencies.erase(term_frequencies.begin() + index);
+    UpdateBlockMaxima(static_cast<size_t>(index));
+
+    return true;
+}
+
+[[nodiscard]] bool PostingList::Contains(DocumentOrdinal ordinal) const {
+    const auto ordinals = ordinals_.GetSpan();
+
+    return std::binary_search(ordinals.begin(), ordinals.end(), ordinal);
+}
+
+[[nodiscard]] std::span<const DocumentOrdinal> PostingList::GetOrdinals() const { return ordinals_.GetSpan(); }
+
+[[nodiscard]] std::span<const double> PostingList::GetTermFrequencies() const { return term_frequencies_.GetSpan(); }
+
+[[nodiscard]] std::span<const double> PostingList::GetBlockMaxTermFrequencies() const {
+    return block_max_term_frequencies_.GetSpan();
+}
+
+[[nodiscard]] double PostingList::GetMaxTermFrequency() const { return max_term_frequency_; }
+
+[[nodiscard]] size_t PostingList::size() const { return ordinals_.size(); }
+
+[[nodiscard]] bool PostingList::empty() const { return ordinals_.empty(); }
+
+void PostingList::UpdateBlockMaxima(size_t first_index) {
+    // Entries from first_index onwards may have changed or shifted, so every block starting with the one containing
+    // first_index is recomputed.
+    const auto term_frequencies = term_frequencies_.GetSpan();
+    auto& block_max_term_frequencies = block_max_term_frequencies_.GetMutable();
+    const size_t block_count = (term_frequencies.size() + kBlockSize - 1) / kBlockSize;
+    const size_t first_block = first_index / kBlockSize;
+
+    block_max_term_frequencies.resize(block_count);
+
+    for (size_t block = first_block; block < block_count; ++block) {
+        const size_t block_begin = block * kBlockSize;
+        const size_t block_end = std::min(term_frequencies.size(), block_begin + kBlockSize);
+
+        block_max_term_frequencies[block] =
+            *std::max_element(term_frequencies.begin() + block_begin, term_frequencies.begin() + block_end);
+    }
+
+    const auto max_it = std::max_element(block_max_term_frequencies.begin(), block_max_term_frequencies.end());
+
+    max_term_frequency_ = max_it == block_max_term_frequencies.end() ? 0.0 : *max_it;
+}
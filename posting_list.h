@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "cow_array.h"
+
+// Dense internal number of a document, assigned by the index in insertion order.
+using DocumentOrdinal = uint32_t;
+
+// Posting list of a single term: ordinals of the documents containing the term, sorted ascending, and the term
+// frequency in every such document stored in a parallel array. Both arrays are contiguous, so scanning a term touches
+// two sequential memory ranges instead of a chain of tree nodes.
+//
+// The list is also split into fixed-size blocks, and the highest term frequency of every block and of the whole list
+// is maintained on each update. These are the score upper bounds used by dynamic pruning.
+//
+// A list opened from an index file views the mapped arrays and copies them only when it is first modified.
+class PostingList {
+public:
+    static constexpr size_t kBlockSize = 64;
+
+public:
+    PostingList() = default;
+
+    PostingList(std::span<const DocumentOrdinal> ordinals, std::span<const double> term_frequencies,
+                std::span<const double> block_max_term_frequencies);
+
+    // Views postings whose block maxima are not stored anywhere; they are computed from the term frequencies.
+    PostingList(std::span<const DocumentOrdinal> ordinals, std::span<const double> term_frequencies);
+
+public:
+    void Add(DocumentOrdinal ordinal, double term_frequency);
+
+    bool Remove(DocumentOrdinal ordinal);
+
+    [[nodiscard]] bool Contains(DocumentOrdinal ordinal) const;
+
+    [[nodiscard]] std::span<const DocumentOrdinal> GetOrdinals() const;
+
+    [[nodiscard]] std::span<const double> GetTermFrequencies() const;
+
+    [[nodiscard]] std::span<const double> GetBlockMaxTermFrequencies() const;
+
+    [[nodiscard]] double GetMaxTermFrequency() const;
+
+    [[nodiscard]] size_t size() const;
+
+    [[nodiscard]] bool empty() const;
+
+private:
+    void UpdateBlockMaxima(size_t first_index);
+
+private:
+    CowArray<DocumentOrdinal> ordinals_;
+    CowArray<double> term_frequencies_;
+    CowArray<double> block_max_term_frequencies_;
+    double max_term_frequency_ = 0.0;
+};
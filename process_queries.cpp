@@ -1,26 +1,77 @@
 #include "process_queries.h"
 
-#include <algorithm>
-#include <execution>
-#include <list>
+#include "log_duration.h"
+#include "metrics.h"
+
+namespace {
+
+LatencyHistogram& GetProcessQueriesHistogram() {
+    static LatencyHistogram& histogram = MetricsRegistry::GetDefault().GetHistogram("process_queries_ns");
+
+    return histogram;
+}
+
+Counter& GetProcessedQueryCounter() {
+    static Counter& counter = MetricsRegistry::GetDefault().GetCounter("process_queries_queries_total");
+
+    return counter;
+}
+
+std::vector<std::vector<Document>> ProcessQueriesImpl(const SearchServer& search_server,
+                                                      const std::vector<std::string>& queries,
+                                                      ThreadPool& thread_pool) {
+    LOG_DURATION_HISTOGRAM(GetProcessQueriesHistogram());
+
+    GetProcessedQueryCounter().Add(queries.size());
+
+    return search_server.FindTopDocumentsBatch(thread_pool, queries);
+}
+
+std::vector<std::vector<Document>> ProcessQueriesImpl(const ShardedSearchServer& search_server,
+                                                      const std::vector<std::string>& queries,
+                                                      ThreadPool& thread_pool) {
+    LOG_DURATION_HISTOGRAM(GetProcessQueriesHistogram());
+
+    GetProcessedQueryCounter().Add(queries.size());
 
-std::vector<std::vector<Document>> ProcessQueries(const SearchServer& search_server,
-                                                  const std::vector<std::string>& queries) {
     std::vector<std::vector<Document>> result(queries.size());
-    std::transform(std::execution::par, queries.begin(), queries.end(), result.begin(),
-                   [&search_server](std::string query) { return search_server.FindTopDocuments(query); });
+    thread_pool.ParallelFor(queries.size(),
+                            [&](size_t index) { result[index] = search_server.FindTopDocuments(queries[index]); });
 
     return result;
 }
 
-std::vector<Document> ProcessQueriesJoined(const SearchServer& search_server, const std::vector<std::string>& queries) {
+template <typename SearchServerType>
+std::vector<Document> ProcessQueriesJoinedImpl(const SearchServerType& search_server,
+                                               const std::vector<std::string>& queries, ThreadPool& thread_pool) {
     std::vector<Document> result;
 
-    auto process_result = ProcessQueries(search_server, queries);
+    auto process_result = ProcessQueries(search_server, queries, thread_pool);
 
     for (const auto& documents : process_result) {
         result.insert(result.end(), documents.begin(), documents.end());
     }
 
     return result;
+}
+}  // namespace
+
+std::vector<std::vector<Document>> ProcessQueries(const SearchServer& search_server,
+                                                  const std::vector<std::string>& queries, ThreadPool& thread_pool) {
+    return ProcessQueriesImpl(search_server, queries, thread_pool);
+}
+
+std::vector<std::vector<Document>> ProcessQueries(const ShardedSearchServer& search_server,
+                                                  const std::vector<std::string>& queries, ThreadPool& thread_pool) {
+    return ProcessQueriesImpl(search_server, queries, thread_pool);
+}
+
+std::vector<Document> ProcessQueriesJoined(const SearchServer& search_server, const std::vector<std::string>& queries,
+                                           ThreadPool& thread_pool) {
+    return ProcessQueriesJoinedImpl(search_server, queries, thread_pool);
+}
+
+std::vector<Document> ProcessQueriesJoined(const ShardedSearchServer& search_server,
+                                           const std::vector<std::string>& queries, ThreadPool& thread_pool) {
+    return ProcessQueriesJoinedImpl(search_server, queries, thread_pool);
 }
\ No newline at end of file
@@ -2,8 +2,22 @@
 
 #include <vector>
 #include "search_server.h"
+#include "sharded_search_server.h"
+#include "thread_pool.h"
 
+// Queries against a SearchServer are evaluated as one batch sharing term weights and posting lists; queries against a
+// ShardedSearchServer are spread over the workers one at a time.
 std::vector<std::vector<Document>> ProcessQueries(const SearchServer& search_server,
-                                                  const std::vector<std::string>& queries);
+                                                  const std::vector<std::string>& queries,
+                                                  ThreadPool& thread_pool = ThreadPool::GetDefault());
 
-std::vector<Document> ProcessQueriesJoined(const SearchServer& search_server, const std::vector<std::string>& queries);
\ No newline at end of file
+std::vector<std::vector<Document>> ProcessQueries(const ShardedSearchServer& search_server,
+                                                  const std::vector<std::string>& queries,
+                                                  ThreadPool& thread_pool = ThreadPool::GetDefault());
+
+std::vector<Document> ProcessQueriesJoined(const SearchServer& search_server, const std::vector<std::string>& queries,
+                                           ThreadPool& thread_pool = ThreadPool::GetDefault());
+
+std::vector<Document> ProcessQueriesJoined(const ShardedSearchServer& search_server,
+                                           const std::vector<std::string>& queries,
+                                           ThreadPool& thread_pool = ThreadPool::GetDefault());
\ No newline at end of file
@@ -0,0 +1,164 @@
+#include "query_cache.h"
+
+#include <algorithm>
+#include <functional>
+#include <utility>
+
+namespace {
+
+size_t HashStatusAndCount(DocumentStatus status, size_t top_document_count) {
+    return std::hash<size_t>{}(top_document_count) ^ static_cast<size_t>(status);
+}
+
+void Combine(size_t& hash, size_t value) { hash ^= value + 0x9E3779B97F4A7C15 + (hash << 6) + (hash >> 2); }
+
+}  // namespace
+
+QueryCache::QueryCache(size_t capacity) : shard_capacity_(std::max<size_t>(1, capacity / kShardCount)) {}
+
+[[nodiscard]] QueryCache::Documents QueryCache::Find(const Key& key, uint64_t generation) {
+    Shard& shard = GetShard(key);
+    std::lock_guard guard(shard.mutex);
+
+    const auto it = shard.entries.find(key);
+
+    if (it == shard.entries.end() || it->second.generation != generation) {
+        misses_.fetch_add(1, std::memory_order_relaxed);
+        return nullptr;
+    }
+    shard.recency.splice(shard.recency.begin(), shard.recency, it->second.recency_it);
+    hits_.fetch_add(1, std::memory_order_relaxed);
+
+    return it->second.documents;
+}
+
+[[nodiscard]] QueryCache::Documents QueryCache::FindByText(const TextKey& text_key, uint64_t generation) {
+    std::shared_ptr<const Key> key;
+    {
+        AliasShard& alias_shard = GetAliasShard(text_key);
+        std::lock_guard guard(alias_shard.mutex);
+
+        const auto it = alias_shard.aliases.find(text_key);
+
+        if (it == alias_shard.aliases.end() || it->second.generation != generation) {
+            return nullptr;
+        }
+        key = it->second.key;
+    }
+    Shard& shard = GetShard(*key);
+    std::lock_guard guard(shard.mutex);
+
+    // The entry may have been evicted or replaced since the alias was read.
+    const auto it = shard.entries.find(*key);
+
+    if (it == shard.entries.end() || it->second.generation != generation) {
+        return nullptr;
+    }
+    shard.recency.splice(shard.recency.begin(), shard.recency, it->second.recency_it);
+    hits_.fetch_add(1, std::memory_order_relaxed);
+
+    return it->second.documents;
+}
+
+void QueryCache::Insert(const TextKey& text_key, Key key, uint64_t generation, Documents documents) {
+    Shard& shard = GetShard(key);
+    std::lock_guard guard(shard.mutex);
+
+    auto it = shard.entries.find(key);
+
+    if (it != shard.entries.end()) {
+        Entry& entry = it->second;
+
+        if (entry.generation > generation) {
+            return;
+        }
+
+        // Texts may parse to other terms in another generation, so the aliases go with the old documents.
+        if (entry.generation < generation) {
+            for (const TextKey& alias : entry.aliases) {
+                RemoveAlias(entry, alias);
+            }
+            entry.aliases.clear();
+            entry.generation = generation;
+            entry.documents = std::move(documents);
+        }
+        shard.recency.splice(shard.recency.begin(), shard.recency, entry.recency_it);
+    } else {
+        if (shard.entries.size() >= shard_capacity_) {
+            const auto evicted_it = shard.entries.find(shard.recency.back());
+
+            for (const TextKey& alias : evicted_it->second.aliases) {
+                RemoveAlias(evicted_it->second, alias);
+            }
+            shard.entries.erase(evicted_it);
+            shard.recency.pop_back();
+        }
+        auto shared_key = std::make_shared<const Key>(key);
+
+        shard.recency.push_front(key);
+        it = shard.entries
+                 .emplace(std::move(key),
+                          Entry{generation, std::move(documents), std::move(shared_key), {}, shard.recency.begin()})
+                 .first;
+    }
+    AddAlias(it->second, text_key);
+}
+
+[[nodiscard]] QueryCache::Stats QueryCache::GetStats() const {
+    return {hits_.load(std::memory_order_relaxed), misses_.load(std::memory_order_relaxed)};
+}
+
+size_t QueryCache::KeyHash::operator()(const Key& key) const {
+    size_t hash = HashStatusAndCount(key.status, key.top_document_count);
+
+    for (const TermId term_id : key.plus_terms) {
+        Combine(hash, term_id);
+    }
+    // Separates plus from minus terms, so moving a term between them changes the hash.
+    Combine(hash, key.plus_terms.size());
+
+    for (const TermId term_id : key.minus_terms) {
+        Combine(hash, term_id);
+    }
+
+    return hash;
+}
+
+size_t QueryCache::TextKeyHash::operator()(const TextKey& text_key) const {
+    size_t hash = HashStatusAndCount(text_key.status, text_key.top_document_count);
+
+    Combine(hash, std::hash<std::string>{}(text_key.text));
+
+    return hash;
+}
+
+[[nodiscard]] QueryCache::Shard& QueryCache::GetShard(const Key& key) { return shards_[KeyHash{}(key) % kShardCount]; }
+
+[[nodiscard]] QueryCache::AliasShard& QueryCache::GetAliasShard(const TextKey& text_key) {
+    return alias_shards_[TextKeyHash{}(text_key) % kShardCount];
+}
+
+void QueryCache::AddAlias(Entry& entry, const TextKey& text_key) {
+    if (std::find(entry.aliases.begin(), entry.aliases.end(), text_key) == entry.aliases.end()) {
+        if (entry.aliases.size() >= kMaxAliasesPerEntry) {
+            RemoveAlias(entry, entry.aliases.front());
+            entry.aliases.erase(entry.aliases.begin());
+        }
+        entry.aliases.push_back(text_key);
+    }
+    AliasShard& alias_shard = GetAliasShard(text_key);
+    std::lock_guard guard(alias_shard.mutex);
+
+    alias_shard.aliases.insert_or_assign(text_key, Alias{entry.generation, entry.key});
+}
+
+void QueryCache::RemoveAlias(const Entry& entry, const TextKey& text_key) {
+    AliasShard& alias_shard = GetAliasShard(text_key);
+    std::lock_guard guard(alias_shard.mutex);
+
+    const auto it = alias_shard.aliases.find(text_key);
+
+    if (it != alias_shard.aliases.end() && it->second.key == entry.key) {
+        alias_shard.aliases.erase(it);
+    }
+}
@@ -0,0 +1,134 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "document.h"
+#include "term_dictionary.h"
+
+// Cache of top documents of recent queries, keyed by the parsed query, the status the results are filtered by and the
+// number of results. Keying by sorted plus and minus term ids makes texts differing only in word order, repeated
+// words or stop words share one entry. Texts seen for an entry are kept as aliases of it, up to kMaxAliasesPerEntry,
+// so a repeated text is found before parsing; aliases do not count towards the capacity and go with their entry.
+// Results are handed out without copying them. Every entry remembers the index generation it was computed in, and a
+// lookup only accepts an entry of the generation it asks for, so any modification of the index invalidates the whole
+// cache without touching it; stale entries are overwritten or evicted as usual.
+//
+// Keys and texts are spread over independently locked shards, each evicting its least recently used entry when full,
+// so concurrent queries rarely wait for each other.
+class QueryCache {
+public:
+    struct Key {
+        std::vector<TermId> plus_terms;
+        std::vector<TermId> minus_terms;
+        DocumentStatus status = DocumentStatus::kActual;
+        size_t top_document_count = 0;
+
+        bool operator==(const Key& other) const = default;
+    };
+
+    struct TextKey {
+        std::string text;
+        DocumentStatus status = DocumentStatus::kActual;
+        size_t top_document_count = 0;
+
+        bool operator==(const TextKey& other) const = default;
+    };
+
+    struct Stats {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+    };
+
+    static constexpr size_t kMaxAliasesPerEntry = 4;
+
+public:
+    explicit QueryCache(size_t capacity);
+
+    QueryCache(const QueryCache&) = delete;
+    QueryCache& operator=(const QueryCache&) = delete;
+
+public:
+    using Documents = std::shared_ptr<const std::vector<Document>>;
+
+    // Null if not cached.
+    [[nodiscard]] Documents Find(const Key& key, uint64_t generation);
+
+    // Null if the text is not an alias of an entry of the generation. A miss is not counted in the stats, since a
+    // lookup by key follows it.
+    [[nodiscard]] Documents FindByText(const TextKey& text_key, uint64_t generation);
+
+    // Stores the documents under the key unless an entry of a newer generation is there, as a query that pinned an
+    // older index version may finish late, and makes the text an alias of the entry. An entry of the same generation
+    // keeps its documents.
+    void Insert(const TextKey& text_key, Key key, uint64_t generation, Documents documents);
+
+    [[nodiscard]] Stats GetStats() const;
+
+private:
+    struct KeyHash {
+        size_t operator()(const Key& key) const;
+    };
+
+    struct TextKeyHash {
+        size_t operator()(const TextKey& text_key) const;
+    };
+
+    struct Entry {
+        uint64_t generation = 0;
+        Documents documents;
+        // Shared with the aliases, which look the entry up by it.
+        std::shared_ptr<const Key> key;
+        // Texts aliased to the entry, the oldest first.
+        std::vector<TextKey> aliases;
+        // Position of the key in the recency list of the shard.
+        std::list<Key>::iterator recency_it;
+    };
+
+    struct Alias {
+        uint64_t generation = 0;
+        std::shared_ptr<const Key> key;
+    };
+
+    struct Shard {
+        std::mutex mutex;
+        std::unordered_map<Key, Entry, KeyHash> entries;
+        // Keys from the most to the least recently used.
+        std::list<Key> recency;
+    };
+
+    // Locked after the shard of an entry when both are, never the other way round.
+    struct AliasShard {
+        std::mutex mutex;
+        std::unordered_map<TextKey, Alias, TextKeyHash> aliases;
+    };
+
+private:
+    static constexpr size_t kShardCount = 16;
+
+private:
+    [[nodiscard]] Shard& GetShard(const Key& key);
+
+    [[nodiscard]] AliasShard& GetAliasShard(const TextKey& text_key);
+
+    // Called under the lock of the shard of the entry.
+    void AddAlias(Entry& entry, const TextKey& text_key);
+
+    // Called under the lock of the shard of the entry. Skips a text aliased to another entry since.
+    void RemoveAlias(const Entry& entry, const TextKey& text_key);
+
+private:
+    std::array<Shard, kShardCount> shards_;
+    std::array<AliasShard, kShardCount> alias_shards_;
+    size_t shard_capacity_ = 0;
+    std::atomic<uint64_t> hits_ = 0;
+    std::atomic<uint64_t> misses_ = 0;
+};
@@ -1,23 +1,257 @@
 #include "remove_duplicates.h"
 
-void RemoveDuplicates(SearchServer& search_server) {
-    std::map<std::set<std::string>, int> documents_container;
-    std::vector<int> ids_to_remove;
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <execution>
+#include <iostream>
+#include <limits>
+#include <numeric>
+#include <span>
+#include <stdexcept>
+#include <string_view>
+#include <tuple>
+#include <utility>
 
-    for (int document_id : search_server) {
-        std::set<std::string> words;
+#include "stop_word_filter.h"
 
-        for (const auto& [word, _] : search_server.GetWordFrequencies(document_id)) {
-            words.insert(std::string(word.begin(), word.end()));
+namespace {
+
+// Documents hashed by one task of the pool, enough to outweigh handing the task out.
+constexpr size_t kDocumentsPerTask = 256;
+
+// Number of MinHash values per document; the similarity of two documents is estimated to within about 1 / sqrt(128).
+// Values keep the high 32 bits of the minima, so unrelated minima agree by chance once in 2^32.
+constexpr size_t kSignatureSize = 128;
+
+// Bands bucketed at the same time, each with a buffer of 8 bytes per document.
+constexpr size_t kMaxBandsInFlight = 4;
+
+struct Fingerprint {
+    uint64_t low = 0;
+    uint64_t high = 0;
+
+    auto operator<=>(const Fingerprint&) const = default;
+};
+
+// MurmurHash3 finalizer.
+uint64_t Mix(uint64_t value) {
+    value ^= value >> 33;
+    value *= 0xFF51AFD7ED558CCD;
+    value ^= value >> 33;
+    value *= 0xC4CEB9FE1A85EC53;
+    value ^= value >> 33;
+
+    return value;
+}
+
+template <typename Body>
+void ForEachDocument(const std::vector<int>& document_ids, ThreadPool& thread_pool, Body body) {
+    thread_pool.ParallelFor((document_ids.size() + kDocumentsPerTask - 1) / kDocumentsPerTask, [&](size_t task) {
+        const size_t end = std::min(document_ids.size(), (task + 1) * kDocumentsPerTask);
+
+        for (size_t index = task * kDocumentsPerTask; index < end; ++index) {
+            body(index);
         }
+    });
+}
+
+// Words are hashed independently and the hashes summed, so the fingerprint depends on the set of words and not on
+// their order. Each half takes its own seed, which makes two different sets agree by chance with probability 2^-128.
+template <typename SearchServerType>
+std::vector<int> FindExactDuplicates(const SearchServerType& search_server, const std::vector<int>& document_ids,
+                                     ThreadPool& thread_pool) {
+    std::vector<Fingerprint> fingerprints(document_ids.size());
+
+    ForEachDocument(document_ids, thread_pool, [&](size_t index) {
+        Fingerprint& fingerprint = fingerprints[index];
+
+        search_server.ForEachWord(document_ids[index], [&fingerprint](std::string_view word) {
+            fingerprint.low += perfect_hash::Hash(word, 1);
+            fingerprint.high += perfect_hash::Hash(word, 2);
+        });
+    });
 
-        if (!documents_container.emplace(words, document_id).second) {
-            ids_to_remove.push_back(document_id);
+    std::vector<uint32_t> order(document_ids.size());
+    std::iota(order.begin(), order.end(), 0);
+    // Ids are ascending, so within a run of equal fingerprints the first document has the lowest id.
+    std::sort(order.begin(), order.end(), [&fingerprints](uint32_t lhs, uint32_t rhs) {
+        return std::tie(fingerprints[lhs], lhs) < std::tie(fingerprints[rhs], rhs);
+    });
+
+    std::vector<int> duplicate_ids;
+
+    for (size_t i = 1; i < order.size(); ++i) {
+        if (fingerprints[order[i]] == fingerprints[order[i - 1]]) {
+            duplicate_ids.push_back(document_ids[order[i]]);
         }
     }
+    std::sort(duplicate_ids.begin(), duplicate_ids.end());
+
+    return duplicate_ids;
+}
+
+// Signatures are split into bands of this many values. Two documents share a band with probability s^rows for
+// similarity s, so they become candidates mostly above (1 / band count)^(1 / rows); the most rows keeping that below
+// the threshold are taken, trading some extra candidates for few missed pairs.
+size_t GetRowsPerBand(double similarity_threshold) {
+    size_t rows = 1;
+
+    while (rows * 2 <= kSignatureSize &&
+           std::pow(static_cast<double>(rows * 2) / kSignatureSize, 1.0 / static_cast<double>(rows * 2)) <=
+               similarity_threshold) {
+        rows *= 2;
+    }
+
+    return rows;
+}
 
-    for (int id : ids_to_remove) {
-        std::cout << "Found duplicate document id " << id << std::endl;
-        search_server.RemoveDocument(id);
+uint32_t GetRoot(std::vector<uint32_t>& parents, uint32_t index) {
+    while (parents[index] != index) {
+        parents[index] = parents[parents[index]];
+        index = parents[index];
     }
+
+    return index;
+}
+
+template <typename SearchServerType>
+std::vector<int> FindNearDuplicates(const SearchServerType& search_server, const std::vector<int>& document_ids,
+                                    double similarity_threshold, ThreadPool& thread_pool) {
+    // Value i of a signature is the least of the word hashes under the i-th hash function.
+    std::vector<uint32_t> signatures(document_ids.size() * kSignatureSize, std::numeric_limits<uint32_t>::max());
+
+    ForEachDocument(document_ids, thread_pool, [&](size_t index) {
+        const std::span<uint32_t> signature(signatures.data() + index * kSignatureSize, kSignatureSize);
+
+        search_server.ForEachWord(document_ids[index], [&signature](std::string_view word) {
+            const uint64_t hash = perfect_hash::Hash(word, 0);
+
+            for (size_t i = 0; i < kSignatureSize; ++i) {
+                signature[i] = std::min(signature[i], static_cast<uint32_t>(Mix(hash + i * 0x9E3779B97F4A7C15) >> 32));
+            }
+        });
+    });
+
+    const auto get_signature = [&signatures](uint32_t index) {
+        return std::span<const uint32_t>(signatures.data() + index * kSignatureSize, kSignatureSize);
+    };
+    const auto min_agreement_count = static_cast<size_t>(std::ceil(similarity_threshold * kSignatureSize - 1e-9));
+    const size_t rows = GetRowsPerBand(similarity_threshold);
+    std::vector<std::vector<std::pair<uint32_t, uint32_t>>> band_pairs(kSignatureSize / rows);
+
+    // Documents sharing a bucket by chance only cost a comparison of their signatures, so band hashes keep 32 bits.
+    const auto find_band_pairs = [&](size_t band) {
+        std::vector<std::pair<uint32_t, uint32_t>> buckets(document_ids.size());
+
+        for (uint32_t index = 0; index < buckets.size(); ++index) {
+            uint64_t hash = band;
+
+            for (const uint32_t value : get_signature(index).subspan(band * rows, rows)) {
+                hash = Mix(hash + value);
+            }
+            buckets[index] = {static_cast<uint32_t>(hash >> 32), index};
+        }
+        std::sort(buckets.begin(), buckets.end());
+
+        // Each document is compared with the first of its bucket only, which keeps a bucket of many copies linear;
+        // pairs missed this way are mostly joined through other bands.
+        for (size_t first = 0; first < buckets.size();) {
+            size_t last = first + 1;
+
+            for (; last < buckets.size() && buckets[last].first == buckets[first].first; ++last) {
+                const std::span<const uint32_t> lhs = get_signature(buckets[first].second);
+                const std::span<const uint32_t> rhs = get_signature(buckets[last].second);
+                size_t agreement_count = 0;
+
+                for (size_t i = 0; i < kSignatureSize; ++i) {
+                    agreement_count += lhs[i] == rhs[i];
+                }
+
+                if (agreement_count >= min_agreement_count) {
+                    band_pairs[band].emplace_back(buckets[first].second, buckets[last].second);
+                }
+            }
+            first = last;
+        }
+    };
+
+    for (size_t first_band = 0; first_band < band_pairs.size(); first_band += kMaxBandsInFlight) {
+        thread_pool.ParallelFor(std::min(kMaxBandsInFlight, band_pairs.size() - first_band),
+                                [&](size_t band) { find_band_pairs(first_band + band); });
+    }
+
+    // Every group is rooted at its lowest index, which is the lowest id.
+    std::vector<uint32_t> parents(document_ids.size());
+    std::iota(parents.begin(), parents.end(), 0);
+
+    for (const auto& pairs : band_pairs) {
+        for (const auto& [lhs, rhs] : pairs) {
+            const uint32_t lhs_root = GetRoot(parents, lhs);
+            const uint32_t rhs_root = GetRoot(parents, rhs);
+
+            parents[std::max(lhs_root, rhs_root)] = std::min(lhs_root, rhs_root);
+        }
+    }
+
+    std::vector<int> duplicate_ids;
+
+    for (uint32_t index = 0; index < parents.size(); ++index) {
+        if (GetRoot(parents, index) != index) {
+            duplicate_ids.push_back(document_ids[index]);
+        }
+    }
+
+    return duplicate_ids;
+}
+
+template <typename SearchServerType>
+std::vector<int> FindDuplicatesImpl(const SearchServerType& search_server, const DuplicateDetectionOptions& options,
+                                    ThreadPool& thread_pool) {
+    const std::vector<int> document_ids(search_server.begin(), search_server.end());
+
+    if (!options.find_near_duplicates) {
+        return FindExactDuplicates(search_server, document_ids, thread_pool);
+    }
+
+    if (!(options.similarity_threshold > 0 && options.similarity_threshold <= 1)) {
+        throw std::invalid_argument("Similarity threshold should be in (0, 1]");
+    }
+
+    return FindNearDuplicates(search_server, document_ids, options.similarity_threshold, thread_pool);
+}
+
+void PrintDuplicates(const std::vector<int>& duplicate_ids) {
+    for (const int id : duplicate_ids) {
+        std::cout << "Found duplicate document id " << id << '\n';
+    }
+    std::cout.flush();
+}
+}  // namespace
+
+std::vector<int> FindDuplicates(const SearchServer& search_server, const DuplicateDetectionOptions& options,
+                                ThreadPool& thread_pool) {
+    return FindDuplicatesImpl(search_server, options, thread_pool);
+}
+
+std::vector<int> FindDuplicates(const ShardedSearchServer& search_server, const DuplicateDetectionOptions& options,
+                                ThreadPool& thread_pool) {
+    return FindDuplicatesImpl(search_server, options, thread_pool);
+}
+
+void RemoveDuplicates(SearchServer& search_server, const DuplicateDetectionOptions& options,
+                      ThreadPool& thread_pool) {
+    const std::vector<int> duplicate_ids = FindDuplicates(search_server, options, thread_pool);
+
+    PrintDuplicates(duplicate_ids);
+    search_server.RemoveDocuments(duplicate_ids);
+}
+
+void RemoveDuplicates(ShardedSearchServer& search_server, const DuplicateDetectionOptions& options,
+                      ThreadPool& thread_pool) {
+    const std::vector<int> duplicate_ids = FindDuplicates(search_server, options, thread_pool);
+
+    PrintDuplicates(duplicate_ids);
+    // Shards remove their parts in parallel on the server's own pool.
+    search_server.RemoveDocuments(std::execution::par, duplicate_ids);
 }
@@ -1,5 +1,33 @@
 #pragma once
 
+#include <vector>
+
 #include "search_server.h"
+#include "sharded_search_server.h"
+#include "thread_pool.h"
+
+struct DuplicateDetectionOptions {
+    // By default only documents with equal sets of words are duplicates. Near duplicate detection also takes those
+    // whose sets have an estimated Jaccard similarity of at least the threshold, which must be in (0, 1]. It needs a
+    // signature of 512 bytes per document, plus 32 bytes per document while bucketing; exact detection needs 20.
+    bool find_near_duplicates = false;
+    double similarity_threshold = 0.8;
+};
+
+// Ids of the documents that duplicate a document with a lower id, in ascending order. Exact duplicates are found by a
+// 128-bit fingerprint of the set of words; near duplicates by MinHash signatures bucketed with locality-sensitive
+// hashing, then grouped transitively, so every group keeps its lowest id. Documents are hashed on the pool in
+// parallel; the server must not be modified meanwhile.
+std::vector<int> FindDuplicates(const SearchServer& search_server, const DuplicateDetectionOptions& options = {},
+                                ThreadPool& thread_pool = ThreadPool::GetDefault());
+
+std::vector<int> FindDuplicates(const ShardedSearchServer& search_server,
+                                const DuplicateDetectionOptions& options = {},
+                                ThreadPool& thread_pool = ThreadPool::GetDefault());
+
+// Removes the documents found by FindDuplicates in one batch, printing the id of each.
+void RemoveDuplicates(SearchServer& search_server, const DuplicateDetectionOptions& options = {},
+                      ThreadPool& thread_pool = ThreadPool::GetDefault());
 
-void RemoveDuplicates(SearchServer& search_server);
+void RemoveDuplicates(ShardedSearchServer& search_server, const DuplicateDetectionOptions& options = {},
+                      ThreadPool& thread_pool = ThreadPool::GetDefault());
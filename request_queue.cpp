@@ -1,46 +1,25 @@
 #include "request_queue.h"
 
 std::vector<Document> RequestQueue::AddFindRequest(const std::string& raw_query, DocumentStatus status) {
-    auto search_result = search_server_.FindTopDocuments(raw_query, status);
+    const RequestStatistics::Clock::time_point start_time = RequestStatistics::Clock::now();
+    auto search_result = std::visit(
+        [&](const auto* search_server) { return search_server->FindTopDocuments(raw_query, status); }, search_server_);
 
-    AddResultRequest(search_result.size());
+    AddResultRequest(search_result.size(), start_time);
 
     return search_result;
 }
 
 std::vector<Document> RequestQueue::AddFindRequest(const std::string& raw_query) {
-    auto search_result = search_server_.FindTopDocuments(raw_query);
-
-    AddResultRequest(search_result.size());
-
-    return search_result;
+    return AddFindRequest(raw_query, DocumentStatus::kActual);
 }
 
-int RequestQueue::GetNoResultRequests() const { return no_result_count_; }
-
-void RequestQueue::AddResultRequest(int results_total) {
-    timestamp_++;
+int RequestQueue::GetNoResultRequests() const { return static_cast<int>(statistics_.GetSnapshot().no_result_count); }
 
-    bool old_request_exist = !requests_.empty() && requests_.front().query_timestamp <=
-                                                       requests_.back().query_timestamp - (kMinutesInDay - 1);
-
-    if (old_request_exist) {
-        RemoveRequest();
-    }
-    AddRequest(results_total);
-}
-
-void RequestQueue::RemoveRequest() {
-    if (requests_.front().documents_count == 0) {
-        --no_result_count_;
-    }
-    requests_.pop_front();
-}
+[[nodiscard]] RequestStatistics::Snapshot RequestQueue::GetStatistics() const { return statistics_.GetSnapshot(); }
 
-void RequestQueue::AddRequest(int results_total) {
-    requests_.push_back({results_total, timestamp_});
+void RequestQueue::AddResultRequest(size_t results_total, RequestStatistics::Clock::time_point start_time) {
+    const RequestStatistics::Clock::time_point end_time = RequestStatistics::Clock::now();
 
-    if (results_total == 0) {
-        ++no_result_count_;
-    }
+    statistics_.Record(results_total, end_time - start_time, end_time);
 }
@@ -1,44 +1,53 @@
 #pragma once
 
-#include <deque>
 #include <string>
+#include <variant>
 #include <vector>
 
 #include "document.h"
+#include "request_statistics.h"
 #include "search_server.h"
+#include "sharded_search_server.h"
 
+// Runs search requests and keeps statistics of those of a recent period of time, by default the last day. Requests
+// may be added from any number of threads at once.
 class RequestQueue {
 public:
-    explicit RequestQueue(const SearchServer& search_server) : search_server_(search_server) {}
+    explicit RequestQueue(const SearchServer& search_server) : search_server_(&search_server) {}
+
+    explicit RequestQueue(const ShardedSearchServer& search_server) : search_server_(&search_server) {}
+
+    RequestQueue(const SearchServer& search_server, RequestStatistics::Options options)
+        : search_server_(&search_server), statistics_(options) {}
+
+    RequestQueue(const ShardedSearchServer& search_server, RequestStatistics::Options options)
+        : search_server_(&search_server), statistics_(options) {}
 
     template <typename DocumentPredicate>
     std::vector<Document> AddFindRequest(const std::string& raw_query, DocumentPredicate document_predicate) {
-        return AddResultRequest(search_server_.FindTopDocuments(raw_query, document_predicate));
+        const RequestStatistics::Clock::time_point start_time = RequestStatistics::Clock::now();
+        auto search_result = std::visit(
+            [&](const auto* search_server) { return search_server->FindTopDocuments(raw_query, document_predicate); },
+            search_server_);
+
+        AddResultRequest(search_result.size(), start_time);
+
+        return search_result;
     }
 
     std::vector<Document> AddFindRequest(const std::string& raw_query, DocumentStatus status);
 
     std::vector<Document> AddFindRequest(const std::string& raw_query);
 
+    // Requests of the period that found nothing.
     int GetNoResultRequests() const;
 
-private:
-    struct QueryResult {
-        int documents_count = 0;
-        int64_t query_timestamp = 0;
-    };
-
-private:
-    const static int kMinutesInDay = 1440;
+    [[nodiscard]] RequestStatistics::Snapshot GetStatistics() const;
 
 private:
-    void AddResultRequest(int results_total);
-    void AddRequest(int results_total);
-    void RemoveRequest();
+    void AddResultRequest(size_t results_total, RequestStatistics::Clock::time_point start_time);
 
 private:
-    const SearchServer& search_server_;
-    std::deque<QueryResult> requests_;
-    int64_t timestamp_ = 0;
-    int no_result_count_ = 0;
+    std::variant<const SearchServer*, const ShardedSearchServer*> search_server_;
+    RequestStatistics statistics_;
 };
@@ -0,0 +1,172 @@
+#include "request_statistics.h"
+
+#include <algorithm>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+
+namespace {
+
+void StoreMax(std::atomic<uint64_t>& target, uint64_t value) {
+    uint64_t current = target.load(std::memory_order_relaxed);
+
+    while (value > current && !target.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+    }
+}
+
+}  // namespace
+
+[[nodiscard]] double RequestStatistics::Snapshot::GetRequestRate() const {
+    if (duration.count() <= 0) {
+        return 0.0;
+    }
+
+    return static_cast<double>(request_count) / std::chrono::duration<double>(duration).count();
+}
+
+[[nodiscard]] double RequestStatistics::Snapshot::GetNoResultRate() const {
+    if (request_count == 0) {
+        return 0.0;
+    }
+
+    return static_cast<double>(no_result_count) / static_cast<double>(request_count);
+}
+
+RequestStatistics::RequestStatistics() : RequestStatistics(Options{}) {}
+
+RequestStatistics::RequestStatistics(Options options)
+    : start_time_(Clock::now()),
+      slot_duration_(options.window / kSlotCount) {
+    if (slot_duration_.count() <= 0) {
+        throw std::invalid_argument("Request statistics window is too short");
+    }
+}
+
+RequestStatistics::~RequestStatistics() {
+    for (std::atomic<Shard*>& shard : shards_) {
+        delete shard.load(std::memory_order_relaxed);
+    }
+}
+
+void RequestStatistics::Record(size_t result_count, std::chrono::nanoseconds latency, Clock::time_point now) {
+    const uint64_t slot_number = GetSlotNumber(now);
+    Slot& slot = GetLocalShard().slots[slot_number % kSlotCount];
+    uint64_t current_number = slot.number.load(std::memory_order_acquire);
+
+    while (current_number != slot_number) {
+        if (current_number == kClearingSlot) {
+            std::this_thread::yield();
+            current_number = slot.number.load(std::memory_order_acquire);
+            continue;
+        }
+
+        // The ring has moved on to a later slot already: only possible with times given out of order.
+        if (current_number != kNoSlot && current_number > slot_number) {
+            return;
+        }
+
+        if (!slot.number.compare_exchange_weak(current_number, kClearingSlot, std::memory_order_acquire)) {
+            continue;
+        }
+        std::atomic_thread_fence(std::memory_order_release);
+
+        slot.request_count.store(0, std::memory_order_relaxed);
+        slot.no_result_count.store(0, std::memory_order_relaxed);
+        slot.latency_sum.store(0, std::memory_order_relaxed);
+        slot.latency_max.store(0, std::memory_order_relaxed);
+
+        for (std::atomic<uint32_t>& bucket : slot.latency_buckets) {
+            bucket.store(0, std::memory_order_relaxed);
+        }
+        slot.number.store(slot_number, std::memory_order_release);
+        break;
+    }
+    const uint64_t value = std::min<uint64_t>(std::max<int64_t>(latency.count(), 0), LatencyHistogram::kMaxValue);
+
+    // A thread stalled for most of a window between the check above and here adds its request to the next use of the
+    // slot instead; rare enough to be left uncorrected.
+    slot.latency_buckets[LatencyHistogram::GetBucketIndex(value) >> kLatencyBucketShift].fetch_add(
+        1, std::memory_order_relaxed);
+    slot.latency_sum.fetch_add(value, std::memory_order_relaxed);
+    StoreMax(slot.latency_max, value);
+
+    if (result_count == 0) {
+        slot.no_result_count.fetch_add(1, std::memory_order_relaxed);
+    }
+    // Last, so a snapshot rarely counts a request whose other counts it missed.
+    slot.request_count.fetch_add(1, std::memory_order_relaxed);
+}
+
+[[nodiscard]] RequestStatistics::Snapshot RequestStatistics::GetSnapshot(Clock::time_point now) const {
+    const uint64_t last_number = GetSlotNumber(now);
+    const uint64_t first_number = last_number + 1 - std::min<uint64_t>(last_number + 1, kSlotCount);
+    const Clock::time_point window_start = start_time_ + static_cast<int64_t>(first_number) * slot_duration_;
+    Snapshot snapshot;
+
+    snapshot.duration = std::max<std::chrono::nanoseconds>(now - window_start, std::chrono::nanoseconds::zero());
+    snapshot.latency.buckets.resize(LatencyHistogram::kBucketCount);
+
+    std::array<uint64_t, kLatencyBucketCount> latency_buckets;
+
+    for (const std::atomic<Shard*>& pointer : shards_) {
+        const Shard* shard = pointer.load(std::memory_order_acquire);
+
+        if (shard == nullptr) {
+            continue;
+        }
+
+        for (const Slot& slot : shard->slots) {
+            const uint64_t number = slot.number.load(std::memory_order_acquire);
+
+            if (number == kNoSlot || number == kClearingSlot || number < first_number || number > last_number) {
+                continue;
+            }
+            const uint64_t request_count = slot.request_count.load(std::memory_order_relaxed);
+            const uint64_t no_result_count = slot.no_result_count.load(std::memory_order_relaxed);
+            const uint64_t latency_sum = slot.latency_sum.load(std::memory_order_relaxed);
+            const uint64_t latency_max = slot.latency_max.load(std::memory_order_relaxed);
+
+            for (size_t index = 0; index < kLatencyBucketCount; ++index) {
+                latency_buckets[index] = slot.latency_buckets[index].load(std::memory_order_relaxed);
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+
+            // A thread cleared the slot for a later one meanwhile, so the counts read may be partly cleared.
+            if (slot.number.load(std::memory_order_relaxed) != number) {
+                continue;
+            }
+            snapshot.request_count += request_count;
+            snapshot.no_result_count += no_result_count;
+            snapshot.latency.count += request_count;
+            snapshot.latency.sum += latency_sum;
+            snapshot.latency.max = std::max(snapshot.latency.max, latency_max);
+
+            // Counted in the last histogram bucket of each group, so percentiles round up to the end of the group.
+            for (size_t index = 0; index < kLatencyBucketCount; ++index) {
+                snapshot.latency.buckets[((index + 1) << kLatencyBucketShift) - 1] += latency_buckets[index];
+            }
+        }
+    }
+
+    return snapshot;
+}
+
+[[nodiscard]] uint64_t RequestStatistics::GetSlotNumber(Clock::time_point now) const {
+    return now > start_time_ ? static_cast<uint64_t>((now - start_time_) / slot_duration_) : 0;
+}
+
+[[nodiscard]] RequestStatistics::Shard& RequestStatistics::GetLocalShard() {
+    std::atomic<Shard*>& pointer = shards_[GetThreadIndex() % kShardCount];
+    Shard* shard = pointer.load(std::memory_order_acquire);
+
+    if (shard == nullptr) {
+        auto created = std::make_unique<Shard>();
+
+        // Otherwise another thread of the shard created it meanwhile, and the pointer now holds that.
+        if (pointer.compare_exchange_strong(shard, created.get(), std::memory_order_acq_rel)) {
+            shard = created.release();
+        }
+    }
+
+    return *shard;
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+#include "metrics.h"
+
+// Statistics of the requests of a sliding window of wall-clock time: how many there were, how many found nothing and
+// how long they took. The window is split into kSlotCount slots and moves one slot at a time, so it covers between
+// kSlotCount - 1 and kSlotCount slots of the past.
+//
+// Requests are recorded to kShardCount rings of kSlotCount slots, created on first use; a thread picks its ring by a
+// small index of its own, so threads rarely share one, and updates it with relaxed atomic additions. A slot that comes
+// round again is claimed and cleared by one of the threads before reuse. A snapshot adds up the slots of all rings
+// within the window. Memory does not grow with the number of requests or of threads.
+class RequestStatistics {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    static constexpr size_t kSlotCount = 32;
+    static constexpr size_t kShardCount = 16;
+
+    struct Options {
+        // At least kSlotCount nanoseconds.
+        std::chrono::nanoseconds window = std::chrono::hours(24);
+    };
+
+    struct Snapshot {
+        // Time the counts were collected over: the window, or less while the statistics are younger than it.
+        std::chrono::nanoseconds duration{0};
+        uint64_t request_count = 0;
+        uint64_t no_result_count = 0;
+        // Latencies in nanoseconds, counted to within an eighth of their value.
+        LatencyHistogram::Snapshot latency;
+
+        // Requests per second; zero for an empty duration.
+        [[nodiscard]] double GetRequestRate() const;
+
+        // Share of the requests that found nothing; zero without requests.
+        [[nodiscard]] double GetNoResultRate() const;
+    };
+
+public:
+    RequestStatistics();
+
+    explicit RequestStatistics(Options options);
+
+    RequestStatistics(const RequestStatistics&) = delete;
+    RequestStatistics& operator=(const RequestStatistics&) = delete;
+
+    ~RequestStatistics();
+
+public:
+    // Records a request that finished at the given time. Latencies beyond LatencyHistogram::kMaxValue count as that.
+    void Record(size_t result_count, std::chrono::nanoseconds latency, Clock::time_point now = Clock::now());
+
+    // Requests of the window ending at the given time.
+    [[nodiscard]] Snapshot GetSnapshot(Clock::time_point now = Clock::now()) const;
+
+private:
+    // Adjacent buckets of a LatencyHistogram are counted together, eight to a bucket: every power-of-two range of
+    // values still gets eight buckets, and a slot stays small.
+    static constexpr int kLatencyBucketShift = 3;
+    static constexpr size_t kLatencyBucketCount = LatencyHistogram::kBucketCount >> kLatencyBucketShift;
+    static constexpr uint64_t kNoSlot = std::numeric_limits<uint64_t>::max();
+    static constexpr uint64_t kClearingSlot = kNoSlot - 1;
+
+    // Counts of the requests the threads of a ring recorded during one slot of time. The number is kClearingSlot
+    // while the slot is being cleared, so a reader can tell when the counts it read were being reused, and another
+    // thread waits for the clearing to finish.
+    struct Slot {
+        std::atomic<uint64_t> number = kNoSlot;
+        std::atomic<uint32_t> request_count = 0;
+        std::atomic<uint32_t> no_result_count = 0;
+        std::atomic<uint64_t> latency_sum = 0;
+        std::atomic<uint64_t> latency_max = 0;
+        std::array<std::atomic<uint32_t>, kLatencyBucketCount> latency_buckets{};
+    };
+
+    struct Shard {
+        std::array<Slot, kSlotCount> slots;
+    };
+
+private:
+    // Number of the slot of time the moment falls into, counted from the creation of the statistics.
+    [[nodiscard]] uint64_t GetSlotNumber(Clock::time_point now) const;
+
+    [[nodiscard]] Shard& GetLocalShard();
+
+private:
+    const Clock::time_point start_time_;
+    const std::chrono::nanoseconds slot_duration_;
+    // Owned; null until a thread records to the shard.
+    std::array<std::atomic<Shard*>, kShardCount> shards_{};
+};
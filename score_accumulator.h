@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Dense relevance accumulator over a contiguous range of document ordinals. It is owned by a single worker, so adding
+// a score is a plain array update. Only the touched slots are reset between queries, which makes reusing one
+// accumulator per thread cheap even for very selective queries.
+class ScoreAccumulator {
+public:
+    ScoreAccumulator() = default;
+
+public:
+    void Reset(size_t slot_count) {
+        for (const uint32_t slot : touched_slots_) {
+            scores_[slot] = 0.0;
+            states_[slot] = SlotState::kEmpty;
+        }
+        touched_slots_.clear();
+
+        if (scores_.size() < slot_count) {
+            scores_.resize(slot_count, 0.0);
+            states_.resize(slot_count, SlotState::kEmpty);
+        }
+    }
+
+    void Add(size_t slot, double score) {
+        switch (states_[slot]) {
+            case SlotState::kEmpty:
+                states_[slot] = SlotState::kScored;
+                touched_slots_.push_back(static_cast<uint32_t>(slot));
+                [[fallthrough]];
+            case SlotState::kScored:
+                scores_[slot] += score;
+                break;
+            case SlotState::kExcluded:
+                break;
+        }
+    }
+
+    void Exclude(size_t slot) {
+        if (states_[slot] == SlotState::kEmpty) {
+            touched_slots_.push_back(static_cast<uint32_t>(slot));
+        }
+        states_[slot] = SlotState::kExcluded;
+    }
+
+    [[nodiscard]] bool IsExcluded(size_t slot) const { return states_[slot] == SlotState::kExcluded; }
+
+    // Calls visitor(slot, score) for every slot that got a score and was not excluded.
+    template <typename Visitor>
+    void ForEachScored(Visitor visitor) const {
+        for (const uint32_t slot : touched_slots_) {
+            if (states_[slot] == SlotState::kScored) {
+                visitor(static_cast<size_t>(slot), scores_[slot]);
+            }
+        }
+    }
+
+private:
+    enum class SlotState : uint8_t {
+        kEmpty,
+        kScored,
+        kExcluded,
+    };
+
+private:
+    std::vector<double> scores_;
+    std::vector<SlotState> states_;
+    std::vector<uint32_t> touched_slots_;
+};
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Corpus statistics scoring models are parameterized by, as of one version of the index.
+struct CorpusStatistics {
+    size_t document_count = 0;
+    // Average number of indexed words of a document.
+    double average_document_length = 0.0;
+};
+
+// Scoring models rank a document by the sum, over the query terms it contains, of the term weight times
+// Score(term_frequency, document_length), where the weight is ComputeInverseDocumentFrequency of the corpus size and
+// the number of documents containing the term, and the term frequency is the share of the document's words that are
+// the term. A model is selected by a template parameter, so scoring inlines into the search loops.
+//
+// Pruned search bounds whole posting lists and blocks of them by their largest term frequency alone, so Score must not
+// decrease as the term frequency grows and must never exceed GetMaxScore of that frequency, whatever the length.
+// Models that ignore the length say so by kUsesDocumentLength, sparing the search loading it.
+struct TfIdfScoring {
+    static constexpr bool kUsesDocumentLength = false;
+
+    explicit TfIdfScoring(const CorpusStatistics&) {}
+
+    [[nodiscard]] static double ComputeInverseDocumentFrequency(size_t document_count, size_t document_frequency) {
+        assert(document_frequency != 0);
+
+        return std::log(document_count * 1.0 / document_frequency);
+    }
+
+    [[nodiscard]] double Score(double term_frequency, uint32_t) const { return term_frequency; }
+
+    [[nodiscard]] double GetMaxScore(double term_frequency) const { return term_frequency; }
+};
+
+// Okapi BM25 with the usual k1 and b. The stored term frequency t is the count of the term over the length l of the
+// document, and the term score t * (k1 + 1) / (t + k1 * (1 - b) / l + k1 * b / average length) is the textbook one
+// with numerator and denominator both divided by l. For a given t it grows with l, so its limit for an unbounded
+// length, t * (k1 + 1) / (t + k1 * b / average length), bounds it from above.
+struct Bm25Scoring {
+    static constexpr bool kUsesDocumentLength = true;
+    static constexpr double kK1 = 1.2;
+    static constexpr double kB = 0.75;
+
+    explicit Bm25Scoring(const CorpusStatistics& statistics)
+        : average_length_term_(kK1 * kB / std::max(statistics.average_document_length, 1.0)) {}
+
+    [[nodiscard]] static double ComputeInverseDocumentFrequency(size_t document_count, size_t document_frequency) {
+        const double document_frequency_term = document_frequency + 0.5;
+
+        return std::log(1.0 + (static_cast<double>(document_count) + 1.0 - document_frequency_term) /
+                                  document_frequency_term);
+    }
+
+    [[nodiscard]] double Score(double term_frequency, uint32_t document_length) const {
+        return term_frequency * (kK1 + 1.0) /
+               (term_frequency + kK1 * (1.0 - kB) / document_length + average_length_term_);
+    }
+
+    [[nodiscard]] double GetMaxScore(double term_frequency) const {
+        return term_frequency * (kK1 + 1.0) / (term_frequency + average_length_term_);
+    }
+
+private:
+    double average_length_term_ = 0.0;
+};
+
+// Term weights of a model for one corpus size, by document frequency: a weight depends on nothing else. Every thread
+// keeps a table per model, filled as document frequencies are first asked for; entries are stamped with the corpus
+// size they were computed for and recomputed once it changes. A query term then costs a table lookup instead of a
+// logarithm. Frequencies beyond the table are computed directly.
+template <typename Scoring>
+class InverseDocumentFrequencyTable {
+public:
+    [[nodiscard]] static double Get(size_t document_count, size_t document_frequency) {
+        if (document_frequency == 0) {
+            return 0.0;
+        }
+
+        if (document_frequency > kMaxTableFrequency) {
+            return Scoring::ComputeInverseDocumentFrequency(document_count, document_frequency);
+        }
+        thread_local std::vector<Entry> entries;
+
+        if (entries.size() <= document_frequency) {
+            entries.resize(std::min(std::max(entries.size() * 2, document_frequency + 1), kMaxTableFrequency + 1));
+        }
+        Entry& entry = entries[document_frequency];
+
+        if (entry.document_count != document_count + 1) {
+            entry.document_count = document_count + 1;
+            entry.value = Scoring::ComputeInverseDocumentFrequency(document_count, document_frequency);
+        }
+
+        return entry.value;
+    }
+
+private:
+    struct Entry {
+        // Corpus size plus one, so a zeroed entry matches none.
+        size_t document_count = 0;
+        double value = 0.0;
+    };
+
+private:
+    static constexpr size_t kMaxTableFrequency = size_t{1} << 16;
+};
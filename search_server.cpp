@@ -1,7 +1,8 @@
 #include "search_server.h"
 
-#include <cassert>
-#include <cmath>
+#include <functional>
+#include <initializer_list>
+#include <unordered_map>
 #include <utility>
 
 #include "string_processing.h"
@@ -12,39 +13,186 @@ SearchServer::SearchServer(const std::string_view stop_words_text)
 SearchServer::SearchServer(const std::string& stop_words_text)
     : SearchServer(string_processing::SplitIntoWords(stop_words_text)) {}
 
+SearchServer::SearchServer(SearchServer&& other) noexcept
+    : version_(other.version_.load()),
+      thread_pool_(other.thread_pool_.load()),
+      storage_(std::move(other.storage_)),
+      stop_words_(std::move(other.stop_words_)),
+      segments_(std::move(other.segments_)),
+      mutable_segment_(std::move(other.mutable_segment_)),
+      mutable_segment_tombstones_(std::move(other.mutable_segment_tombstones_)),
+      document_frequencies_(std::move(other.document_frequencies_)),
+      unused_terms_(std::move(other.unused_terms_)),
+      closed_unused_terms_(std::move(other.closed_unused_terms_)),
+      closed_unused_terms_epoch_(std::move(other.closed_unused_terms_epoch_)),
+      pending_merge_(std::move(other.pending_merge_)),
+      documents_ids_(std::move(other.documents_ids_)),
+      are_file_ids_listed_(other.are_file_ids_listed_),
+      document_count_(other.document_count_),
+      forward_index_usage_(other.forward_index_usage_),
+      total_document_length_(other.total_document_length_),
+      version_number_(other.version_number_),
+      epoch_(std::move(other.epoch_)) {}
+
+SearchServer& SearchServer::operator=(SearchServer&& other) noexcept {
+    const uint64_t version_number = std::max(version_number_, other.version_number_);
+
+    // Waits for the merge running on the old index, if any.
+    pending_merge_ = std::move(other.pending_merge_);
+    thread_pool_ = other.thread_pool_.load();
+    storage_ = std::move(other.storage_);
+    stop_words_ = std::move(other.stop_words_);
+    segments_ = std::move(other.segments_);
+    mutable_segment_ = std::move(other.mutable_segment_);
+    mutable_segment_tombstones_ = std::move(other.mutable_segment_tombstones_);
+    document_frequencies_ = std::move(other.document_frequencies_);
+    unused_terms_ = std::move(other.unused_terms_);
+    closed_unused_terms_ = std::move(other.closed_unused_terms_);
+    closed_unused_terms_epoch_ = std::move(other.closed_unused_terms_epoch_);
+    documents_ids_ = std::move(other.documents_ids_);
+    are_file_ids_listed_ = other.are_file_ids_listed_;
+    document_count_ = other.document_count_;
+    forward_index_usage_ = other.forward_index_usage_;
+    total_document_length_ = other.total_document_length_;
+    version_number_ = version_number;
+    epoch_ = std::move(other.epoch_);
+
+    PublishVersion();
+
+    return *this;
+}
+
 void SearchServer::SetStopWords(const std::string& text) {
+    std::lock_guard guard(write_mutex_);
+
+    std::set<std::string> stop_words(stop_words_->begin(), stop_words_->end());
+
     for (const std::string& word : string_processing::SplitIntoWords(text)) {
-        stop_words_.insert(word);
+        stop_words.insert(word);
     }
+    stop_words_ = std::make_shared<const StopWordFilter>(stop_words);
+
+    PublishVersion();
 }
 
+void SearchServer::SetThreadPool(ThreadPool& thread_pool) { thread_pool_ = &thread_pool; }
+
 void SearchServer::AddDocument(int document_id, const std::string_view document, DocumentStatus document_status,
                                const std::vector<int>& document_ratings) {
+    AddDocument(document_id, document, document_status, document_ratings,
+                [this, document] { return storage_->document_store.Append(document, *epoch_); });
+}
+
+void SearchServer::AddDocument(int document_id, std::string&& document, DocumentStatus document_status,
+                               const std::vector<int>& document_ratings) {
+    AddDocument(document_id, document, document_status, document_ratings,
+                [this, &document] { return storage_->document_store.Append(std::move(document), *epoch_); });
+}
+
+void SearchServer::AddDocument(int document_id, const char* document, DocumentStatus document_status,
+                               const std::vector<int>& document_ratings) {
+    AddDocument(document_id, std::string_view(document), document_status, document_ratings);
+}
+
+template <typename AddText>
+void SearchServer::AddDocument(int document_id, std::string_view document, DocumentStatus document_status,
+                               const std::vector<int>& document_ratings, AddText&& add_text) {
+    LOG_DURATION_HISTOGRAM(GetLatencyHistogram<Operation::kAddDocument>());
+
+    std::lock_guard guard(write_mutex_);
+
     if (!IsValidDocumentId(document_id)) {
         throw std::invalid_argument("Error adding document. Invalid document id!");
     }
-    DocumentData document_data{ComputeAverageRating(document_ratings), document_status,
-                               std::move(std::string{document.begin(), document.end()})};
+    std::vector<std::string_view> words;
 
-    documents_ids_.insert(document_id);
-    documents_.emplace(document_id, document_data);
+    SplitIntoWordsNoStop(document, words);
+
+    const auto ordinal = static_cast<DocumentOrdinal>(storage_->documents.size());
 
-    const std::vector<std::string_view> words = SplitIntoWordsNoStop(documents_.at(document_id).raw_data);
-    const double inverse_word_count = 1.0 / static_cast<int>(words.size());
+    std::vector<TermId> term_ids(words.size());
 
-    for (const std::string_view word : words) {
-        word_to_document_frequencies_[word][document_id] += inverse_word_count;
-        words_in_document_frequencies_[document_id][word] += inverse_word_count;
+    std::transform(words.begin(), words.end(), term_ids.begin(),
+                   [this](std::string_view word) { return storage_->terms.Intern(word, *epoch_); });
+
+    document_frequencies_.resize(storage_->terms.size());
+
+    std::vector<TermFrequency> document_frequencies = ComputeTermFrequencies(std::move(term_ids));
+
+    mutable_segment_->AddDocument(ordinal);
+
+    for (const auto& [term_id, term_frequency] : document_frequencies) {
+        mutable_segment_->AddPosting(term_id, term_frequency, *epoch_);
+        ++document_frequencies_.GetMutable(term_id, *epoch_);
+    }
+
+    StoreDocument(document_id, ComputeAverageRating(document_ratings), document_status,
+                  static_cast<uint32_t>(words.size()), add_text(),
+                  {CowArray<TermFrequency>(std::move(document_frequencies))});
+
+    if (mutable_segment_->GetDocumentCount() >= kMaxMutableSegmentDocuments) {
+        SealMutableSegment();
     }
+    MaintainSegments();
+    PublishVersion();
+}
+
+void SearchServer::AddDocuments(std::span<const DocumentToAdd> documents) {
+    AddDocuments(std::execution::seq, documents);
 }
 
 [[nodiscard]] const std::vector<Document> SearchServer::FindTopDocuments(const std::string_view raw_query,
-                                                                         DocumentStatus document_status) const {
-    return FindTopDocuments(
-        raw_query, [=](int document_id, DocumentStatus status, int rating) { return status == document_status; });
+                                                                         DocumentStatus document_status,
+                                                                         size_t top_document_count) const {
+    LOG_DURATION_HISTOGRAM((GetLatencyHistogram<Operation::kFindTopDocuments, std::execution::sequenced_policy>()));
+
+    const std::shared_ptr<const Version> version = PinVersion();
+    const QueryCache::TextKey text_key{std::string(raw_query), document_status, top_document_count};
+
+    if (const QueryCache::Documents cached = query_cache_.FindByText(text_key, version->number)) {
+        return *cached;
+    }
+    const Query query = ParseQuery(*version, raw_query);
+    QueryCache::Key key{query.plus_terms, query.minus_terms, document_status, top_document_count};
+    QueryCache::Documents found = query_cache_.Find(key, version->number);
+
+    if (!found) {
+        found = std::make_shared<const std::vector<Document>>(FindTopDocumentsForQuery(
+            std::execution::seq, *version, query, ComputeInverseDocumentFrequencies<TfIdfScoring>(*version, query),
+            TfIdfScoring(GetCorpusStatistics(*version)),
+            [=](int, DocumentStatus status, int) { return status == document_status; }, top_document_count));
+    }
+    query_cache_.Insert(text_key, std::move(key), version->number, found);
+
+    return *found;
 }
 
-[[nodiscard]] int SearchServer::GetDocumentCount() const { return static_cast<int>(documents_.size()); }
+[[nodiscard]] std::vector<std::vector<Document>> SearchServer::FindTopDocumentsBatch(
+    std::span<const std::string> raw_queries, DocumentStatus document_status, size_t top_document_count) const {
+    return FindTopDocumentsBatch(GetThreadPool(), raw_queries, document_status, top_document_count);
+}
+
+[[nodiscard]] std::vector<std::vector<Document>> SearchServer::FindTopDocumentsBatch(
+    ThreadPool& thread_pool, std::span<const std::string> raw_queries, DocumentStatus document_status,
+    size_t top_document_count) const {
+    const std::shared_ptr<const Version> version = PinVersion();
+    std::vector<std::vector<Document>> results(raw_queries.size());
+    const size_t chunk_count = (raw_queries.size() + kBatchChunkSize - 1) / kBatchChunkSize;
+
+    thread_pool.ParallelFor(chunk_count, [&](size_t chunk) {
+        const size_t begin = chunk * kBatchChunkSize;
+        const size_t size = std::min(kBatchChunkSize, raw_queries.size() - begin);
+
+        FindTopDocumentsInBatchChunk(*version, raw_queries.subspan(begin, size), document_status, top_document_count,
+                                     std::span(results).subspan(begin, size));
+    });
+
+    return results;
+}
+
+[[nodiscard]] int SearchServer::GetDocumentCount() const { return static_cast<int>(PinVersion()->document_count); }
+
+[[nodiscard]] QueryCache::Stats SearchServer::GetQueryCacheStats() const { return query_cache_.GetStats(); }
 
 std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchDocument(std::string_view raw_query,
                                                                                       int document_id) const {
@@ -52,32 +200,773 @@ std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchDoc
 }
 
 [[nodiscard]] const std::map<std::string_view, double> SearchServer::GetWordFrequencies(int document_id) const {
-    static std::map<std::string_view, double> empty_response;
+    static const std::map<std::string_view, double> empty_response;
 
-    if (words_in_document_frequencies_.count(document_id) == 0) {
+    const std::shared_ptr<const Version> version = PinVersion();
+    const DocumentOrdinal ordinal = FindDocumentOrdinal(*version, document_id);
+
+    if (ordinal == kNoOrdinal) {
         return empty_response;
     }
     std::map<std::string_view, double> response;
 
-    for (const auto& item : words_in_document_frequencies_.at(document_id)) {
-        response.insert(item);
+    for (const auto& [term_id, frequency] : version->storage->documents[ordinal].terms) {
+        response.emplace(version->storage->terms.GetTerm(term_id), frequency);
     }
 
     return response;
 }
 
+[[nodiscard]] std::string SearchServer::GetDocumentText(int document_id) const {
+    const std::shared_ptr<const Version> version = PinVersion();
+    const DocumentOrdinal ordinal = FindDocumentOrdinal(*version, document_id);
+
+    if (ordinal == kNoOrdinal) {
+        return {};
+    }
+    DocumentStore::Reader reader(version->storage->document_store);
+
+    return std::string(reader.Read(version->storage->documents[ordinal].text));
+}
+
+std::vector<std::tuple<std::vector<std::string_view>, DocumentStatus>> SearchServer::MatchDocuments(
+    std::string_view raw_query, std::span<const int> document_ids) const {
+    return MatchDocuments(std::execution::seq, raw_query, document_ids);
+}
+
 void SearchServer::RemoveDocument(int document_id) { return RemoveDocument(std::execution::seq, document_id); }
 
-std::set<int>::const_iterator SearchServer::begin() const { return documents_ids_.begin(); }
+void SearchServer::RemoveDocuments(std::span<const int> document_ids) {
+    LOG_DURATION_HISTOGRAM(GetLatencyHistogram<Operation::kRemoveDocument>());
+
+    std::lock_guard guard(write_mutex_);
+    const std::shared_ptr<const Version> version = PinVersion();
+    bool is_modified = false;
+
+    for (const int document_id : document_ids) {
+        // Not looked up in a pinned version, which still finds a document removed earlier in the batch.
+        const DocumentOrdinal ordinal = FindLiveOrdinal(document_id);
+
+        if (ordinal == kNoOrdinal) {
+            continue;
+        }
+        RemoveStoredDocument(ordinal);
+        is_modified = true;
+    }
+
+    if (is_modified) {
+        MaintainSegments();
+        PublishVersion();
+    }
+}
+
+[[nodiscard]] MemoryStats SearchServer::GetMemoryStats() const {
+    // A node of the red-black tree of a std::set<int>: color, parent and children pointers, then the value.
+    static constexpr size_t kIdNodeSize = 4 * sizeof(void*);
+
+    std::lock_guard guard(write_mutex_);
+    MemoryStats stats;
+
+    const Storage& storage = *storage_;
+
+    stats.term_dictionary = storage.terms.GetMemoryUsage();
+
+    const size_t term_count = stats.term_dictionary.object_count;
+
+    stats.term_dictionary += document_frequencies_.GetMemoryUsage();
+    stats.term_dictionary.object_count = term_count;
+
+    for (const SegmentEntry& entry : segments_) {
+        stats.postings += entry.segment->GetMemoryUsage();
+        stats.postings += entry.tombstones.GetMemoryUsage();
+    }
+    stats.postings += mutable_segment_->GetMemoryUsage();
+    stats.postings += mutable_segment_tombstones_.GetMemoryUsage();
+    // The entries themselves hold no postings.
+    stats.postings.bytes += segments_.capacity() * sizeof(SegmentEntry);
+
+    stats.forward_index = forward_index_usage_;
+
+    stats.document_metadata = storage.documents.GetMemoryUsage();
+    stats.document_metadata += storage.document_lengths.GetMemoryUsage();
+    stats.document_metadata += storage.removal_versions.GetMemoryUsage();
+    stats.document_metadata += storage.document_ordinals.GetMemoryUsage();
+    stats.document_metadata += storage.ordinals_by_id.GetMemoryUsage();
+    stats.document_metadata += GetMemoryUsage(storage.document_contents);
+    stats.document_metadata.object_count = storage.documents.size();
+
+    stats.document_texts = storage.document_store.GetMemoryUsage();
+    stats.stop_words = stop_words_->GetMemoryUsage();
+    stats.document_ids = {documents_ids_.size() * kIdNodeSize, documents_ids_.size(), documents_ids_.size()};
+
+    for (const MemoryUsage* usage :
+         {&stats.term_dictionary, &stats.postings, &stats.forward_index, &stats.document_metadata,
+          &stats.document_texts, &stats.stop_words, &stats.document_ids}) {
+        stats.allocator_overhead_bytes += usage->allocation_count * MemoryStats::kAllocationOverhead;
+    }
+
+    if (storage.mapped_file) {
+        stats.mapped_bytes = storage.mapped_file->GetData().size();
+    }
+
+    return stats;
+}
+
+[[nodiscard]] size_t SearchServer::GetSegmentCount() const { return PinVersion()->segments.size(); }
+
+void SearchServer::WaitForMerges() {
+    std::lock_guard guard(write_mutex_);
+
+    while (pending_merge_) {
+        pending_merge_->result.wait();
+        MaintainSegments();
+    }
+    PublishVersion();
+}
+
+void SearchServer::Compact() {
+    std::lock_guard guard(write_mutex_);
+
+    // The rebuilt index replaces the segments, so a running merge is only waited for.
+    pending_merge_.reset();
+
+    const std::shared_ptr<const Version> version = PinVersion();
+    DocumentStore::Reader reader(storage_->document_store);
+    std::vector<std::string> texts;
+    std::vector<DocumentToAdd> documents;
+
+    texts.reserve(version->document_count);
+    documents.reserve(version->document_count);
+
+    for (DocumentOrdinal ordinal = 0; ordinal < version->end_ordinal; ++ordinal) {
+        if (IsRemoved(*version, ordinal)) {
+            continue;
+        }
+        const DocumentData& document_data = storage_->documents[ordinal];
+
+        texts.emplace_back(reader.Read(document_data.text));
+        documents.push_back({document_data.id, {}, document_data.status, {document_data.rating}});
+    }
+
+    // Views are taken once the texts stopped moving.
+    for (size_t i = 0; i < documents.size(); ++i) {
+        documents[i].text = texts[i];
+    }
+    SearchServer compacted(std::string_view{});
+
+    compacted.stop_words_ = stop_words_;
+    compacted.thread_pool_ = thread_pool_.load();
+    compacted.AddDocuments(std::execution::par, documents);
+
+    // Readers keep the old storage and segments through the versions they hold. Versions only view the chunks of
+    // the document frequency table, though, so the old table is retired.
+    epoch_->Retire(std::make_shared<const VersionedArray<uint32_t>>(std::move(document_frequencies_)));
+
+    storage_ = std::move(compacted.storage_);
+    segments_ = std::move(compacted.segments_);
+    mutable_segment_ = std::move(compacted.mutable_segment_);
+    mutable_segment_tombstones_ = std::move(compacted.mutable_segment_tombstones_);
+    document_frequencies_ = std::move(compacted.document_frequencies_);
+    pending_merge_ = std::move(compacted.pending_merge_);
+    // Ids of an opened file would be listed from the old storage, so the complete list is taken over.
+    documents_ids_ = std::move(compacted.documents_ids_);
+    are_file_ids_listed_ = true;
+    forward_index_usage_ = compacted.forward_index_usage_;
+    // Their ids belong to the old dictionary, which goes away with the old storage.
+    unused_terms_.clear();
+    closed_unused_terms_.clear();
+
+    PublishVersion();
+}
+
+void SearchServer::SaveToFile(const std::string& path) const { SaveToFile(*PinVersion(), path); }
+
+void SearchServer::SaveToFile(const Version& version, const std::string& path) const {
+    using index_file::Section;
+
+    const Storage& storage = *version.storage;
+    const DocumentOrdinal end_ordinal = version.end_ordinal;
+
+    std::vector<TermId> saved_term_ids(version.document_frequencies.size(), TermDictionary::kNoTerm);
+    std::vector<uint64_t> term_offsets{0};
+    std::string term_characters;
+    std::vector<uint64_t> posting_offsets{0};
+    std::vector<DocumentOrdinal> posting_ordinals;
+    std::vector<double> posting_term_frequencies;
+    std::vector<uint64_t> block_max_offsets{0};
+    std::vector<double> block_max_term_frequencies;
+
+    // Live documents are renumbered in ordinal order, so posting lists stay sorted without being rebuilt.
+    std::vector<DocumentOrdinal> saved_ordinals(end_ordinal, 0);
+
+    for (DocumentOrdinal ordinal = 0, saved_ordinal = 0; ordinal < end_ordinal; ++ordinal) {
+        if (!IsRemoved(version, ordinal)) {
+            saved_ordinals[ordinal] = saved_ordinal++;
+        }
+    }
+
+    // Terms are written in sorted order, so an opened file looks them up in place.
+    std::vector<TermId> live_term_ids;
+
+    for (TermId term_id = 0; term_id < version.document_frequencies.size(); ++term_id) {
+        if (version.document_frequencies[term_id] != 0) {
+            live_term_ids.push_back(term_id);
+        }
+    }
+    std::sort(live_term_ids.begin(), live_term_ids.end(), [&storage](TermId lhs, TermId rhs) {
+        return storage.terms.GetTerm(lhs) < storage.terms.GetTerm(rhs);
+    });
+
+    // Postings of a term are collected from all segments into a single list without the deleted documents.
+    for (const TermId term_id : live_term_ids) {
+        PostingList postings;
+
+        ForEachSegment(version, [&](const auto& segment) {
+            const PostingList segment_postings = segment.GetPostings(term_id);
+            const std::span<const DocumentOrdinal> ordinals = segment_postings.GetOrdinals();
+            const std::span<const double> term_frequencies = segment_postings.GetTermFrequencies();
+
+            for (size_t i = 0; i < ordinals.size(); ++i) {
+                if (!IsRemoved(version, ordinals[i])) {
+                    postings.Add(saved_ordinals[ordinals[i]], term_frequencies[i]);
+                }
+            }
+        });
+        saved_term_ids[term_id] = static_cast<TermId>(term_offsets.size() - 1);
+        term_characters += storage.terms.GetTerm(term_id);
+        term_offsets.push_back(term_characters.size());
+
+        const auto ordinals = postings.GetOrdinals();
+        const auto term_frequencies = postings.GetTermFrequencies();
+        const auto block_maxima = postings.GetBlockMaxTermFrequencies();
+
+        posting_ordinals.insert(posting_ordinals.end(), ordinals.begin(), ordinals.end());
+
+        posting_term_frequencies.insert(posting_term_frequencies.end(), term_frequencies.begin(),
+                                        term_frequencies.end());
+        posting_offsets.push_back(posting_ordinals.size());
+        block_max_term_frequencies.insert(block_max_term_frequencies.end(), block_maxima.begin(), block_maxima.end());
+        block_max_offsets.push_back(block_max_term_frequencies.size());
+    }
+
+    std::vector<index_file::DocumentRecord> document_records;
+    std::vector<uint64_t> forward_index_offsets{0};
+    std::vector<TermFrequency> forward_index;
+    std::vector<uint64_t> text_offsets{0};
+    std::string texts;
+    DocumentStore::Reader text_reader(storage.document_store);
+
+    for (DocumentOrdinal ordinal = 0; ordinal < end_ordinal; ++ordinal) {
+        if (IsRemoved(version, ordinal)) {
+            continue;
+        }
+        const DocumentData& document_data = storage.documents[ordinal];
+
+        document_records.push_back({document_data.id, document_data.rating,
+                                    static_cast<int32_t>(document_data.status), storage.document_lengths[ordinal]});
+
+        const auto document_terms_begin = static_cast<std::ptrdiff_t>(forward_index.size());
+
+        for (const auto& [term_id, frequency] : document_data.terms) {
+            forward_index.push_back({saved_term_ids[term_id], frequency});
+        }
+        // Renumbering the terms reorders them, and document terms are kept sorted by id.
+        std::sort(forward_index.begin() + document_terms_begin, forward_index.end(),
+                  [](const TermFrequency& lhs, const TermFrequency& rhs) { return lhs.term_id < rhs.term_id; });
+        forward_index_offsets.push_back(forward_index.size());
+
+        texts.append(text_reader.Read(document_data.text));
+        text_offsets.push_back(texts.size());
+    }
+
+    std::vector<DocumentOrdinal> ordinals_by_id(document_records.size());
+
+    std::iota(ordinals_by_id.begin(), ordinals_by_id.end(), 0);
+    std::sort(ordinals_by_id.begin(), ordinals_by_id.end(),
+              [&document_records](DocumentOrdinal lhs, DocumentOrdinal rhs) {
+                  return document_records[lhs].id < document_records[rhs].id;
+              });
+
+    std::string stop_words;
+
+    for (const std::string& stop_word : *version.stop_words) {
+        stop_words += stop_word + ' ';
+    }
+
+    index_file::Writer writer(path);
+
+    writer.WriteSection(Section::kStopWords, std::span<const char>(stop_words));
+    writer.WriteSection(Section::kTermOffsets, std::span<const uint64_t>(term_offsets));
+    writer.WriteSection(Section::kTerms, std::span<const char>(term_characters));
+    writer.WriteSection(Section::kPostingOffsets, std::span<const uint64_t>(posting_offsets));
+    writer.WriteSection(Section::kPostingOrdinals, std::span<const DocumentOrdinal>(posting_ordinals));
+    writer.WriteSection(Section::kPostingTermFrequencies, std::span<const double>(posting_term_frequencies));
+    writer.WriteSection(Section::kBlockMaxOffsets, std::span<const uint64_t>(block_max_offsets));
+    writer.WriteSection(Section::kBlockMaxTermFrequencies, std::span<const double>(block_max_term_frequencies));
+    writer.WriteSection(Section::kDocuments, std::span<const index_file::DocumentRecord>(document_records));
+    writer.WriteSection(Section::kForwardIndexOffsets, std::span<const uint64_t>(forward_index_offsets));
+    writer.WriteSection(Section::kForwardIndex, std::span<const TermFrequency>(forward_index));
+    writer.WriteSection(Section::kTextOffsets, std::span<const uint64_t>(text_offsets));
+    writer.WriteSection(Section::kTexts, std::span<const char>(texts));
+    writer.WriteSection(Section::kOrdinalsById, std::span<const DocumentOrdinal>(ordinals_by_id));
+    writer.Finish(term_offsets.size() - 1, document_records.size());
+}
+
+[[nodiscard]] SearchServer SearchServer::OpenFile(const std::string& path) {
+    auto mapped_file = std::make_shared<const index_file::MappedFile>(path);
+    const FileSections sections = ReadFileSections(index_file::Reader(mapped_file));
+    const uint64_t term_count = sections.term_count;
+    const uint64_t document_count = sections.document_count;
+
+    SearchServer search_server(std::string(sections.stop_words.begin(), sections.stop_words.end()));
+    Storage& storage = *search_server.storage_;
+
+    if (sections.format_version >= 3) {
+        storage.terms.AttachSortedTerms(sections.term_offsets, sections.term_characters);
+    } else {
+        for (uint64_t term = 0; term < term_count; ++term) {
+            storage.terms.InternExternal({sections.term_characters.data() + sections.term_offsets[term],
+                                          sections.term_offsets[term + 1] - sections.term_offsets[term]},
+                                         *search_server.epoch_);
+        }
+    }
+    search_server.document_frequencies_.resize(term_count);
+
+    for (uint64_t term = 0; term < term_count; ++term) {
+        search_server.document_frequencies_.GetMutable(term, *search_server.epoch_) =
+            static_cast<uint32_t>(sections.posting_offsets[term + 1] - sections.posting_offsets[term]);
+    }
+    std::vector<TermId> term_ids(term_count);
+
+    std::iota(term_ids.begin(), term_ids.end(), 0);
+
+    // The whole file becomes a single segment viewing the mapped postings.
+    if (document_count > 0) {
+        search_server.segments_.push_back(
+            {std::make_shared<const Segment>(
+                 0, static_cast<DocumentOrdinal>(document_count), document_count,
+                 CowArray<TermId>(std::move(term_ids)), CowArray<uint64_t>(sections.posting_offsets),
+                 CowArray<DocumentOrdinal>(sections.posting_ordinals),
+                 CowArray<double>(sections.posting_term_frequencies), CowArray<uint64_t>(sections.block_max_offsets),
+                 CowArray<double>(sections.block_max_term_frequencies)),
+             {}});
+    }
+    search_server.mutable_segment_ = std::make_shared<MutableSegment>(static_cast<DocumentOrdinal>(document_count));
+    storage.document_contents.reserve(document_count);
+
+    const uint32_t text_block = storage.document_store.AddView(sections.texts, *search_server.epoch_);
+    const bool has_document_lengths = sections.format_version >= 2;
+    std::vector<std::string_view> words;
+
+    // Records are appended directly: ids are found through the ordinals by id rather than hashed one by one.
+    for (uint64_t ordinal = 0; ordinal < document_count; ++ordinal) {
+        const index_file::DocumentRecord& record = sections.document_records[ordinal];
+        const uint64_t text_offset = sections.text_offsets[ordinal];
+        const TextLocation text{text_block, static_cast<uint32_t>(sections.text_offsets[ordinal + 1] - text_offset),
+                                text_offset};
+        const uint64_t terms_offset = sections.forward_index_offsets[ordinal];
+        const auto terms = sections.forward_index.subspan(terms_offset,
+                                                          sections.forward_index_offsets[ordinal + 1] - terms_offset);
+        uint32_t length = record.length;
+
+        if (!has_document_lengths) {
+            try {
+                search_server.SplitIntoWordsNoStop({sections.texts.data() + text.offset, text.length}, words);
+            } catch (const std::invalid_argument&) {
+                throw index_file::FormatError("Index file has invalid document texts");
+            }
+            length = static_cast<uint32_t>(words.size());
+        }
+        storage.document_contents.push_back({CowArray<TermFrequency>(terms)});
+        search_server.forward_index_usage_ += storage.document_contents.back().terms.GetMemoryUsage();
+        storage.documents.push_back(
+            {record.id, record.rating, static_cast<DocumentStatus>(record.status), text, terms, kNoOrdinal});
+        storage.document_lengths.push_back(length);
+        storage.removal_versions.emplace_back();
+        search_server.total_document_length_ += length;
+    }
+    search_server.document_count_ = document_count;
+
+    if (sections.format_version >= 3) {
+        storage.ordinals_by_id = CowArray<DocumentOrdinal>(sections.ordinals_by_id);
+    } else {
+        std::vector<DocumentOrdinal> ordinals_by_id(document_count);
+
+        std::iota(ordinals_by_id.begin(), ordinals_by_id.end(), 0);
+        std::sort(ordinals_by_id.begin(), ordinals_by_id.end(), [&sections](DocumentOrdinal lhs, DocumentOrdinal rhs) {
+            return sections.document_records[lhs].id < sections.document_records[rhs].id;
+        });
+        storage.ordinals_by_id = CowArray<DocumentOrdinal>(std::move(ordinals_by_id));
+    }
+    search_server.are_file_ids_listed_ = document_count == 0;
+    storage.mapped_file = std::move(mapped_file);
+    search_server.PublishVersion();
+
+    return search_server;
+}
+
+void SearchServer::VerifyFile(const std::string& path) {
+    const auto mapped_file = std::make_shared<const index_file::MappedFile>(path);
+    const FileSections sections = ReadFileSections(index_file::Reader(mapped_file));
+    const uint64_t term_count = sections.term_count;
+    const uint64_t document_count = sections.document_count;
+
+    for (uint64_t term = 0; term < term_count; ++term) {
+        const auto ordinals = sections.posting_ordinals.subspan(
+            sections.posting_offsets[term], sections.posting_offsets[term + 1] - sections.posting_offsets[term]);
+        const uint64_t block_count = (ordinals.size() + PostingList::kBlockSize - 1) / PostingList::kBlockSize;
+
+        if (sections.block_max_offsets[term + 1] - sections.block_max_offsets[term] != block_count ||
+            std::adjacent_find(ordinals.begin(), ordinals.end(), std::greater_equal<>()) != ordinals.end() ||
+            (!ordinals.empty() && ordinals.back() >= document_count)) {
+            throw index_file::FormatError("Index file has invalid postings");
+        }
+    }
+
+    if (sections.format_version >= 3) {
+        for (uint64_t term = 1; term < term_count; ++term) {
+            const auto get_term = [&sections](uint64_t index) {
+                return std::string_view(sections.term_characters.data() + sections.term_offsets[index],
+                                        sections.term_offsets[index + 1] - sections.term_offsets[index]);
+            };
+
+            if (!(get_term(term - 1) < get_term(term))) {
+                throw index_file::FormatError("Index file has unsorted terms");
+            }
+        }
+    }
+
+    if (std::any_of(sections.forward_index.begin(), sections.forward_index.end(),
+                    [term_count](const TermFrequency& term) { return term.term_id >= term_count; })) {
+        throw index_file::FormatError("Index file has invalid document terms");
+    }
+
+    for (const index_file::DocumentRecord& record : sections.document_records) {
+        if (record.id < 0 || record.status < static_cast<int32_t>(DocumentStatus::kActual) ||
+            record.status > static_cast<int32_t>(DocumentStatus::kRemoved)) {
+            throw index_file::FormatError("Index file has invalid documents");
+        }
+    }
+    std::vector<int32_t> document_ids;
+
+    // Ids strictly ascending through the ordinals by id also makes those a permutation of the ordinals.
+    if (sections.format_version >= 3) {
+        for (const DocumentOrdinal ordinal : sections.ordinals_by_id) {
+            if (ordinal >= document_count) {
+                throw index_file::FormatError("Index file has invalid ordinals by id");
+            }
+            document_ids.push_back(sections.document_records[ordinal].id);
+        }
+
+        if (std::adjacent_find(document_ids.begin(), document_ids.end(), std::greater<>()) != document_ids.end()) {
+            throw index_file::FormatError("Index file has unsorted ordinals by id");
+        }
+    } else {
+        for (const index_file::DocumentRecord& record : sections.document_records) {
+            document_ids.push_back(record.id);
+        }
+        std::sort(document_ids.begin(), document_ids.end());
+    }
+
+    if (std::adjacent_find(document_ids.begin(), document_ids.end()) != document_ids.end()) {
+        throw index_file::FormatError("Index file has duplicate document ids");
+    }
+}
+
+[[nodiscard]] SearchServer::FileSections SearchServer::ReadFileSections(const index_file::Reader& reader) {
+    using index_file::Section;
+
+    FileSections sections;
+
+    sections.format_version = reader.GetHeader().format_version;
+    sections.term_count = reader.GetHeader().term_count;
+    sections.document_count = reader.GetHeader().document_count;
+    sections.stop_words = reader.GetSection<char>(Section::kStopWords);
+    sections.term_offsets = reader.GetSection<uint64_t>(Section::kTermOffsets);
+    sections.term_characters = reader.GetSection<char>(Section::kTerms);
+    sections.posting_offsets = reader.GetSection<uint64_t>(Section::kPostingOffsets);
+    sections.posting_ordinals = reader.GetSection<DocumentOrdinal>(Section::kPostingOrdinals);
+    sections.posting_term_frequencies = reader.GetSection<double>(Section::kPostingTermFrequencies);
+    sections.block_max_offsets = reader.GetSection<uint64_t>(Section::kBlockMaxOffsets);
+    sections.block_max_term_frequencies = reader.GetSection<double>(Section::kBlockMaxTermFrequencies);
+    sections.document_records = reader.GetSection<index_file::DocumentRecord>(Section::kDocuments);
+    sections.forward_index_offsets = reader.GetSection<uint64_t>(Section::kForwardIndexOffsets);
+    sections.forward_index = reader.GetSection<TermFrequency>(Section::kForwardIndex);
+    sections.text_offsets = reader.GetSection<uint64_t>(Section::kTextOffsets);
+    sections.texts = reader.GetSection<char>(Section::kTexts);
+    sections.ordinals_by_id = reader.GetSection<DocumentOrdinal>(Section::kOrdinalsById);
+
+    const uint64_t term_count = sections.term_count;
+    const uint64_t document_count = sections.document_count;
+
+    // Offset tables are checked element by element: every other section is addressed through them.
+    const auto is_valid_offsets = [](std::span<const uint64_t> offsets, uint64_t count, size_t data_size) {
+        return offsets.size() == count + 1 && offsets.front() == 0 && offsets.back() == data_size &&
+               std::is_sorted(offsets.begin(), offsets.end());
+    };
 
-std::set<int>::const_iterator SearchServer::end() const { return documents_ids_.end(); }
+    if (!is_valid_offsets(sections.term_offsets, term_count, sections.term_characters.size()) ||
+        !is_valid_offsets(sections.posting_offsets, term_count, sections.posting_ordinals.size()) ||
+        !is_valid_offsets(sections.block_max_offsets, term_count, sections.block_max_term_frequencies.size()) ||
+        !is_valid_offsets(sections.forward_index_offsets, document_count, sections.forward_index.size()) ||
+        !is_valid_offsets(sections.text_offsets, document_count, sections.texts.size()) ||
+        sections.document_records.size() != document_count ||
+        sections.posting_term_frequencies.size() != sections.posting_ordinals.size() ||
+        (sections.format_version >= 3 && sections.ordinals_by_id.size() != document_count)) {
+        throw index_file::FormatError("Index file is corrupted");
+    }
+
+    return sections;
+}
+
+std::set<int>::const_iterator SearchServer::begin() const {
+    ListFileDocumentIds();
+
+    return documents_ids_.begin();
+}
+
+std::set<int>::const_iterator SearchServer::end() const {
+    ListFileDocumentIds();
+
+    return documents_ids_.end();
+}
 
 [[nodiscard]] bool SearchServer::IsValidWord(const std::string_view word) {
-    return none_of(word.begin(), word.end(), [](char symbol) { return symbol >= '\0' && symbol < ' '; });
+    return std::none_of(word.begin(), word.end(), [](char symbol) { return symbol >= '\0' && symbol < ' '; });
 }
 
 [[nodiscard]] bool SearchServer::IsValidDocumentId(const int& document_id) const {
-    return document_id >= 0 || documents_.count(document_id) > 0;
+    return document_id >= 0 && FindLiveOrdinal(document_id) == kNoOrdinal;
+}
+
+[[nodiscard]] ThreadPool& SearchServer::GetThreadPool() const {
+    ThreadPool* const thread_pool = thread_pool_.load();
+
+    return thread_pool != nullptr ? *thread_pool : ThreadPool::GetDefault();
+}
+
+[[nodiscard]] std::shared_ptr<const SearchServer::Version> SearchServer::PinVersion() const { return version_.load(); }
+
+void SearchServer::PublishVersion() {
+    auto version = std::make_shared<Version>();
+
+    version->number = ++version_number_;
+    version->stop_words = stop_words_;
+    version->segments.reserve(segments_.size());
+
+    for (const SegmentEntry& entry : segments_) {
+        version->segments.push_back(entry.segment);
+    }
+    version->mutable_segment = mutable_segment_;
+    version->document_frequencies = document_frequencies_.Publish();
+    version->end_ordinal = static_cast<DocumentOrdinal>(storage_->documents.size());
+    version->document_count = document_count_;
+    version->total_document_length = total_document_length_;
+    version->storage = storage_;
+
+    DropUnusedTerms();
+
+    // Memory retired from now on may be in use by readers of this version.
+    epoch_ = epoch_->Advance();
+    version->epoch = epoch_;
+
+    version_.store(std::move(version));
+}
+
+void SearchServer::DropUnusedTerms() {
+    if (!closed_unused_terms_epoch_.expired()) {
+        return;
+    }
+    std::sort(unused_terms_.begin(), unused_terms_.end());
+    unused_terms_.erase(std::unique(unused_terms_.begin(), unused_terms_.end()), unused_terms_.end());
+
+    for (const TermId term_id : closed_unused_terms_) {
+        // Used again since, or left without documents once more in a version that may still be in use.
+        if (document_frequencies_[term_id] != 0 ||
+            std::binary_search(unused_terms_.begin(), unused_terms_.end(), term_id)) {
+            continue;
+        }
+
+        if (std::shared_ptr<const void> memory = storage_->terms.Remove(term_id)) {
+            epoch_->Retire(std::move(memory));
+        }
+    }
+    // The current version is the last one in which the collected terms may still have documents.
+    closed_unused_terms_ = std::move(unused_terms_);
+    unused_terms_.clear();
+    closed_unused_terms_epoch_ = epoch_;
+}
+
+[[nodiscard]] bool SearchServer::IsRemoved(const Version& version, DocumentOrdinal ordinal) const {
+    const uint64_t removal_version = version.storage->removal_versions[ordinal].load(std::memory_order_relaxed);
+
+    return removal_version != 0 && removal_version <= version.number;
+}
+
+[[nodiscard]] DocumentOrdinal SearchServer::FindDocumentOrdinal(const Version& version, int document_id) const {
+    const Storage& storage = *version.storage;
+    DocumentOrdinal ordinal = FindLatestOrdinal(storage, document_id);
+
+    // Documents re-added after the version was published are newer than it: the one it knows came before them.
+    while (ordinal != kNoOrdinal && ordinal >= version.end_ordinal) {
+        ordinal = storage.documents[ordinal].previous_ordinal;
+    }
+
+    return ordinal == kNoOrdinal || IsRemoved(version, ordinal) ? kNoOrdinal : ordinal;
+}
+
+[[nodiscard]] DocumentOrdinal SearchServer::FindLatestOrdinal(const Storage& storage, int document_id) {
+    const DocumentOrdinal ordinal =
+        storage.document_ordinals.Find(document_id, [&storage](uint32_t index) { return storage.documents[index].id; });
+
+    if (ordinal != kNoOrdinal) {
+        return ordinal;
+    }
+    const std::span<const DocumentOrdinal> ordinals_by_id = storage.ordinals_by_id.GetSpan();
+    const auto found = std::lower_bound(
+        ordinals_by_id.begin(), ordinals_by_id.end(), document_id,
+        [&storage](DocumentOrdinal file_ordinal, int id) { return storage.documents[file_ordinal].id < id; });
+
+    return found != ordinals_by_id.end() && storage.documents[*found].id == document_id ? *found : kNoOrdinal;
+}
+
+[[nodiscard]] DocumentOrdinal SearchServer::FindLiveOrdinal(int document_id) const {
+    const DocumentOrdinal ordinal = FindLatestOrdinal(*storage_, document_id);
+
+    // Every earlier ordinal of the id was removed before the latest one was stored.
+    return ordinal != kNoOrdinal && storage_->removal_versions[ordinal].load(std::memory_order_relaxed) == 0
+               ? ordinal
+               : kNoOrdinal;
+}
+
+void SearchServer::ListFileDocumentIds() const {
+    std::lock_guard guard(write_mutex_);
+
+    if (are_file_ids_listed_) {
+        return;
+    }
+
+    // A file document removed since, or re-added under a later ordinal, is not listed by its own ordinal.
+    for (const DocumentOrdinal ordinal : storage_->ordinals_by_id.GetSpan()) {
+        const int document_id = storage_->documents[ordinal].id;
+
+        if (FindLiveOrdinal(document_id) == ordinal) {
+            documents_ids_.insert(document_id);
+        }
+    }
+    are_file_ids_listed_ = true;
+}
+
+void SearchServer::RemoveStoredDocument(DocumentOrdinal ordinal) {
+    Storage& storage = *storage_;
+
+    for (const TermFrequency& term : storage.documents[ordinal].terms) {
+        if (--document_frequencies_.GetMutable(term.term_id, *epoch_) == 0) {
+            unused_terms_.push_back(term.term_id);
+        }
+    }
+
+    // Postings are left in place and skipped by queries until a merge drops them. Readers of the current version
+    // still see the document; it is gone for those of the version published next.
+    storage.removal_versions[ordinal].store(version_number_ + 1, std::memory_order_relaxed);
+    MarkDeleted(ordinal);
+    documents_ids_.erase(storage.documents[ordinal].id);
+    --document_count_;
+    total_document_length_ -= storage.document_lengths[ordinal];
+    forward_index_usage_ -= storage.document_contents[ordinal].terms.GetMemoryUsage();
+
+    // The ordinal itself is never reused, only the memory behind it is released.
+    epoch_->Retire(std::make_shared<const DocumentContent>(std::move(storage.document_contents[ordinal])));
+}
+
+void SearchServer::StoreDocument(int document_id, int rating, DocumentStatus status, uint32_t length,
+                                 TextLocation text, DocumentContent content) {
+    Storage& storage = *storage_;
+    const auto ordinal = static_cast<DocumentOrdinal>(storage.documents.size());
+    const auto key_of = [&storage](uint32_t index) { return storage.documents[index].id; };
+
+    forward_index_usage_ += content.terms.GetMemoryUsage();
+    storage.document_contents.push_back(std::move(content));
+    storage.documents.push_back({document_id, rating, status, text, storage.document_contents.back().terms.GetSpan(),
+                                 FindLatestOrdinal(storage, document_id)});
+    storage.document_lengths.push_back(length);
+    storage.removal_versions.emplace_back();
+    storage.document_ordinals.Insert(document_id, ordinal, key_of, *epoch_);
+    documents_ids_.insert(document_id);
+    ++document_count_;
+    total_document_length_ += length;
+}
+
+void SearchServer::ValidateNewDocumentIds(std::span<const DocumentToAdd> documents) const {
+    std::vector<int> document_ids(documents.size());
+
+    std::transform(documents.begin(), documents.end(), document_ids.begin(),
+                   [](const DocumentToAdd& document) { return document.id; });
+    std::sort(document_ids.begin(), document_ids.end());
+
+    if (std::adjacent_find(document_ids.begin(), document_ids.end()) != document_ids.end() ||
+        !std::all_of(document_ids.begin(), document_ids.end(),
+                     [this](int document_id) { return IsValidDocumentId(document_id); })) {
+        throw std::invalid_argument("Error adding document. Invalid document id!");
+    }
+}
+
+[[nodiscard]] SearchServer::PartialIndex SearchServer::BuildPartialIndex(
+    std::span<const DocumentToAdd> documents) const {
+    PartialIndex partial_index;
+
+    try {
+        std::unordered_map<std::string_view, TermId> local_term_ids;
+        // Reused from document to document.
+        std::vector<std::string_view> words;
+
+        for (const DocumentToAdd& document : documents) {
+            const auto ordinal = static_cast<DocumentOrdinal>(partial_index.documents.size());
+
+            SplitIntoWordsNoStop(document.text, words);
+
+            std::vector<TermId> term_ids(words.size());
+
+            std::transform(words.begin(), words.end(), term_ids.begin(), [&](std::string_view word) {
+                const auto [it, inserted] =
+                    local_term_ids.emplace(word, static_cast<TermId>(partial_index.terms.size()));
+
+                if (inserted) {
+                    partial_index.terms.push_back(word);
+                    partial_index.postings.emplace_back();
+                }
+                return it->second;
+            });
+
+            std::vector<TermFrequency> document_frequencies = ComputeTermFrequencies(std::move(term_ids));
+
+            for (const auto& [term_id, term_frequency] : document_frequencies) {
+                partial_index.postings[term_id].push_back({ordinal, term_frequency});
+            }
+            partial_index.words_in_document_frequencies.push_back(std::move(document_frequencies));
+            partial_index.document_lengths.push_back(static_cast<uint32_t>(words.size()));
+            partial_index.texts.push_back(document.text);
+            DocumentData& document_data = partial_index.documents.emplace_back();
+
+            document_data.id = document.id;
+            document_data.rating = ComputeAverageRating(document.ratings);
+            document_data.status = document.status;
+        }
+    } catch (...) {
+        partial_index.error = std::current_exception();
+    }
+
+    return partial_index;
+}
+
+[[nodiscard]] DocumentOrdinal SearchServer::GetDocumentOrdinal(const Version& version, int document_id) const {
+    const DocumentOrdinal ordinal = FindDocumentOrdinal(version, document_id);
+
+    if (ordinal == kNoOrdinal) {
+        throw std::out_of_range("non-existing document_id");
+    }
+
+    return ordinal;
 }
 
 [[nodiscard]] int SearchServer::ComputeAverageRating(const std::vector<int>& ratings) {
@@ -94,34 +983,126 @@ std::set<int>::const_iterator SearchServer::end() const { return documents_ids_.
     return rating_sum / static_cast<int>(ratings.size());
 }
 
-[[nodiscard]] bool SearchServer::IsStopWord(const std::string_view word) const {
-    return stop_words_.count({word.begin(), word.end()}) > 0;
+[[nodiscard]] std::vector<SearchServer::TermFrequency> SearchServer::ComputeTermFrequencies(
+    std::vector<TermId> term_ids) {
+    const double inverse_word_count = 1.0 / static_cast<double>(term_ids.size());
+    std::vector<TermFrequency> term_frequencies;
+
+    std::sort(term_ids.begin(), term_ids.end());
+
+    for (const TermId term_id : term_ids) {
+        if (term_frequencies.empty() || term_frequencies.back().term_id != term_id) {
+            term_frequencies.push_back({term_id, 0.0});
+        }
+        term_frequencies.back().frequency += inverse_word_count;
+    }
+
+    return term_frequencies;
 }
 
-[[nodiscard]] const std::vector<std::string_view> SearchServer::SplitIntoWordsNoStop(
-    const std::string_view text) const {
-    std::vector<std::string_view> words;
+[[nodiscard]] bool SearchServer::IsStopWord(const StopWordFilter& stop_words, const std::string_view word) {
+    return stop_words.Contains(word);
+}
+
+void SearchServer::SplitIntoWordsNoStop(const std::string_view text, std::vector<std::string_view>& words) const {
+    if (!string_processing::SplitIntoWordsView(text, words)) {
+        throw std::invalid_argument("Word contains invalid symblos");
+    }
+    std::erase_if(words, [this](std::string_view word) { return IsStopWord(*stop_words_, word); });
+}
+
+[[nodiscard]] CorpusStatistics SearchServer::GetCorpusStatistics(const Version& version) {
+    return {version.document_count,
+            version.document_count == 0 ? 0.0
+                                        : static_cast<double>(version.total_document_length) / version.document_count};
+}
+
+void SearchServer::FindTopDocumentsInBatchChunk(const Version& version, std::span<const std::string> raw_queries,
+                                                DocumentStatus document_status, size_t top_document_count,
+                                                std::span<std::vector<Document>> results) const {
+    std::vector<Query> queries;
+    std::vector<TermId> term_ids;
+
+    queries.reserve(raw_queries.size());
+
+    for (const std::string& raw_query : raw_queries) {
+        const Query& query = queries.emplace_back(ParseQuery(version, raw_query));
+
+        term_ids.insert(term_ids.end(), query.plus_terms.begin(), query.plus_terms.end());
+        term_ids.insert(term_ids.end(), query.minus_terms.begin(), query.minus_terms.end());
+    }
+    std::sort(term_ids.begin(), term_ids.end());
+    term_ids.erase(std::unique(term_ids.begin(), term_ids.end()), term_ids.end());
+
+    const auto index_of = [&term_ids](TermId term_id) {
+        return static_cast<size_t>(std::lower_bound(term_ids.begin(), term_ids.end(), term_id) - term_ids.begin());
+    };
 
-    for (const std::string_view word : string_processing::SplitIntoWordsView(text)) {
-        if (!IsValidWord(word)) {
-            throw std::invalid_argument("Word contains invalid symblos");
+    std::vector<double> inverse_document_frequencies(term_ids.size());
+
+    std::transform(term_ids.begin(), term_ids.end(), inverse_document_frequencies.begin(), [&](TermId term_id) {
+        return ComputeWordInverseDocumentFrequency<TfIdfScoring>(version, term_id);
+    });
+    const TfIdfScoring scoring(GetCorpusStatistics(version));
+
+    const auto document_predicate = [=](int, DocumentStatus status, int) { return status == document_status; };
+    std::vector<TopDocuments> top_documents(queries.size(), TopDocuments(top_document_count));
+
+    ForEachSegment(version, [&](const auto& segment) {
+        std::vector<PostingList> posting_lists;
+
+        posting_lists.reserve(term_ids.size());
+
+        for (const TermId term_id : term_ids) {
+            posting_lists.push_back(segment.GetPostings(term_id));
         }
 
-        if (!IsStopWord(word)) {
-            words.push_back(word);
+        std::vector<PostingCursor> cursors;
+        std::vector<PostingCursor> minus_cursors;
+
+        for (size_t query_index = 0; query_index < queries.size(); ++query_index) {
+            cursors.clear();
+            minus_cursors.clear();
+
+            for (const TermId term_id : queries[query_index].plus_terms) {
+                const size_t index = index_of(term_id);
+
+                if (!posting_lists[index].empty()) {
+                    cursors.emplace_back(posting_lists[index], inverse_document_frequencies[index], scoring);
+                }
+            }
+
+            for (const TermId term_id : queries[query_index].minus_terms) {
+                minus_cursors.emplace_back(posting_lists[index_of(term_id)]);
+            }
+            FindTopDocumentsWithCursors(version, cursors, minus_cursors, scoring, document_predicate,
+                                        top_documents[query_index]);
         }
-    }
+    });
 
-    return words;
+    for (size_t query_index = 0; query_index < queries.size(); ++query_index) {
+        results[query_index] = top_documents[query_index].ExtractSorted();
+    }
 }
 
-[[nodiscard]] double SearchServer::ComputeWordInverseDocumentFrequency(const std::string_view word) const {
-    assert(word_to_document_frequencies_.at(word).size() != 0);
+[[nodiscard]] std::vector<SearchServer::OrdinalRange> SearchServer::SplitIntoOrdinalRanges(const Version& version,
+                                                                                         size_t worker_count) {
+    const DocumentOrdinal ordinal_count = version.end_ordinal;
+    const size_t range_count =
+        std::max<size_t>(1, std::min(worker_count, ordinal_count / kMinOrdinalsPerWorker));
+    const DocumentOrdinal range_size = (ordinal_count + range_count - 1) / range_count;
+
+    std::vector<OrdinalRange> ranges;
+
+    for (DocumentOrdinal begin = 0; begin < ordinal_count; begin += range_size) {
+        ranges.push_back({begin, std::min(ordinal_count, begin + range_size)});
+    }
 
-    return log(GetDocumentCount() * 1.0 / word_to_document_frequencies_.at(word).size());
+    return ranges;
 }
 
-[[nodiscard]] const SearchServer::QueryWord SearchServer::ParseQueryWord(std::string_view text) const {
+[[nodiscard]] const SearchServer::QueryWord SearchServer::ParseQueryWord(const Version& version,
+                                                                         std::string_view text) {
     bool is_minus = false;
 
     if (text[0] == '-') {
@@ -137,24 +1118,39 @@ std::set<int>::const_iterator SearchServer::end() const { return documents_ids_.
         throw std::invalid_argument("Search error. Invalid query!");
     }
 
-    if (IsValidWord(text)) {
-        return {text, is_minus, IsStopWord(text)};
-    }
-
-    throw std::invalid_argument("Search error. Invalid query!");
+    return {text, is_minus, IsStopWord(*version.stop_words, text)};
 }
 
-[[nodiscard]] const SearchServer::Query SearchServer::ParseQuery(std::string_view text) const {
+[[nodiscard]] const SearchServer::Query SearchServer::ParseQuery(const Version& version,
+                                                                 std::string_view text) const {
     if (!text.empty()) {
         Query query;
 
-        for (const auto& word : string_processing::SplitIntoWordsView(text)) {
-            const QueryWord query_word = ParseQueryWord(word);
+        // Reused from query to query.
+        thread_local std::vector<std::string_view> words;
 
-            if (!query_word.is_stop) {
-                query_word.is_minus ? query.minus_words.insert(query_word.data)
-                                    : query.plus_words.insert(query_word.data);
+        if (!string_processing::SplitIntoWordsView(text, words)) {
+            throw std::invalid_argument("Search error. Invalid query!");
+        }
+
+        for (const std::string_view word : words) {
+            const QueryWord query_word = ParseQueryWord(version, word);
+
+            if (query_word.is_stop) {
+                continue;
             }
+            const TermId term_id = version.storage->terms.Find(query_word.data);
+
+            // Terms interned after the version was published have no documents in it, and terms that lost all their
+            // documents keep their id until they are dropped from the dictionary; neither can match.
+            if (term_id < version.document_frequencies.size() && version.document_frequencies[term_id] != 0) {
+                query_word.is_minus ? query.minus_terms.push_back(term_id) : query.plus_terms.push_back(term_id);
+            }
+        }
+
+        for (auto* terms : {&query.plus_terms, &query.minus_terms}) {
+            std::sort(terms->begin(), terms->end());
+            terms->erase(std::unique(terms->begin(), terms->end()), terms->end());
         }
 
         return query;
@@ -162,3 +1158,120 @@ std::set<int>::const_iterator SearchServer::end() const { return documents_ids_.
 
     return {};
 }
+
+void SearchServer::MarkDeleted(DocumentOrdinal ordinal) {
+    if (ordinal >= mutable_segment_->GetFirstOrdinal()) {
+        mutable_segment_tombstones_.Set(ordinal - mutable_segment_->GetFirstOrdinal());
+        return;
+    }
+    const auto it = std::upper_bound(
+        segments_.begin(), segments_.end(), ordinal,
+        [](DocumentOrdinal value, const SegmentEntry& entry) { return value < entry.segment->GetFirstOrdinal(); });
+
+    // Segments dropped after losing all their documents leave gaps between the others.
+    if (it != segments_.begin() && ordinal < std::prev(it)->segment->GetEndOrdinal()) {
+        std::prev(it)->tombstones.Set(ordinal - std::prev(it)->segment->GetFirstOrdinal());
+    }
+}
+
+void SearchServer::SealMutableSegment() {
+    if (mutable_segment_->GetDocumentCount() == 0) {
+        return;
+    }
+    auto segment = std::make_shared<const Segment>(mutable_segment_->Seal(mutable_segment_tombstones_));
+
+    if (segment->GetDocumentCount() > 0) {
+        segments_.push_back({std::move(segment), {}});
+    }
+    mutable_segment_ = std::make_shared<MutableSegment>(mutable_segment_->GetEndOrdinal());
+    mutable_segment_tombstones_ = {};
+}
+
+void SearchServer::MaintainSegments() {
+    if (pending_merge_ && pending_merge_->result.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+        InstallMerge();
+    }
+
+    if (pending_merge_) {
+        return;
+    }
+    const std::optional<std::pair<size_t, size_t>> merge = ChooseMerge();
+
+    if (!merge) {
+        return;
+    }
+    const auto [first_segment, end_segment] = *merge;
+    std::vector<std::shared_ptr<const Segment>> segments;
+    std::vector<Tombstones> tombstones;
+
+    for (size_t i = first_segment; i < end_segment; ++i) {
+        segments.push_back(segments_[i].segment);
+        tombstones.push_back(segments_[i].tombstones);
+    }
+    // The task owns everything it reads: segments are immutable and shared, tombstones are copied.
+    pending_merge_ = PendingMerge{first_segment, end_segment, tombstones,
+                                  std::async(std::launch::async, [segments = std::move(segments), tombstones] {
+                                      return std::make_shared<const Segment>(Segment::Merge(segments, tombstones));
+                                  })};
+}
+
+void SearchServer::InstallMerge() {
+    PendingMerge merge = std::move(*pending_merge_);
+    pending_merge_.reset();
+
+    const std::shared_ptr<const Segment> merged_segment = merge.result.get();
+    Tombstones tombstones;
+
+    for (size_t i = merge.first_segment; i < merge.end_segment; ++i) {
+        const SegmentEntry& entry = segments_[i];
+        const DocumentOrdinal offset = entry.segment->GetFirstOrdinal() - merged_segment->GetFirstOrdinal();
+        const Tombstones& merged_tombstones = merge.tombstones[i - merge.first_segment];
+
+        entry.tombstones.ForEach([&](size_t deleted_offset) {
+            if (!merged_tombstones.Contains(deleted_offset)) {
+                tombstones.Set(offset + deleted_offset);
+            }
+        });
+    }
+    const auto first = segments_.begin() + static_cast<std::ptrdiff_t>(merge.first_segment);
+    const auto end = segments_.begin() + static_cast<std::ptrdiff_t>(merge.end_segment);
+
+    if (merged_segment->GetDocumentCount() == 0) {
+        segments_.erase(first, end);
+    } else {
+        *first = {merged_segment, std::move(tombstones)};
+        segments_.erase(first + 1, end);
+    }
+}
+
+[[nodiscard]] std::optional<std::pair<size_t, size_t>> SearchServer::ChooseMerge() const {
+    for (size_t i = 0; i < segments_.size(); ++i) {
+        if (segments_[i].tombstones.count() * 2 > segments_[i].segment->GetDocumentCount()) {
+            return std::pair{i, i + 1};
+        }
+    }
+
+    for (size_t i = 0; i + kMergeFactor <= segments_.size(); ++i) {
+        const size_t level = GetSegmentLevel(segments_[i]);
+
+        if (std::all_of(segments_.begin() + static_cast<std::ptrdiff_t>(i + 1),
+                        segments_.begin() + static_cast<std::ptrdiff_t>(i + kMergeFactor),
+                        [level](const SegmentEntry& entry) { return GetSegmentLevel(entry) == level; })) {
+            return std::pair{i, i + kMergeFactor};
+        }
+    }
+
+    return std::nullopt;
+}
+
+[[nodiscard]] size_t SearchServer::GetSegmentLevel(const SegmentEntry& entry) {
+    const size_t live_document_count = entry.segment->GetDocumentCount() - entry.tombstones.count();
+    size_t level = 0;
+
+    for (size_t level_size = kMaxMutableSegmentDocuments; live_document_count > level_size;
+         level_size *= kMergeFactor) {
+        ++level;
+    }
+
+    return level;
+}
@@ -1,144 +1,453 @@
 #pragma once
 
 #include <algorithm>
+#include <atomic>
+#include <exception>
 #include <execution>
+#include <future>
+#include <limits>
+#include <numeric>
+#include <optional>
 #include <iostream>
 #include <map>
+#include <memory>
+#include <mutex>
 #include <set>
+#include <span>
 #include <stdexcept>
 #include <string>
 #include <string_view>
+#include <thread>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
-#include "concurrent_map.h"
+#include "chunked_vector.h"
+#include "concurrent_hash_index.h"
+#include "cow_array.h"
 #include "document.h"
+#include "document_store.h"
+#include "epoch.h"
+#include "index_file.h"
 #include "log_duration.h"
+#include "memory_stats.h"
+#include "metrics.h"
+#include "mutable_segment.h"
+#include "posting_cursor.h"
+#include "posting_list.h"
+#include "query_cache.h"
+#include "score_accumulator.h"
+#include "scoring.h"
+#include "segment.h"
+#include "stop_word_filter.h"
+#include "term_dictionary.h"
+#include "thread_pool.h"
+#include "tombstones.h"
+#include "top_documents.h"
+#include "versioned_array.h"
 
+// Readers and one writer at a time may use the index concurrently. Every modification is published as a new immutable
+// version, and every read pins the version current when it starts: it sees all of that version's documents and none
+// of the later changes, and neither waits for writers nor makes them wait. Writers are serialized by a mutex.
+//
+// Versions share almost everything: immutable segments, the append-only document storage, the dictionary and the
+// mutable segment, which readers cut at the end ordinal of their version. Removed documents are marked with the number
+// of the version that removed them. Memory that a modification replaces or frees is retired to an Epoch and released
+// once no reader holds a version that may use it.
 class SearchServer {
+    friend class ShardedSearchServer;
+    friend class DurableSearchServer;
+
 public:
     template <typename StringContainer>
-    explicit SearchServer(const StringContainer& stop_words) : stop_words_(MakeUniqueNonEmptyStrings(stop_words)) {
-        if (!std::all_of(stop_words_.begin(), stop_words_.end(), IsValidWord)) {
+    explicit SearchServer(const StringContainer& stop_words)
+        : stop_words_(std::make_shared<const StopWordFilter>(MakeUniqueNonEmptyStrings(stop_words))) {
+        if (!std::all_of(stop_words_->begin(), stop_words_->end(), IsValidWord)) {
             throw std::invalid_argument("Some of stop words are invalid");
         }
+        PublishVersion();
     }
 
     explicit SearchServer(const std::string_view stop_words_text);
 
     explicit SearchServer(const std::string& stop_words_text);
 
+    // Moving is not synchronized: no other thread may use either server meanwhile.
+    SearchServer(SearchServer&& other) noexcept;
+
+    // The version number keeps growing across the assignment, so results cached before it are never returned after.
+    SearchServer& operator=(SearchServer&& other) noexcept;
+
+public:
+    static constexpr size_t kMaxResultDocumentCount = 5;
+
 public:
     void SetStopWords(const std::string& text);
 
+    // Parallel overloads run on the given pool from now on, instead of the default one. The pool must outlive the
+    // server and every call using it.
+    void SetThreadPool(ThreadPool& thread_pool);
+
+    // Document passed to AddDocuments. The text is only read during the call.
+    struct DocumentToAdd {
+        int id = 0;
+        std::string_view text;
+        DocumentStatus status = DocumentStatus::kActual;
+        std::vector<int> ratings;
+    };
+
+public:
     void AddDocument(int document_id, const std::string_view document, DocumentStatus document_status,
                      const std::vector<int>& document_ratings);
 
-    [[nodiscard]] const std::vector<Document> FindTopDocuments(
-        const std::string_view raw_query, DocumentStatus document_status = DocumentStatus::kActual) const;
+    // Takes the text over instead of copying it: a text of at least DocumentStore::kBlockSize bytes is stored in the
+    // buffer it came in.
+    void AddDocument(int document_id, std::string&& document, DocumentStatus document_status,
+                     const std::vector<int>& document_ratings);
+
+    void AddDocument(int document_id, const char* document, DocumentStatus document_status,
+                     const std::vector<int>& document_ratings);
+
+    // Adds documents with the same result as adding them one by one in order, except that either all of them are
+    // added or, if any is invalid, none is.
+    void AddDocuments(std::span<const DocumentToAdd> documents);
+
+    // Every worker tokenizes a contiguous part of the batch into its own partial index with locally numbered terms.
+    // The partial indexes are then turned into segments in one pass: terms are interned once per worker rather than
+    // once per occurrence, and every worker builds the segment of its own part.
+    template <typename ExecutionPolicy>
+    void AddDocuments(ExecutionPolicy&& policy, std::span<const DocumentToAdd> documents) {
+        std::lock_guard guard(write_mutex_);
 
-    template <typename Filter>
-    [[nodiscard]] const std::vector<Document> FindTopDocuments(const std::string_view raw_query, Filter filter) const {
-        return FindTopDocuments(std::execution::seq, raw_query, filter);
+        ValidateNewDocumentIds(documents);
+
+        const size_t worker_count =
+            std::clamp<size_t>(documents.size() / kMinDocumentsPerWorker, 1, GetWorkerCount(policy));
+        std::vector<PartialIndex> partial_indexes(worker_count);
+
+        ForEachWorker(policy, worker_count, [&](size_t worker) {
+            const size_t begin = documents.size() * worker / worker_count;
+            const size_t end = documents.size() * (worker + 1) / worker_count;
+
+            partial_indexes[worker] = BuildPartialIndex(documents.subspan(begin, end - begin));
+        });
+
+        MergePartialIndexes(policy, partial_indexes);
     }
 
-    template <typename Filter, typename ExecutionPolicy>
-    [[nodiscard]] const std::vector<Document> FindTopDocuments(ExecutionPolicy&& policy,
-                                                               const std::string_view raw_query, Filter filter) const {
-        static const double kAccuracy = 1e-6;
+    // Results are cached per parsed query, status and count until the next modification of the index. The text is
+    // remembered with them, so repeating it spares parsing as well.
+    [[nodiscard]] const std::vector<Document> FindTopDocuments(
+        const std::string_view raw_query, DocumentStatus document_status = DocumentStatus::kActual,
+        size_t top_document_count = kMaxResultDocumentCount) const;
+
+    // The scoring model is chosen by the first template argument, as in FindTopDocuments<Bm25Scoring>(query, filter);
+    // the overloads without one rank by TF-IDF. These overloads bypass the cache, whether given a predicate, which
+    // cannot be compared for equality, or a policy.
+    template <typename Scoring = TfIdfScoring, typename Filter>
+    [[nodiscard]] const std::vector<Document> FindTopDocuments(
+        const std::string_view raw_query, Filter filter, size_t top_document_count = kMaxResultDocumentCount) const {
+        return FindTopDocuments<Scoring>(std::execution::seq, raw_query, filter, top_document_count);
+    }
 
-        const Query query = ParseQuery(raw_query);
-        std::vector<Document> matched_documents = FindAllDocuments(policy, query, filter);
+    template <typename Scoring = TfIdfScoring, typename Filter, typename ExecutionPolicy>
+    [[nodiscard]] const std::vector<Document> FindTopDocuments(
+        ExecutionPolicy&& policy, const std::string_view raw_query, Filter filter,
+        size_t top_document_count = kMaxResultDocumentCount) const {
+        LOG_DURATION_HISTOGRAM((GetLatencyHistogram<Operation::kFindTopDocuments, ExecutionPolicy>()));
 
-        std::sort(policy, matched_documents.begin(), matched_documents.end(),
-                  [](const Document& lhs, const Document& rhs) {
-                      if (std::abs(lhs.relevance - rhs.relevance) < kAccuracy) {
-                          return lhs.rating > rhs.rating;
-                      } else {
-                          return lhs.relevance > rhs.relevance;
-                      }
-                  });
+        const std::shared_ptr<const Version> version = PinVersion();
+        const Query query = ParseQuery(*version, raw_query);
 
-        if (static_cast<int>(matched_documents.size()) > kMaxResultDocumentCount) {
-            matched_documents.resize(static_cast<size_t>(kMaxResultDocumentCount));
-        }
-        return matched_documents;
+        return FindTopDocumentsForQuery(policy, *version, query,
+                                        ComputeInverseDocumentFrequencies<Scoring>(*version, query),
+                                        Scoring(GetCorpusStatistics(*version)), filter, top_document_count);
     }
 
+    // Top documents of every query of a batch, the same as FindTopDocuments would return for each of them, computed
+    // against a single version of the index. Queries are evaluated in chunks: within a chunk every distinct term is
+    // weighted once and its postings are materialized once per segment, and every query then runs its
+    // own pruned search over the shared lists. The cache is bypassed. Chunks run in parallel on the given pool or on
+    // the server's one.
+    [[nodiscard]] std::vector<std::vector<Document>> FindTopDocumentsBatch(
+        std::span<const std::string> raw_queries, DocumentStatus document_status = DocumentStatus::kActual,
+        size_t top_document_count = kMaxResultDocumentCount) const;
+
+    [[nodiscard]] std::vector<std::vector<Document>> FindTopDocumentsBatch(
+        ThreadPool& thread_pool, std::span<const std::string> raw_queries,
+        DocumentStatus document_status = DocumentStatus::kActual,
+        size_t top_document_count = kMaxResultDocumentCount) const;
+
     [[nodiscard]] int GetDocumentCount() const;
 
+    [[nodiscard]] QueryCache::Stats GetQueryCacheStats() const;
+
+    // Words of the query found in the document, or none if a minus word is, as views into the dictionary. A view stays
+    // valid while some document containing the word is in the index: once the last one is removed, any later
+    // modification may release the word. Compact releases every word, and so does destroying the server.
     [[nodiscard]] std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(std::string_view raw_query,
                                                                                           int document_id) const;
 
+    // A query has too few words for workers to pay off, so matching is sequential under any policy; the policy only
+    // picks the latency histogram.
     template <class ExecutionPolicy>
-    [[nodiscard]] std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(ExecutionPolicy&& policy,
+    [[nodiscard]] std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(ExecutionPolicy&&,
                                                                                           std::string_view raw_query,
                                                                                           int document_id) const {
-        if (documents_ids_.count(document_id) == 0) {
-            throw std::out_of_range("non-existing document_id");
-        }
-        const Query query = ParseQuery(raw_query);
+        LOG_DURATION_HISTOGRAM((GetLatencyHistogram<Operation::kMatchDocument, ExecutionPolicy>()));
+
+        const std::shared_ptr<const Version> version = PinVersion();
+        const Storage& storage = *version->storage;
+        const DocumentOrdinal ordinal = GetDocumentOrdinal(*version, document_id);
+        const Query query = ParseQuery(*version, raw_query);
         std::vector<std::string_view> matched_words;
 
-        const auto word_checker = [this, document_id](std::string_view word) {
-            const auto it = word_to_document_frequencies_.find(word);
-            return it != word_to_document_frequencies_.end() && it->second.count(document_id);
+        const std::span<const TermFrequency> terms_data = storage.documents[ordinal].terms;
+        const auto term_checker = [terms_data](TermId term_id) {
+            return std::binary_search(terms_data.begin(), terms_data.end(), TermFrequency{term_id},
+                                      [](const TermFrequency& lhs, const TermFrequency& rhs) {
+                                          return lhs.term_id < rhs.term_id;
+                                      });
         };
 
-        std::for_each(policy, query.plus_words.begin(), query.plus_words.end(),
-                      [this, document_id, &matched_words, &word_checker](std::string_view word) {
-                          if (word_checker(word)) {
-                              matched_words.push_back(word);
-                          }
-                      });
+        if (std::any_of(query.minus_terms.begin(), query.minus_terms.end(), term_checker)) {
+            return {matched_words, storage.documents[ordinal].status};
+        }
+
+        std::vector<TermId> matched_terms(query.plus_terms.size());
+
+        const auto matched_end =
+            std::copy_if(query.plus_terms.begin(), query.plus_terms.end(), matched_terms.begin(), term_checker);
+
+        matched_words.resize(static_cast<size_t>(std::distance(matched_terms.begin(), matched_end)));
+
+        std::transform(matched_terms.begin(), matched_end, matched_words.begin(),
+                       [&storage](TermId term_id) { return storage.terms.GetTerm(term_id); });
+
+        std::sort(matched_words.begin(), matched_words.end());
+
+        return {matched_words, storage.documents[ordinal].status};
+    }
 
-        if (std::any_of(policy, query.minus_words.begin(), query.minus_words.end(), word_checker)) {
-            matched_words.clear();
+    // MatchDocument for every document of the list, with the results in the same order. The query is parsed and its
+    // words looked up once for all documents, which are then checked against their forward index entries. Throws
+    // std::out_of_range before matching anything if an id is unknown. The views live as long as those of MatchDocument.
+    [[nodiscard]] std::vector<std::tuple<std::vector<std::string_view>, DocumentStatus>> MatchDocuments(
+        std::string_view raw_query, std::span<const int> document_ids) const;
 
-            return {matched_words, documents_.at(document_id).status};
+    // Parts of the list are matched by different workers, each writing only the results of its own documents.
+    template <class ExecutionPolicy>
+    [[nodiscard]] std::vector<std::tuple<std::vector<std::string_view>, DocumentStatus>> MatchDocuments(
+        ExecutionPolicy&& policy, std::string_view raw_query, std::span<const int> document_ids) const {
+        LOG_DURATION_HISTOGRAM((GetLatencyHistogram<Operation::kMatchDocuments, ExecutionPolicy>()));
+
+        const std::shared_ptr<const Version> version = PinVersion();
+        const Storage& storage = *version->storage;
+        const Query query = ParseQuery(*version, raw_query);
+        std::vector<DocumentOrdinal> ordinals(document_ids.size());
+
+        // Resolved up front, since exceptions must not escape the workers.
+        std::transform(document_ids.begin(), document_ids.end(), ordinals.begin(),
+                       [this, &version](int document_id) { return GetDocumentOrdinal(*version, document_id); });
+
+        // Checked in the order of their words, so the matched words of every document come out sorted.
+        std::vector<std::pair<std::string_view, TermId>> plus_words;
+
+        for (const TermId term_id : query.plus_terms) {
+            plus_words.emplace_back(storage.terms.GetTerm(term_id), term_id);
         }
-        std::sort(policy, matched_words.begin(), matched_words.end());
-        auto last_it = std::unique(policy, matched_words.begin(), matched_words.end());
+        std::sort(plus_words.begin(), plus_words.end());
+
+        std::vector<std::tuple<std::vector<std::string_view>, DocumentStatus>> results(document_ids.size());
+        const size_t worker_count =
+            std::clamp<size_t>(document_ids.size() / kMinDocumentsPerWorker, 1, GetWorkerCount(policy));
+
+        ForEachWorker(policy, worker_count, [&](size_t worker) {
+            const size_t begin = document_ids.size() * worker / worker_count;
+            const size_t end = document_ids.size() * (worker + 1) / worker_count;
+
+            for (size_t i = begin; i < end; ++i) {
+                const DocumentData& document_data = storage.documents[ordinals[i]];
+                const auto has_term = [terms = document_data.terms](TermId term_id) {
+                    return std::binary_search(terms.begin(), terms.end(), TermFrequency{term_id},
+                                              [](const TermFrequency& lhs, const TermFrequency& rhs) {
+                                                  return lhs.term_id < rhs.term_id;
+                                              });
+                };
+                auto& [matched_words, status] = results[i];
 
-        matched_words.erase(last_it, matched_words.end());
+                status = document_data.status;
 
-        return {matched_words, documents_.at(document_id).status};
+                if (std::any_of(query.minus_terms.begin(), query.minus_terms.end(), has_term)) {
+                    continue;
+                }
+
+                for (const auto& [word, term_id] : plus_words) {
+                    if (has_term(term_id)) {
+                        matched_words.push_back(word);
+                    }
+                }
+            }
+        });
+
+        return results;
     }
 
+    // Keys are views valid as long as those MatchDocument returns.
     [[nodiscard]] const std::map<std::string_view, double> GetWordFrequencies(int document_id) const;
 
+    // Text the document was added with, decompressed from the document store; empty for an unknown id.
+    [[nodiscard]] std::string GetDocumentText(int document_id) const;
+
     void RemoveDocument(int document_id);
 
+    // Writes the index to an index file, replacing the file atomically. Removed documents and terms left without
+    // documents are not written, and ordinals are renumbered densely.
+    void SaveToFile(const std::string& path) const;
+
+    // Opens an index file written by SaveToFile. Postings, the forward index, document texts and the dictionary are
+    // used in place through a read-only memory mapping shared with every other process opening the same file; only
+    // the parts that are later modified get copied into memory. Opening reads the header, the offset tables and the
+    // fixed-size document records, nothing else: pages of postings, terms and texts load as queries touch them.
+    //
+    // Only the header and offset tables are checked, so a file whose other sections are corrupt can make queries read
+    // out of bounds; a file from an untrusted source goes through VerifyFile first. Files before the current version
+    // have their lookups built while opening, and version 1 files have their texts tokenized anew.
+    [[nodiscard]] static SearchServer OpenFile(const std::string& path);
+
+    // Checks every section of an index file against the counts and against each other, in one pass over the whole
+    // file, and throws index_file::FormatError at the first inconsistency.
+    static void VerifyFile(const std::string& path);
+
+    // Document frequencies shared with published versions are copied on write, which must not happen concurrently,
+    // so the removal itself runs sequentially whatever the policy.
     template <class ExecutionPolicy>
-    void RemoveDocument(ExecutionPolicy&& policy, int document_id) {
-        if (documents_ids_.count(document_id) == 0) {
+    void RemoveDocument(ExecutionPolicy&&, int document_id) {
+        LOG_DURATION_HISTOGRAM(GetLatencyHistogram<Operation::kRemoveDocument>());
+
+        std::lock_guard guard(write_mutex_);
+
+        const DocumentOrdinal ordinal = FindDocumentOrdinal(*PinVersion(), document_id);
+
+        if (ordinal == kNoOrdinal) {
             return;
         }
-        const auto& words_data = words_in_document_frequencies_.at(document_id);
-
-        std::vector<std::string_view> word_ptrs(words_data.size());
+        RemoveStoredDocument(ordinal);
+        MaintainSegments();
+        PublishVersion();
+    }
 
-        std::transform(policy, words_data.begin(), words_data.end(), word_ptrs.begin(),
-                       [](auto word) { return word.first; });
+    // Removes the documents in a single modification, so the index is maintained and a version published once rather
+    // than per document; readers see all of them go at once. Unknown ids are skipped.
+    void RemoveDocuments(std::span<const int> document_ids);
 
-        std::for_each(policy, word_ptrs.begin(), word_ptrs.end(), [this, document_id](std::string_view word_ptr) {
-            word_to_document_frequencies_.at(word_ptr).erase(document_id);
-        });
+    // Calls visitor(word) for every distinct indexed word of the document, in no particular order; never for an
+    // unknown id. The views are valid for as long as those MatchDocument returns: while a document containing the word
+    // remains, and not past Compact.
+    template <typename Visitor>
+    void ForEachWord(int document_id, Visitor visitor) const {
+        const std::shared_ptr<const Version> version = PinVersion();
+        const DocumentOrdinal ordinal = FindDocumentOrdinal(*version, document_id);
 
-        documents_ids_.erase(document_id);
+        if (ordinal == kNoOrdinal) {
+            return;
+        }
 
-        words_in_document_frequencies_.erase(document_id);
-        documents_.erase(document_id);
+        for (const TermFrequency& term : version->storage->documents[ordinal].terms) {
+            visitor(version->storage->terms.GetTerm(term.term_id));
+        }
     }
 
+    // Memory of the index by part. Waits for a running modification, not for searches or background merges; parts are
+    // read from counters and a few sizes, so it is cheap enough to poll periodically.
+    [[nodiscard]] MemoryStats GetMemoryStats() const;
+
+    // Number of immutable segments, not counting the one receiving new documents.
+    [[nodiscard]] size_t GetSegmentCount() const;
+
+    // Blocks until the running background merge and every merge the merge policy asks for after it are done.
+    void WaitForMerges();
+
+    // Rebuilds the index from the live documents alone. Removal only marks documents, merges drop their postings and
+    // unused terms leave the dictionary, while ordinals, stored texts and the slots of dropped terms stay behind; the
+    // rebuilt index numbers documents and terms densely again and holds nothing else. Documents keep their order, and
+    // the texts are tokenized anew on the thread pool. It is a modification like any other: writers wait for it, while
+    // readers keep using the storage of the version they hold and see the rebuilt index from the next read on.
+    void Compact();
+
+    // Iteration is not part of any version: it must not overlap with modifications. Ids of an opened file are listed
+    // on the first call.
     std::set<int>::const_iterator begin() const;
 
     std::set<int>::const_iterator end() const;
 
 private:
+    struct TermFrequency {
+        TermId term_id = TermDictionary::kNoTerm;
+        double frequency = 0.0;
+    };
+
+    // Per-ordinal document record shared by all versions. It is written once before the version that adds the
+    // document is published and never changes afterwards; terms view memory owned by a DocumentContent and the text
+    // is kept in the document store.
     struct DocumentData {
+        int id = 0;
         int rating = 0;
         DocumentStatus status = DocumentStatus::kActual;
-        std::string raw_data;
+        TextLocation text;
+        std::span<const TermFrequency> terms;
+        // Ordinal of the removed document that had the same id before, so readers of older versions can find it.
+        DocumentOrdinal previous_ordinal = std::numeric_limits<DocumentOrdinal>::max();
+    };
+
+    // Memory behind the views of a DocumentData. Moving it keeps the memory in place.
+    struct DocumentContent {
+        CowArray<TermFrequency> terms;
+    };
+
+    static_assert(std::is_nothrow_move_constructible_v<DocumentContent>);
+
+    // Document records, texts and the dictionary, reached by readers through their version. Between compactions they
+    // are only appended to beyond what published versions cover, and removals only mark records; Compact replaces the
+    // storage as a whole, and the versions published before keep the old one alive for their readers.
+    struct Storage {
+        TermDictionary terms;
+        ChunkedVector<DocumentData> documents;
+        // Number of indexed words of every document, apart from the records so that scoring reads them densely.
+        ChunkedVector<uint32_t> document_lengths;
+        // Number of the version that removed each document, zero while it is live.
+        ChunkedVector<std::atomic<uint64_t>> removal_versions;
+        // Latest ordinal of every id added after the index was opened.
+        ConcurrentHashIndex<int> document_ordinals;
+        // Ordinals of the documents of the file the index was opened from, in ascending order of their ids.
+        CowArray<DocumentOrdinal> ordinals_by_id;
+        // Written by the writer alone: readers only use the memory they own through the views of the records.
+        std::vector<DocumentContent> document_contents;
+        DocumentStore document_store;
+        // File the index was opened from, viewed by the records, texts and dictionary as well as by segments.
+        std::shared_ptr<const index_file::MappedFile> mapped_file;
+    };
+
+    // Sections of an index file as read by ReadFileSections, which checks the header and the offset tables everything
+    // else is addressed through. The ordinals by id are empty in files before version 3.
+    struct FileSections {
+        uint32_t format_version = 0;
+        uint64_t term_count = 0;
+        uint64_t document_count = 0;
+        std::span<const char> stop_words;
+        std::span<const uint64_t> term_offsets;
+        std::span<const char> term_characters;
+        std::span<const uint64_t> posting_offsets;
+        std::span<const DocumentOrdinal> posting_ordinals;
+        std::span<const double> posting_term_frequencies;
+        std::span<const uint64_t> block_max_offsets;
+        std::span<const double> block_max_term_frequencies;
+        std::span<const index_file::DocumentRecord> document_records;
+        std::span<const uint64_t> forward_index_offsets;
+        std::span<const TermFrequency> forward_index;
+        std::span<const uint64_t> text_offsets;
+        std::span<const char> texts;
+        std::span<const DocumentOrdinal> ordinals_by_id;
     };
 
     struct QueryWord {
@@ -147,24 +456,140 @@ private:
         bool is_stop = false;
     };
 
+    // Query terms resolved against the dictionary, sorted and unique. Words absent from the dictionary cannot match
+    // any document and are dropped during parsing.
     struct Query {
-        std::set<std::string_view> plus_words;
-        std::set<std::string_view> minus_words;
+        std::vector<TermId> plus_terms;
+        std::vector<TermId> minus_terms;
+    };
+
+    struct Posting {
+        DocumentOrdinal ordinal = 0;
+        double term_frequency = 0.0;
+    };
+
+    // Index of a part of an AddDocuments batch. Terms are numbered in order of first occurrence and viewed in the
+    // batch texts, ordinals start from zero. A tokenization error is kept for the merge to rethrow, since exceptions
+    // must not escape a parallel algorithm.
+    struct PartialIndex {
+        std::vector<std::string_view> terms;
+        std::vector<std::vector<Posting>> postings;
+        std::vector<std::vector<TermFrequency>> words_in_document_frequencies;
+        std::vector<uint32_t> document_lengths;
+        std::vector<std::string_view> texts;
+        std::vector<DocumentData> documents;
+        std::exception_ptr error;
+    };
+
+    // Immutable segment together with the documents deleted from it since it was built. Tombstones belong to the
+    // writer and drive merges; readers check removal versions instead.
+    struct SegmentEntry {
+        std::shared_ptr<const Segment> segment;
+        Tombstones tombstones;
+    };
+
+    // State of the index as of one modification. Everything a version points to is immutable or only appended to
+    // beyond what the version covers: the document records below end_ordinal, the postings of the mutable segment
+    // below it and the dictionary entries below the size of the document frequency table.
+    struct Version {
+        uint64_t number = 0;
+        std::shared_ptr<const StopWordFilter> stop_words;
+        std::vector<std::shared_ptr<const Segment>> segments;
+        std::shared_ptr<const MutableSegment> mutable_segment;
+        // Number of live documents containing each term.
+        VersionedArray<uint32_t>::View document_frequencies;
+        DocumentOrdinal end_ordinal = 0;
+        size_t document_count = 0;
+        // Sum of the lengths of the live documents.
+        uint64_t total_document_length = 0;
+        std::shared_ptr<const Storage> storage;
+        std::shared_ptr<Epoch> epoch;
+    };
+
+    // The mutable segment as seen by the readers of one version.
+    struct MutableSegmentView {
+        const MutableSegment& segment;
+        DocumentOrdinal end_ordinal = 0;
+
+        [[nodiscard]] DocumentOrdinal GetFirstOrdinal() const { return segment.GetFirstOrdinal(); }
+
+        [[nodiscard]] DocumentOrdinal GetEndOrdinal() const { return end_ordinal; }
+
+        [[nodiscard]] PostingList GetPostings(TermId term_id) const {
+            return segment.GetPostings(term_id, end_ordinal);
+        }
     };
 
+    // Merge of segments_[first_segment, end_segment) running in the background. The tombstones of the merged segments
+    // are copied when it starts: documents deleted later are still in the result and get carried over on install.
+    struct PendingMerge {
+        size_t first_segment = 0;
+        size_t end_segment = 0;
+        std::vector<Tombstones> tombstones;
+        std::future<std::shared_ptr<const Segment>> result;
+    };
+
+    // Half-open range of document ordinals scored by a single worker.
+    struct OrdinalRange {
+        DocumentOrdinal begin = 0;
+        DocumentOrdinal end = 0;
+    };
+
+private:
+    static constexpr DocumentOrdinal kNoOrdinal = std::numeric_limits<DocumentOrdinal>::max();
+    static const size_t kMinOrdinalsPerWorker = 4096;
+    static const size_t kMinDocumentsPerWorker = 256;
+    // The mutable segment is sealed once it holds this many documents.
+    static const size_t kMaxMutableSegmentDocuments = MutableSegment::kMaxDocumentCount;
+    // Number of adjacent segments of one size level merged together; also the size ratio between levels.
+    static const size_t kMergeFactor = 4;
+    static const size_t kQueryCacheCapacity = 4096;
+    // Queries evaluated together by FindTopDocumentsBatch; a chunk shares term lookups and posting lists.
+    static constexpr size_t kBatchChunkSize = 256;
+
+    // Operations timed into histograms of the default metrics registry, and the names of the histograms.
+    enum class Operation { kAddDocument, kFindTopDocuments, kMatchDocument, kMatchDocuments, kRemoveDocument };
+
+    static constexpr std::string_view kOperationMetricNames[] = {
+        "search_server_add_document_ns", "search_server_find_top_documents_ns", "search_server_match_document_ns",
+        "search_server_match_documents_ns", "search_server_remove_document_ns"};
+
 private:
-    static const int kMaxResultDocumentCount = 5;
-    static const size_t kBucketsNumber = 50;
+    template <typename ExecutionPolicy>
+    [[nodiscard]] static constexpr std::string_view GetExecutionPolicyLabel() {
+        using Policy = std::remove_cvref_t<ExecutionPolicy>;
+
+        if constexpr (std::is_same_v<Policy, std::execution::sequenced_policy>) {
+            return "policy=\"seq\"";
+        } else if constexpr (std::is_same_v<Policy, std::execution::parallel_policy>) {
+            return "policy=\"par\"";
+        } else if constexpr (std::is_same_v<Policy, std::execution::parallel_unsequenced_policy>) {
+            return "policy=\"par_unseq\"";
+        } else if constexpr (std::is_same_v<Policy, std::execution::unsequenced_policy>) {
+            return "policy=\"unseq\"";
+        } else {
+            return {};
+        }
+    }
+
+    // Looked up in the registry once per operation and policy. Operations without a policy are not labelled.
+    template <Operation operation, typename ExecutionPolicy = void>
+    [[nodiscard]] static LatencyHistogram& GetLatencyHistogram() {
+        static LatencyHistogram& histogram = MetricsRegistry::GetDefault().GetHistogram(
+            kOperationMetricNames[static_cast<size_t>(operation)], GetExecutionPolicyLabel<ExecutionPolicy>());
+
+        return histogram;
+    }
 
 private:
     template <typename StringContainer>
     [[nodiscard]] std::set<std::string> MakeUniqueNonEmptyStrings(const StringContainer& strings) {
         std::set<std::string> non_empty_strings;
 
-        for (const std::string& word : strings) {
-            if (!word.empty()) {
+        for (const auto& word : strings) {
+            if (!std::string_view(word).empty()) {
                 if (IsValidWord(word)) {
-                    non_empty_strings.insert(word);
+                    non_empty_strings.emplace(word);
                 } else {
                     throw std::invalid_argument("stop words contains denied symbols");
                 }
@@ -177,65 +602,511 @@ private:
 
     [[nodiscard]] bool IsValidDocumentId(const int& document_id) const;
 
+    [[nodiscard]] std::shared_ptr<const Version> PinVersion() const;
+
+    // Writes the given version, pinned by the caller, as SaveToFile writes the current one.
+    void SaveToFile(const Version& version, const std::string& path) const;
+
+    // Publishes the current state as the next version. Called at the end of every modification.
+    void PublishVersion();
+
+    // Removes the terms that lost their last document from the dictionary once no reader holds a version in which
+    // they still had one. Terms are collected in batches: a batch is closed with the epoch current at that time, and
+    // dropped once that epoch is released. A term used again meanwhile is kept.
+    void DropUnusedTerms();
+
+    [[nodiscard]] bool IsRemoved(const Version& version, DocumentOrdinal ordinal) const;
+
+    // Length of the document as the scoring model sees it: zero for models that do not use lengths.
+    template <typename Scoring>
+    [[nodiscard]] static uint32_t GetDocumentLength(const Storage& storage, DocumentOrdinal ordinal) {
+        if constexpr (Scoring::kUsesDocumentLength) {
+            return storage.document_lengths[ordinal];
+        } else {
+            return 0;
+        }
+    }
+
+    // Ordinal of the document with the given id in the version, or kNoOrdinal.
+    [[nodiscard]] DocumentOrdinal FindDocumentOrdinal(const Version& version, int document_id) const;
+
+    // Ordinal the id was last stored under, whether removed or not, or kNoOrdinal.
+    [[nodiscard]] static DocumentOrdinal FindLatestOrdinal(const Storage& storage, int document_id);
+
+    // Ordinal of the live document with the given id as the writer sees it, or kNoOrdinal.
+    [[nodiscard]] DocumentOrdinal FindLiveOrdinal(int document_id) const;
+
+    // Adds the ids of the live documents of the opened file to documents_ids_, unless done before.
+    void ListFileDocumentIds() const;
+
+    [[nodiscard]] static FileSections ReadFileSections(const index_file::Reader& reader);
+
+    [[nodiscard]] DocumentOrdinal GetDocumentOrdinal(const Version& version, int document_id) const;
+
+    // Marks the document removed as of the next version and releases its terms; the caller publishes the version.
+    void RemoveStoredDocument(DocumentOrdinal ordinal);
+
+    // Appends the document record under the next ordinal; its postings are added by the caller. The length is the
+    // number of indexed words of the document.
+    void StoreDocument(int document_id, int rating, DocumentStatus status, uint32_t length, TextLocation text,
+                       DocumentContent content);
+
+    // Indexes the words of the document and stores it with the text added by add_text, which is only called once the
+    // words turned out valid.
+    template <typename AddText>
+    void AddDocument(int document_id, std::string_view document, DocumentStatus document_status,
+                     const std::vector<int>& document_ratings, AddText&& add_text);
+
     [[nodiscard]] static int ComputeAverageRating(const std::vector<int>& ratings);
 
-    [[nodiscard]] bool IsStopWord(const std::string_view word) const;
+    // Frequencies of the terms of a document given the ids of its words, sorted by term id.
+    [[nodiscard]] static std::vector<TermFrequency> ComputeTermFrequencies(std::vector<TermId> term_ids);
+
+    void ValidateNewDocumentIds(std::span<const DocumentToAdd> documents) const;
 
-    [[nodiscard]] const std::vector<std::string_view> SplitIntoWordsNoStop(const std::string_view text) const;
+    [[nodiscard]] PartialIndex BuildPartialIndex(std::span<const DocumentToAdd> documents) const;
 
-    [[nodiscard]] double ComputeWordInverseDocumentFrequency(const std::string_view word) const;
+    // Turns every partial index into a segment of its own, placed after all existing documents.
+    template <typename ExecutionPolicy>
+    void MergePartialIndexes(ExecutionPolicy&& policy, std::vector<PartialIndex>& partial_indexes) {
+        for (const PartialIndex& partial_index : partial_indexes) {
+            if (partial_index.error) {
+                std::rethrow_exception(partial_index.error);
+            }
+        }
+        // New segments have to follow the documents added one by one so far.
+        SealMutableSegment();
+
+        std::vector<std::vector<TermId>> term_ids(partial_indexes.size());
+        std::vector<DocumentOrdinal> first_ordinals(partial_indexes.size());
+        auto first_ordinal = static_cast<DocumentOrdinal>(storage_->documents.size());
+
+        for (size_t i = 0; i < partial_indexes.size(); ++i) {
+            const PartialIndex& partial_index = partial_indexes[i];
+
+            term_ids[i].resize(partial_index.terms.size());
+            std::transform(partial_index.terms.begin(), partial_index.terms.end(), term_ids[i].begin(),
+                           [this](std::string_view term) { return storage_->terms.Intern(term, *epoch_); });
+            first_ordinals[i] = first_ordinal;
+            first_ordinal += static_cast<DocumentOrdinal>(partial_index.documents.size());
+        }
+        document_frequencies_.resize(storage_->terms.size());
+
+        std::vector<Segment> segments(partial_indexes.size());
+
+        ForEachWorker(policy, partial_indexes.size(), [&](size_t worker) {
+            PartialIndex& partial_index = partial_indexes[worker];
+            const std::vector<TermId>& global_term_ids = term_ids[worker];
+            const auto is_less_term = [](const TermFrequency& lhs, const TermFrequency& rhs) {
+                return lhs.term_id < rhs.term_id;
+            };
+
+            for (std::vector<TermFrequency>& frequencies : partial_index.words_in_document_frequencies) {
+                for (TermFrequency& frequency : frequencies) {
+                    frequency.term_id = global_term_ids[frequency.term_id];
+                }
+                std::sort(frequencies.begin(), frequencies.end(), is_less_term);
+            }
+            std::vector<TermId> local_term_ids(global_term_ids.size());
+            std::iota(local_term_ids.begin(), local_term_ids.end(), 0);
+            std::sort(local_term_ids.begin(), local_term_ids.end(),
+                      [&](TermId lhs, TermId rhs) { return global_term_ids[lhs] < global_term_ids[rhs]; });
+
+            SegmentBuilder builder;
+
+            for (const TermId local_term_id : local_term_ids) {
+                for (const auto& [ordinal, term_frequency] : partial_index.postings[local_term_id]) {
+                    builder.AddPosting(global_term_ids[local_term_id], first_ordinals[worker] + ordinal,
+                                       term_frequency);
+                }
+            }
+            const auto document_count = static_cast<DocumentOrdinal>(partial_index.documents.size());
+
+            segments[worker] =
+                builder.Finish(first_ordinals[worker], first_ordinals[worker] + document_count, document_count);
+        });
+
+        for (size_t i = 0; i < partial_indexes.size(); ++i) {
+            PartialIndex& partial_index = partial_indexes[i];
+
+            for (size_t local_term_id = 0; local_term_id < term_ids[i].size(); ++local_term_id) {
+                document_frequencies_.GetMutable(term_ids[i][local_term_id], *epoch_) +=
+                    static_cast<uint32_t>(partial_index.postings[local_term_id].size());
+            }
+
+            for (size_t j = 0; j < partial_index.documents.size(); ++j) {
+                const DocumentData& document_data = partial_index.documents[j];
+                const TextLocation text = storage_->document_store.Append(partial_index.texts[j], *epoch_);
+
+                StoreDocument(document_data.id, document_data.rating, document_data.status,
+                              partial_index.document_lengths[j], text,
+                              {CowArray<TermFrequency>(std::move(partial_index.words_in_document_frequencies[j]))});
+            }
+
+            if (segments[i].GetDocumentCount() > 0) {
+                segments_.push_back({std::make_shared<const Segment>(std::move(segments[i])), {}});
+            }
+        }
+        mutable_segment_ =
+            std::make_shared<MutableSegment>(static_cast<DocumentOrdinal>(storage_->documents.size()));
+
+        MaintainSegments();
+        PublishVersion();
+    }
+
+    [[nodiscard]] static bool IsStopWord(const StopWordFilter& stop_words, const std::string_view word);
+
+    // Replaces the contents of words with the words of the text that are not stop words.
+    void SplitIntoWordsNoStop(const std::string_view text, std::vector<std::string_view>& words) const;
+
+    [[nodiscard]] static CorpusStatistics GetCorpusStatistics(const Version& version);
+
+    template <typename Scoring>
+    [[nodiscard]] static double ComputeWordInverseDocumentFrequency(const Version& version, TermId term_id) {
+        return InverseDocumentFrequencyTable<Scoring>::Get(version.document_count,
+                                                           version.document_frequencies[term_id]);
+    }
+
+    // Inverse document frequencies of query.plus_terms, in the same order, computed from this index alone.
+    template <typename Scoring>
+    [[nodiscard]] static std::vector<double> ComputeInverseDocumentFrequencies(const Version& version,
+                                                                               const Query& query) {
+        std::vector<double> inverse_document_frequencies(query.plus_terms.size());
+
+        std::transform(query.plus_terms.begin(), query.plus_terms.end(), inverse_document_frequencies.begin(),
+                       [&version](TermId term_id) {
+                           return ComputeWordInverseDocumentFrequency<Scoring>(version, term_id);
+                       });
+
+        return inverse_document_frequencies;
+    }
+
+    // The word is non-empty and free of control characters: the tokenizer has checked the whole query.
+    [[nodiscard]] static const QueryWord ParseQueryWord(const Version& version, std::string_view text);
+
+    [[nodiscard]] const Query ParseQuery(const Version& version, const std::string_view text) const;
+
+    [[nodiscard]] ThreadPool& GetThreadPool() const;
+
+    template <typename ExecutionPolicy>
+    [[nodiscard]] size_t GetWorkerCount(const ExecutionPolicy&) const {
+        if constexpr (std::is_same_v<std::decay_t<ExecutionPolicy>, std::execution::sequenced_policy>) {
+            return 1;
+        } else {
+            return GetThreadPool().GetWorkerCount() + 1;
+        }
+    }
+
+    // Calls body(worker) for every worker below worker_count, on the thread pool unless the policy is sequential.
+    template <typename ExecutionPolicy, typename Body>
+    void ForEachWorker(const ExecutionPolicy&, size_t worker_count, Body&& body) const {
+        if constexpr (std::is_same_v<std::decay_t<ExecutionPolicy>, std::execution::sequenced_policy>) {
+            for (size_t worker = 0; worker < worker_count; ++worker) {
+                body(worker);
+            }
+        } else {
+            GetThreadPool().ParallelFor(worker_count, body);
+        }
+    }
+
+    // Writes the top documents of every query of the chunk to the result at the same index.
+    void FindTopDocumentsInBatchChunk(const Version& version, std::span<const std::string> raw_queries,
+                                      DocumentStatus document_status, size_t top_document_count,
+                                      std::span<std::vector<Document>> results) const;
+
+    [[nodiscard]] static std::vector<OrdinalRange> SplitIntoOrdinalRanges(const Version& version,
+                                                                          size_t worker_count);
+
+    // Calls visitor(segment) for the immutable segments of the version and then for the mutable one, in ordinal
+    // order.
+    template <typename Visitor>
+    static void ForEachSegment(const Version& version, Visitor visitor) {
+        for (const std::shared_ptr<const Segment>& segment : version.segments) {
+            visitor(*segment);
+        }
+        visitor(MutableSegmentView{*version.mutable_segment, version.end_ordinal});
+    }
+
+    void MarkDeleted(DocumentOrdinal ordinal);
+
+    void SealMutableSegment();
+
+    // Installs a finished background merge and starts the next one the merge policy asks for. Called at the end of
+    // every modification; readers keep the segments of the versions they hold.
+    void MaintainSegments();
+
+    void InstallMerge();
+
+    // Merge policy: a segment with more deleted than live documents is rewritten alone; otherwise kMergeFactor
+    // adjacent segments of the same size level are merged into one of the next level. Only adjacent segments are
+    // merged, so segments keep covering disjoint ascending ordinal ranges.
+    [[nodiscard]] std::optional<std::pair<size_t, size_t>> ChooseMerge() const;
+
+    [[nodiscard]] static size_t GetSegmentLevel(const SegmentEntry& entry);
+
+    // Term weights are passed in by the caller, so an index holding only a part of the corpus can rank with
+    // statistics of the whole corpus.
+    template <typename Scoring, typename DocumentPredicate, typename ExecutionPolicy>
+    [[nodiscard]] std::vector<Document> FindTopDocumentsForQuery(
+        ExecutionPolicy&& policy, const Version& version, const Query& query,
+        const std::vector<double>& inverse_document_frequencies, const Scoring& scoring,
+        DocumentPredicate document_predicate, size_t top_document_count) const {
+        if constexpr (std::is_same_v<std::decay_t<ExecutionPolicy>, std::execution::sequenced_policy>) {
+            return FindTopDocumentsWithPruning(version, query, inverse_document_frequencies, scoring,
+                                               document_predicate, top_document_count);
+        } else {
+            return FindTopDocumentsExhaustive(policy, version, query, inverse_document_frequencies, scoring,
+                                              document_predicate, top_document_count);
+        }
+    }
+
+    // Scores every document matching the query. Each worker owns a disjoint range of ordinals, scores it into its own
+    // accumulator and selects the range's top documents into its own bounded heap, so workers never touch shared
+    // state; the per-range heaps are then merged.
+    template <typename Scoring, typename DocumentPredicate, typename ExecutionPolicy>
+    [[nodiscard]] std::vector<Document> FindTopDocumentsExhaustive(
+        ExecutionPolicy&& policy, const Version& version, const Query& query,
+        const std::vector<double>& inverse_document_frequencies, const Scoring& scoring,
+        DocumentPredicate& document_predicate, size_t top_document_count) const {
+        const std::vector<OrdinalRange> ranges = SplitIntoOrdinalRanges(version, GetWorkerCount(policy));
+        std::vector<TopDocuments> range_top_documents(ranges.size(), TopDocuments(top_document_count));
+
+        ForEachWorker(policy, ranges.size(), [&](size_t worker) {
+            FindTopDocumentsInRange(version, query, inverse_document_frequencies, scoring, ranges[worker],
+                                    document_predicate, range_top_documents[worker]);
+        });
+
+        TopDocuments top_documents(top_document_count);
+
+        for (const TopDocuments& range_top : range_top_documents) {
+            top_documents.Merge(range_top);
+        }
+
+        return top_documents.ExtractSorted();
+    }
+
+    template <typename Scoring, typename DocumentPredicate>
+    void FindTopDocumentsInRange(const Version& version, const Query& query,
+                                 const std::vector<double>& inverse_document_frequencies, const Scoring& scoring,
+                                 OrdinalRange range, DocumentPredicate& document_predicate,
+                                 TopDocuments& top_documents) const {
+        thread_local ScoreAccumulator accumulator;
+        const Storage& storage = *version.storage;
+
+        accumulator.Reset(range.end - range.begin);
+
+        ForEachSegment(version, [&](const auto& segment) {
+            if (segment.GetEndOrdinal() <= range.begin || segment.GetFirstOrdinal() >= range.end) {
+                return;
+            }
+
+            for (const TermId term_id : query.minus_terms) {
+                const auto& postings = segment.GetPostings(term_id);
+                const std::span<const DocumentOrdinal> ordinals = postings.GetOrdinals();
+
+                for (auto it = std::lower_bound(ordinals.begin(), ordinals.end(), range.begin);
+                     it != ordinals.end() && *it < range.end; ++it) {
+                    accumulator.Exclude(*it - range.begin);
+                }
+            }
+
+            for (size_t i = 0; i < query.plus_terms.size(); ++i) {
+                const auto& postings = segment.GetPostings(query.plus_terms[i]);
+                const std::span<const DocumentOrdinal> ordinals = postings.GetOrdinals();
+                const std::span<const double> term_frequencies = postings.GetTermFrequencies();
+                const double inverse_document_frequency = inverse_document_frequencies[i];
+
+                const auto first = std::lower_bound(ordinals.begin(), ordinals.end(), range.begin);
 
-    [[nodiscard]] const QueryWord ParseQueryWord(std::string_view text) const;
+                for (auto j = static_cast<size_t>(first - ordinals.begin());
+                     j < ordinals.size() && ordinals[j] < range.end; ++j) {
+                    const uint32_t document_length = GetDocumentLength<Scoring>(storage, ordinals[j]);
 
-    [[nodiscard]] const Query ParseQuery(const std::string_view text) const;
+                    accumulator.Add(ordinals[j] - range.begin,
+                                    scoring.Score(term_frequencies[j], document_length) * inverse_document_frequency);
+                }
+            }
+        });
+
+        accumulator.ForEachScored([&](size_t slot, double relevance) {
+            const DocumentOrdinal ordinal = range.begin + static_cast<DocumentOrdinal>(slot);
 
-    template <typename Filter>
-    [[nodiscard]] const std::vector<Document> FindAllDocuments(const Query& query, Filter query_filter) const {
-        return FindAllDocuments(std::execution::seq, query, query_filter);
+            if (IsRemoved(version, ordinal)) {
+                return;
+            }
+            const DocumentData& document_data = storage.documents[ordinal];
+
+            if (document_predicate(document_data.id, document_data.status, document_data.rating)) {
+                top_documents.Add({document_data.id, relevance, document_data.rating});
+            }
+        });
     }
 
-    template <typename DocumentPredicate, typename ExecutionPolicy>
-    [[nodiscard]] std::vector<Document> FindAllDocuments(ExecutionPolicy&& policy, const Query& query,
-                                                         DocumentPredicate document_predicate) const {
-        ConcurrentMap<int, double> documents_to_relevance(kBucketsNumber);
+    // Document-at-a-time evaluation with Block-Max WAND pruning. Cursors are kept ordered by their current ordinal;
+    // the pivot is the first cursor at which the summed per-term score upper bounds can still beat the worst of the
+    // current top documents, and everything before the pivot is skipped. Candidates that pass this check are
+    // rejected once more by their per-block upper bounds before being scored in full. The result is the same top as
+    // ranking every matching document, only without touching most of them.
+    //
+    // Segments are searched one after another into the same top, so the threshold reached in one segment already
+    // prunes the next.
+    template <typename Scoring, typename DocumentPredicate>
+    [[nodiscard]] std::vector<Document> FindTopDocumentsWithPruning(
+        const Version& version, const Query& query, const std::vector<double>& inverse_document_frequencies,
+        const Scoring& scoring, DocumentPredicate& document_predicate, size_t top_document_count) const {
+        TopDocuments top_documents(top_document_count);
 
-        for_each(policy, query.plus_words.begin(), query.plus_words.end(),
-                 [this, &documents_to_relevance, &document_predicate](auto word) {
-                     if (word_to_document_frequencies_.count(word) > 0) {
-                         const double inverse_document_frequency = ComputeWordInverseDocumentFrequency(word);
+        ForEachSegment(version, [&](const auto& segment) {
+            FindTopDocumentsInSegment(version, segment, query, inverse_document_frequencies, scoring,
+                                      document_predicate, top_documents);
+        });
+
+        return top_documents.ExtractSorted();
+    }
 
-                         for (const auto& [document_id, term_frequency] : word_to_document_frequencies_.at(word)) {
-                             const auto& document_data = documents_.at(document_id);
+    template <typename SegmentType, typename Scoring, typename DocumentPredicate>
+    void FindTopDocumentsInSegment(const Version& version, const SegmentType& segment, const Query& query,
+                                   const std::vector<double>& inverse_document_frequencies, const Scoring& scoring,
+                                   DocumentPredicate& document_predicate, TopDocuments& top_documents) const {
+        // Cursors view the lists, and lists of the mutable segment own their block maxima, so they are kept here.
+        std::vector<PostingList> posting_lists;
+        std::vector<PostingCursor> cursors;
+        std::vector<PostingCursor> minus_cursors;
 
-                             if (document_predicate(document_id, document_data.status, document_data.rating)) {
-                                 documents_to_relevance[document_id].ref_to_value +=
-                                     term_frequency * inverse_document_frequency;
-                             }
-                         }
-                     }
-                 });
+        posting_lists.reserve(query.plus_terms.size() + query.minus_terms.size());
 
-        for_each(policy, query.minus_words.begin(), query.minus_words.end(),
-                 [this, &documents_to_relevance](auto word) {
-                     if (word_to_document_frequencies_.count(word) > 0) {
-                         for (const auto& [document_id, _] : word_to_document_frequencies_.at(word)) {
-                             documents_to_relevance.Erase(document_id);
-                         }
-                     }
-                 });
-        std::vector<Document> matched_documents;
+        for (size_t i = 0; i < query.plus_terms.size(); ++i) {
+            const PostingList& postings = posting_lists.emplace_back(segment.GetPostings(query.plus_terms[i]));
 
-        for (const auto& [document_id, relevance] : documents_to_relevance.BuildOrdinaryMap()) {
-            matched_documents.push_back({document_id, relevance, documents_.at(document_id).rating});
+            if (!postings.empty()) {
+                cursors.emplace_back(postings, inverse_document_frequencies[i], scoring);
+            }
         }
 
-        return matched_documents;
+        for (const TermId term_id : query.minus_terms) {
+            minus_cursors.emplace_back(posting_lists.emplace_back(segment.GetPostings(term_id)));
+        }
+        FindTopDocumentsWithCursors(version, cursors, minus_cursors, scoring, document_predicate, top_documents);
+    }
+
+    // Runs Block-Max WAND over cursors of the plus terms, ordered as the query lists them, and of the minus terms.
+    template <typename Scoring, typename DocumentPredicate>
+    void FindTopDocumentsWithCursors(const Version& version, std::vector<PostingCursor>& cursors,
+                                     std::vector<PostingCursor>& minus_cursors, const Scoring& scoring,
+                                     DocumentPredicate& document_predicate, TopDocuments& top_documents) const {
+        const Storage& storage = *version.storage;
+        const auto is_excluded = [&](DocumentOrdinal ordinal) {
+            return IsRemoved(version, ordinal) ||
+                   std::any_of(minus_cursors.begin(), minus_cursors.end(), [ordinal](PostingCursor& cursor) {
+                       cursor.Advance(ordinal);
+                       return cursor.GetOrdinal() == ordinal;
+                   });
+        };
+
+        while (true) {
+            std::sort(cursors.begin(), cursors.end(), [](const PostingCursor& lhs, const PostingCursor& rhs) {
+                return lhs.GetOrdinal() < rhs.GetOrdinal();
+            });
+
+            const double min_relevance = top_documents.GetMinCompetitiveRelevance();
+
+            double upper_bound = 0.0;
+            size_t pivot = 0;
+
+            for (; pivot < cursors.size() && cursors[pivot].GetOrdinal() != PostingCursor::kEnd; ++pivot) {
+                upper_bound += cursors[pivot].GetMaxScore();
+
+                if (upper_bound >= min_relevance) {
+                    break;
+                }
+            }
+
+            if (pivot == cursors.size() || cursors[pivot].GetOrdinal() == PostingCursor::kEnd) {
+                break;
+            }
+            const DocumentOrdinal pivot_ordinal = cursors[pivot].GetOrdinal();
+
+            if (cursors.front().GetOrdinal() != pivot_ordinal) {
+                for (size_t i = 0; i < pivot; ++i) {
+                    cursors[i].Advance(pivot_ordinal);
+                }
+                continue;
+            }
+
+            size_t last = pivot;
+
+            while (last + 1 < cursors.size() && cursors[last + 1].GetOrdinal() == pivot_ordinal) {
+                ++last;
+            }
+            double block_upper_bound = 0.0;
+
+            for (size_t i = 0; i <= last; ++i) {
+                block_upper_bound += cursors[i].GetBlockMaxScore(scoring);
+            }
+
+            if (block_upper_bound < min_relevance) {
+                // No document before the end of the shortest current block, or before the next cursor that is not
+                // part of this candidate, can collect enough score.
+                DocumentOrdinal next_ordinal = last + 1 < cursors.size() ? cursors[last + 1].GetOrdinal()
+                                                                         : PostingCursor::kEnd;
+
+                for (size_t i = 0; i <= last; ++i) {
+                    next_ordinal = std::min(next_ordinal, cursors[i].GetBlockLastOrdinal() + 1);
+                }
+
+                for (size_t i = 0; i <= last; ++i) {
+                    cursors[i].Advance(next_ordinal);
+                }
+                continue;
+            }
+            const uint32_t document_length = GetDocumentLength<Scoring>(storage, pivot_ordinal);
+            double relevance = 0.0;
+
+            for (size_t i = 0; i <= last; ++i) {
+                relevance += cursors[i].GetScore(scoring, document_length);
+                cursors[i].Next();
+            }
+
+            if (relevance < min_relevance || is_excluded(pivot_ordinal)) {
+                continue;
+            }
+            const DocumentData& document_data = storage.documents[pivot_ordinal];
+
+            if (!document_predicate(document_data.id, document_data.status, document_data.rating)) {
+                continue;
+            }
+            top_documents.Add({document_data.id, relevance, document_data.rating});
+        }
     }
 
 private:
-    std::set<std::string> stop_words_;
-    std::map<std::string_view, std::map<int, double>> word_to_document_frequencies_;
-    std::map<int, std::map<std::string_view, double>> words_in_document_frequencies_;
-    std::map<int, DocumentData> documents_;
-    std::set<int> documents_ids_;
+    // Shared with readers.
+    std::atomic<std::shared_ptr<const Version>> version_;
+    // Entries are tagged with version numbers, so publishing a version invalidates them.
+    mutable QueryCache query_cache_{kQueryCacheCapacity};
+    // Null until a pool is set: the default pool is only created once something runs in parallel.
+    std::atomic<ThreadPool*> thread_pool_ = nullptr;
+
+    // Writer state, guarded by write_mutex_.
+    mutable std::mutex write_mutex_;
+    std::shared_ptr<Storage> storage_ = std::make_shared<Storage>();
+    std::shared_ptr<const StopWordFilter> stop_words_;
+    std::vector<SegmentEntry> segments_;
+    std::shared_ptr<MutableSegment> mutable_segment_ = std::make_shared<MutableSegment>();
+    Tombstones mutable_segment_tombstones_;
+    VersionedArray<uint32_t> document_frequencies_;
+    // Terms whose document frequency fell to zero, collected since the last batch was closed, and that batch.
+    std::vector<TermId> unused_terms_;
+    std::vector<TermId> closed_unused_terms_;
+    std::weak_ptr<Epoch> closed_unused_terms_epoch_;
+    std::optional<PendingMerge> pending_merge_;
+    // Ids of the live documents for iteration; those of an opened file only once listed. Guarded by write_mutex_.
+    mutable std::set<int> documents_ids_;
+    mutable bool are_file_ids_listed_ = true;
+    size_t document_count_ = 0;
+    // Memory of the terms of live documents held by the document contents of the storage.
+    MemoryUsage forward_index_usage_;
+    uint64_t total_document_length_ = 0;
+    uint64_t version_number_ = 0;
+    std::shared_ptr<Epoch> epoch_ = std::make_shared<Epoch>();
 };
@@ -0,0 +1,149 @@
+#include "segment.h"
+
+#include <algorithm>
+
+Segment::Segment(DocumentOrdinal first_ordinal, DocumentOrdinal end_ordinal, size_t document_count,
+                 CowArray<TermId> term_ids, CowArray<uint64_t> posting_offsets, CowArray<DocumentOrdinal> ordinals,
+                 CowArray<double> term_frequencies, CowArray<uint64_t> block_max_offsets,
+                 CowArray<double> block_max_term_frequencies)
+    : first_ordinal_(first_ordinal),
+      end_ordinal_(end_ordinal),
+      document_count_(document_count),
+      term_ids_(std::move(term_ids)),
+      posting_offsets_(std::move(posting_offsets)),
+      ordinals_(std::move(ordinals)),
+      term_frequencies_(std::move(term_frequencies)),
+      block_max_offsets_(std::move(block_max_offsets)),
+      block_max_term_frequencies_(std::move(block_max_term_frequencies)) {}
+
+[[nodiscard]] Segment Segment::Merge(std::span<const std::shared_ptr<const Segment>> segments,
+                                     std::span<const Tombstones> tombstones) {
+    if (segments.empty()) {
+        return {};
+    }
+    SegmentBuilder builder;
+    std::vector<size_t> positions(segments.size(), 0);
+    size_t document_count = 0;
+
+    for (size_t i = 0; i < segments.size(); ++i) {
+        document_count += segments[i]->GetDocumentCount() - tombstones[i].count();
+    }
+
+    // Term lists of all segments are walked together in id order; segments cover ascending ordinal ranges, so the
+    // postings of a term are concatenated in segment order.
+    while (true) {
+        TermId term_id = TermDictionary::kNoTerm;
+
+        for (size_t i = 0; i < segments.size(); ++i) {
+            const std::span<const TermId> term_ids = segments[i]->GetTermIds();
+
+            if (positions[i] < term_ids.size()) {
+                term_id = std::min(term_id, term_ids[positions[i]]);
+            }
+        }
+
+        if (term_id == TermDictionary::kNoTerm) {
+            break;
+        }
+
+        for (size_t i = 0; i < segments.size(); ++i) {
+            const Segment& segment = *segments[i];
+            const std::span<const TermId> term_ids = segment.GetTermIds();
+
+            if (positions[i] == term_ids.size() || term_ids[positions[i]] != term_id) {
+                continue;
+            }
+            const PostingList postings = segment.GetPostingsAt(positions[i]++);
+            const std::span<const DocumentOrdinal> ordinals = postings.GetOrdinals();
+            const std::span<const double> term_frequencies = postings.GetTermFrequencies();
+
+            for (size_t j = 0; j < ordinals.size(); ++j) {
+                if (!tombstones[i].Contains(ordinals[j] - segment.first_ordinal_)) {
+                    builder.AddPosting(term_id, ordinals[j], term_frequencies[j]);
+                }
+            }
+        }
+    }
+
+    return builder.Finish(segments.front()->first_ordinal_, segments.back()->end_ordinal_, document_count);
+}
+
+[[nodiscard]] DocumentOrdinal Segment::GetFirstOrdinal() const { return first_ordinal_; }
+
+[[nodiscard]] DocumentOrdinal Segment::GetEndOrdinal() const { return end_ordinal_; }
+
+[[nodiscard]] size_t Segment::GetDocumentCount() const { return document_count_; }
+
+[[nodiscard]] PostingList Segment::GetPostings(TermId term_id) const {
+    const std::span<const TermId> term_ids = term_ids_.GetSpan();
+    const auto it = std::lower_bound(term_ids.begin(), term_ids.end(), term_id);
+
+    if (it == term_ids.end() || *it != term_id) {
+        return {};
+    }
+
+    return GetPostingsAt(static_cast<size_t>(it - term_ids.begin()));
+}
+
+[[nodiscard]] std::span<const TermId> Segment::GetTermIds() const { return term_ids_.GetSpan(); }
+
+[[nodiscard]] MemoryUsage Segment::GetMemoryUsage() const {
+    MemoryUsage usage{sizeof(Segment), 0, 1};
+
+    usage += term_ids_.GetMemoryUsage();
+    usage += posting_offsets_.GetMemoryUsage();
+    usage += ordinals_.GetMemoryUsage();
+    usage += term_frequencies_.GetMemoryUsage();
+    usage += block_max_offsets_.GetMemoryUsage();
+    usage += block_max_term_frequencies_.GetMemoryUsage();
+    usage.object_count = ordinals_.size();
+
+    return usage;
+}
+
+[[nodiscard]] PostingList Segment::GetPostingsAt(size_t index) const {
+    const std::span<const uint64_t> posting_offsets = posting_offsets_.GetSpan();
+    const std::span<const uint64_t> block_max_offsets = block_max_offsets_.GetSpan();
+    const size_t posting_count = posting_offsets[index + 1] - posting_offsets[index];
+    const size_t block_count = block_max_offsets[index + 1] - block_max_offsets[index];
+
+    return {ordinals_.GetSpan().subspan(posting_offsets[index], posting_count),
+            term_frequencies_.GetSpan().subspan(posting_offsets[index], posting_count),
+            block_max_term_frequencies_.GetSpan().subspan(block_max_offsets[index], block_count)};
+}
+
+void SegmentBuilder::AddPosting(TermId term_id, DocumentOrdinal ordinal, double term_frequency) {
+    if (term_ids_.empty() || term_ids_.back() != term_id) {
+        if (!term_ids_.empty()) {
+            posting_offsets_.push_back(ordinals_.size());
+            block_max_offsets_.push_back(block_max_term_frequencies_.size());
+        }
+        term_ids_.push_back(term_id);
+    }
+
+    if ((ordinals_.size() - posting_offsets_.back()) % PostingList::kBlockSize == 0) {
+        block_max_term_frequencies_.push_back(term_frequency);
+    } else {
+        block_max_term_frequencies_.back() = std::max(block_max_term_frequencies_.back(), term_frequency);
+    }
+    ordinals_.push_back(ordinal);
+    term_frequencies_.push_back(term_frequency);
+}
+
+[[nodiscard]] Segment SegmentBuilder::Finish(DocumentOrdinal first_ordinal, DocumentOrdinal end_ordinal,
+                                             size_t document_count) {
+    if (!term_ids_.empty()) {
+        posting_offsets_.push_back(ordinals_.size());
+        block_max_offsets_.push_back(block_max_term_frequencies_.size());
+    }
+
+    return {first_ordinal,
+            end_ordinal,
+            document_count,
+            CowArray<TermId>(std::move(term_ids_)),
+            CowArray<uint64_t>(std::move(posting_offsets_)),
+            CowArray<DocumentOrdinal>(std::move(ordinals_)),
+            CowArray<double>(std::move(term_frequencies_)),
+            CowArray<uint64_t>(std::move(block_max_offsets_)),
+            CowArray<double>(std::move(block_max_term_frequencies_))};
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <vector>
+
+#include "cow_array.h"
+#include "memory_stats.h"
+#include "posting_list.h"
+#include "term_dictionary.h"
+#include "tombstones.h"
+
+// Immutable index of the documents with ordinals in [first ordinal, end ordinal). Postings of all terms are stored
+// back to back in a few flat arrays (compressed sparse rows): the terms present in the segment are sorted by id and
+// the postings of the i-th of them are found between the i-th and (i + 1)-th offset. Block maxima are laid out the
+// same way.
+//
+// A segment is never modified once built. Deleted documents are tracked by the owner in Tombstones, and are dropped
+// when segments are merged.
+class Segment {
+public:
+    Segment() = default;
+
+    Segment(DocumentOrdinal first_ordinal, DocumentOrdinal end_ordinal, size_t document_count,
+            CowArray<TermId> term_ids, CowArray<uint64_t> posting_offsets, CowArray<DocumentOrdinal> ordinals,
+            CowArray<double> term_frequencies, CowArray<uint64_t> block_max_offsets,
+            CowArray<double> block_max_term_frequencies);
+
+public:
+    // Merges adjacent segments given in ordinal order into one, leaving out the postings of documents marked in the
+    // tombstones of their segment.
+    [[nodiscard]] static Segment Merge(std::span<const std::shared_ptr<const Segment>> segments,
+                                       std::span<const Tombstones> tombstones);
+
+    [[nodiscard]] DocumentOrdinal GetFirstOrdinal() const;
+
+    [[nodiscard]] DocumentOrdinal GetEndOrdinal() const;
+
+    // Number of documents the segment was built with, including those deleted since.
+    [[nodiscard]] size_t GetDocumentCount() const;
+
+    // View of the postings of a term, empty if no document of the segment contains it.
+    [[nodiscard]] PostingList GetPostings(TermId term_id) const;
+
+    [[nodiscard]] std::span<const TermId> GetTermIds() const;
+
+    // Objects are postings.
+    [[nodiscard]] MemoryUsage GetMemoryUsage() const;
+
+private:
+    [[nodiscard]] PostingList GetPostingsAt(size_t index) const;
+
+private:
+    DocumentOrdinal first_ordinal_ = 0;
+    DocumentOrdinal end_ordinal_ = 0;
+    size_t document_count_ = 0;
+    CowArray<TermId> term_ids_;
+    CowArray<uint64_t> posting_offsets_{std::vector<uint64_t>{0}};
+    CowArray<DocumentOrdinal> ordinals_;
+    CowArray<double> term_frequencies_;
+    CowArray<uint64_t> block_max_offsets_{std::vector<uint64_t>{0}};
+    CowArray<double> block_max_term_frequencies_;
+};
+
+// Builds a segment from postings added term by term in ascending term id order, each term's postings in ascending
+// ordinal order.
+class SegmentBuilder {
+public:
+    SegmentBuilder() = default;
+
+public:
+    void AddPosting(TermId term_id, DocumentOrdinal ordinal, double term_frequency);
+
+    [[nodiscard]] Segment Finish(DocumentOrdinal first_ordinal, DocumentOrdinal end_ordinal, size_t document_count);
+
+private:
+    std::vector<TermId> term_ids_;
+    std::vector<uint64_t> posting_offsets_{0};
+    std::vector<DocumentOrdinal> ordinals_;
+    std::vector<double> term_frequencies_;
+    std::vector<uint64_t> block_max_offsets_{0};
+    std::vector<double> block_max_term_frequencies_;
+};
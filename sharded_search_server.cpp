@@ -0,0 +1,156 @@
+#include "sharded_search_server.h"
+
+#include <unordered_map>
+
+ShardedSearchServer::ShardedSearchServer(const std::string_view stop_words_text, size_t shard_count)
+    : ShardedSearchServer(std::string{stop_words_text.begin(), stop_words_text.end()}, shard_count) {}
+
+ShardedSearchServer::ShardedSearchServer(const std::string& stop_words_text, size_t shard_count) {
+    if (shard_count == 0) {
+        throw std::invalid_argument("Shard count should be positive");
+    }
+
+    for (size_t i = 0; i < shard_count; ++i) {
+        shards_.push_back(std::make_unique<Shard>(stop_words_text));
+    }
+}
+
+void ShardedSearchServer::SetStopWords(const std::string& text) {
+    for (auto& shard : shards_) {
+        shard->index.SetStopWords(text);
+    }
+}
+
+void ShardedSearchServer::SetThreadPool(ThreadPool& thread_pool) {
+    for (auto& shard : shards_) {
+        shard->index.SetThreadPool(thread_pool);
+    }
+}
+
+void ShardedSearchServer::AddDocument(int document_id, const std::string_view document,
+                                      DocumentStatus document_status, const std::vector<int>& document_ratings) {
+    if (document_id < 0) {
+        throw std::invalid_argument("Error adding document. Invalid document id!");
+    }
+    GetShard(document_id).index.AddDocument(document_id, document, document_status, document_ratings);
+
+    std::lock_guard guard(documents_ids_mutex_);
+    documents_ids_.insert(document_id);
+}
+
+[[nodiscard]] const std::vector<Document> ShardedSearchServer::FindTopDocuments(const std::string_view raw_query,
+                                                                                DocumentStatus document_status,
+                                                                                size_t top_document_count) const {
+    return FindTopDocuments(
+        raw_query, [=](int, DocumentStatus status, int) { return status == document_status; },
+        top_document_count);
+}
+
+[[nodiscard]] int ShardedSearchServer::GetDocumentCount() const {
+    return std::accumulate(shards_.begin(), shards_.end(), 0,
+                           [](int count, const auto& shard) { return count + shard->index.GetDocumentCount(); });
+}
+
+[[nodiscard]] size_t ShardedSearchServer::GetShardCount() const { return shards_.size(); }
+
+std::tuple<std::vector<std::string_view>, DocumentStatus> ShardedSearchServer::MatchDocument(
+    std::string_view raw_query, int document_id) const {
+    return MatchDocument(std::execution::seq, raw_query, document_id);
+}
+
+std::vector<std::tuple<std::vector<std::string_view>, DocumentStatus>> ShardedSearchServer::MatchDocuments(
+    std::string_view raw_query, std::span<const int> document_ids) const {
+    return MatchDocuments(std::execution::seq, raw_query, document_ids);
+}
+
+[[nodiscard]] const std::map<std::string_view, double> ShardedSearchServer::GetWordFrequencies(
+    int document_id) const {
+    return GetShard(document_id).index.GetWordFrequencies(document_id);
+}
+
+[[nodiscard]] std::string ShardedSearchServer::GetDocumentText(int document_id) const {
+    return GetShard(document_id).index.GetDocumentText(document_id);
+}
+
+[[nodiscard]] MemoryStats ShardedSearchServer::GetMemoryStats() const {
+    static constexpr size_t kIdNodeSize = 4 * sizeof(void*);
+
+    MemoryStats stats;
+
+    for (const auto& shard : shards_) {
+        stats += shard->index.GetMemoryStats();
+    }
+    std::lock_guard guard(documents_ids_mutex_);
+    const size_t id_count = documents_ids_.size();
+
+    stats.document_ids += {id_count * kIdNodeSize, id_count, id_count};
+    stats.allocator_overhead_bytes += id_count * MemoryStats::kAllocationOverhead;
+
+    return stats;
+}
+
+void ShardedSearchServer::RemoveDocument(int document_id) { RemoveDocument(std::execution::seq, document_id); }
+
+void ShardedSearchServer::RemoveDocuments(std::span<const int> document_ids) {
+    RemoveDocuments(std::execution::seq, document_ids);
+}
+
+void ShardedSearchServer::Compact() {
+    for (const auto& shard : shards_) {
+        shard->index.Compact();
+    }
+}
+
+std::set<int>::const_iterator ShardedSearchServer::begin() const { return documents_ids_.begin(); }
+
+std::set<int>::const_iterator ShardedSearchServer::end() const { return documents_ids_.end(); }
+
+[[nodiscard]] ShardedSearchServer::Shard& ShardedSearchServer::GetShard(int document_id) {
+    return *shards_[static_cast<size_t>(document_id) % shards_.size()];
+}
+
+[[nodiscard]] const ShardedSearchServer::Shard& ShardedSearchServer::GetShard(int document_id) const {
+    return *shards_[static_cast<size_t>(document_id) % shards_.size()];
+}
+
+[[nodiscard]] std::vector<std::vector<double>> ShardedSearchServer::ComputeInverseDocumentFrequencies(
+    const std::vector<std::shared_ptr<const SearchServer::Version>>& versions,
+    const std::vector<SearchServer::Query>& queries,
+    double (*compute_inverse_document_frequency)(size_t, size_t)) const {
+    std::unordered_map<std::string_view, size_t> document_frequencies;
+    size_t document_count = 0;
+
+    for (size_t i = 0; i < shards_.size(); ++i) {
+        for (const TermId term_id : queries[i].plus_terms) {
+            document_frequencies[versions[i]->storage->terms.GetTerm(term_id)] +=
+                versions[i]->document_frequencies[term_id];
+        }
+        document_count += versions[i]->document_count;
+    }
+    std::vector<std::vector<double>> inverse_document_frequencies(shards_.size());
+
+    for (size_t i = 0; i < shards_.size(); ++i) {
+        for (const TermId term_id : queries[i].plus_terms) {
+            const size_t document_frequency = document_frequencies.at(versions[i]->storage->terms.GetTerm(term_id));
+
+            inverse_document_frequencies[i].push_back(
+                compute_inverse_document_frequency(document_count, document_frequency));
+        }
+    }
+
+    return inverse_document_frequencies;
+}
+
+[[nodiscard]] CorpusStatistics ShardedSearchServer::GetCorpusStatistics(
+    const std::vector<std::shared_ptr<const SearchServer::Version>>& versions) {
+    size_t document_count = 0;
+    uint64_t total_document_length = 0;
+
+    for (const auto& version : versions) {
+        document_count += version->document_count;
+        total_document_length += version->total_document_length;
+    }
+
+    return {document_count,
+            document_count == 0 ? 0.0 : static_cast<double>(total_document_length) / document_count};
+}
@@ -0,0 +1,231 @@
+#pragma once
+
+#include <algorithm>
+#include <execution>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <numeric>
+#include <set>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "document.h"
+#include "memory_stats.h"
+#include "search_server.h"
+#include "thread_pool.h"
+#include "top_documents.h"
+
+// Search server that partitions documents across independent SearchServer shards by document id. Queries are
+// scattered to every shard and the per-shard top documents are gathered into one result. Term weights are computed
+// from document counts summed over all shards, so ranking is the same as with a single index holding every document.
+//
+// Writes to different shards run concurrently. A query pins the current version of every shard, so it may overlap
+// with writes and sees each shard as of some moment during the call; iteration must not overlap with writes.
+class ShardedSearchServer {
+public:
+    static constexpr size_t kMaxResultDocumentCount = SearchServer::kMaxResultDocumentCount;
+
+public:
+    template <typename StringContainer>
+    ShardedSearchServer(const StringContainer& stop_words, size_t shard_count) {
+        if (shard_count == 0) {
+            throw std::invalid_argument("Shard count should be positive");
+        }
+
+        for (size_t i = 0; i < shard_count; ++i) {
+            shards_.push_back(std::make_unique<Shard>(stop_words));
+        }
+    }
+
+    ShardedSearchServer(const std::string_view stop_words_text, size_t shard_count);
+
+    ShardedSearchServer(const std::string& stop_words_text, size_t shard_count);
+
+public:
+    void SetStopWords(const std::string& text);
+
+    // Shards are searched in parallel on this pool, which must outlive the server.
+    void SetThreadPool(ThreadPool& thread_pool);
+
+    void AddDocument(int document_id, const std::string_view document, DocumentStatus document_status,
+                     const std::vector<int>& document_ratings);
+
+    [[nodiscard]] const std::vector<Document> FindTopDocuments(
+        const std::string_view raw_query, DocumentStatus document_status = DocumentStatus::kActual,
+        size_t top_document_count = kMaxResultDocumentCount) const;
+
+    template <typename Scoring = TfIdfScoring, typename Filter>
+    [[nodiscard]] const std::vector<Document> FindTopDocuments(
+        const std::string_view raw_query, Filter filter, size_t top_document_count = kMaxResultDocumentCount) const {
+        return FindTopDocuments<Scoring>(std::execution::seq, raw_query, filter, top_document_count);
+    }
+
+    // Every shard runs its own pruned top-k search; the policy decides whether shards are searched in parallel on the
+    // thread pool. The scoring model is chosen as in SearchServer::FindTopDocuments.
+    template <typename Scoring = TfIdfScoring, typename Filter, typename ExecutionPolicy>
+    [[nodiscard]] const std::vector<Document> FindTopDocuments(
+        ExecutionPolicy&& policy, const std::string_view raw_query, Filter filter,
+        size_t top_document_count = kMaxResultDocumentCount) const {
+        // Parsing may throw, so it is kept out of the parallel section.
+        std::vector<std::shared_ptr<const SearchServer::Version>> versions;
+        std::vector<SearchServer::Query> queries;
+
+        for (const auto& shard : shards_) {
+            const SearchServer& index = shard->index;
+
+            queries.push_back(index.ParseQuery(*versions.emplace_back(index.PinVersion()), raw_query));
+        }
+        const std::vector<std::vector<double>> inverse_document_frequencies =
+            ComputeInverseDocumentFrequencies(versions, queries, &InverseDocumentFrequencyTable<Scoring>::Get);
+        const Scoring scoring(GetCorpusStatistics(versions));
+
+        std::vector<TopDocuments> shard_top_documents(shards_.size(), TopDocuments(top_document_count));
+
+        shards_.front()->index.ForEachWorker(policy, shards_.size(), [&](size_t shard_index) {
+            for (const Document& document : shards_[shard_index]->index.FindTopDocumentsForQuery(
+                     std::execution::seq, *versions[shard_index], queries[shard_index],
+                     inverse_document_frequencies[shard_index], scoring, filter, top_document_count)) {
+                shard_top_documents[shard_index].Add(document);
+            }
+        });
+
+        TopDocuments top_documents(top_document_count);
+
+        for (const TopDocuments& shard_top : shard_top_documents) {
+            top_documents.Merge(shard_top);
+        }
+
+        return top_documents.ExtractSorted();
+    }
+
+    [[nodiscard]] int GetDocumentCount() const;
+
+    [[nodiscard]] size_t GetShardCount() const;
+
+    [[nodiscard]] std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(std::string_view raw_query,
+                                                                                          int document_id) const;
+
+    template <class ExecutionPolicy>
+    [[nodiscard]] std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(ExecutionPolicy&& policy,
+                                                                                          std::string_view raw_query,
+                                                                                          int document_id) const {
+        return GetShard(document_id).index.MatchDocument(policy, raw_query, document_id);
+    }
+
+    [[nodiscard]] std::vector<std::tuple<std::vector<std::string_view>, DocumentStatus>> MatchDocuments(
+        std::string_view raw_query, std::span<const int> document_ids) const;
+
+    // Every shard matches its part of the list as one batch; the policy decides whether shards do so in parallel on
+    // the thread pool. Results are in the order of the list.
+    template <class ExecutionPolicy>
+    [[nodiscard]] std::vector<std::tuple<std::vector<std::string_view>, DocumentStatus>> MatchDocuments(
+        ExecutionPolicy&& policy, std::string_view raw_query, std::span<const int> document_ids) const {
+        // Positions in the list of the documents of every shard.
+        std::vector<std::vector<size_t>> shard_positions(shards_.size());
+        std::vector<std::vector<int>> shard_document_ids(shards_.size());
+
+        for (size_t i = 0; i < document_ids.size(); ++i) {
+            const size_t shard_index = static_cast<size_t>(document_ids[i]) % shards_.size();
+
+            shard_positions[shard_index].push_back(i);
+            shard_document_ids[shard_index].push_back(document_ids[i]);
+        }
+        std::vector<std::tuple<std::vector<std::string_view>, DocumentStatus>> results(document_ids.size());
+
+        shards_.front()->index.ForEachWorker(policy, shards_.size(), [&](size_t shard_index) {
+            auto shard_results =
+                shards_[shard_index]->index.MatchDocuments(raw_query, shard_document_ids[shard_index]);
+
+            for (size_t i = 0; i < shard_results.size(); ++i) {
+                results[shard_positions[shard_index][i]] = std::move(shard_results[i]);
+            }
+        });
+
+        return results;
+    }
+
+    [[nodiscard]] const std::map<std::string_view, double> GetWordFrequencies(int document_id) const;
+
+    [[nodiscard]] std::string GetDocumentText(int document_id) const;
+
+    template <typename Visitor>
+    void ForEachWord(int document_id, Visitor visitor) const {
+        GetShard(document_id).index.ForEachWord(document_id, visitor);
+    }
+
+    // Sum over the shards; the ids kept by the sharded server itself are added to document_ids.
+    [[nodiscard]] MemoryStats GetMemoryStats() const;
+
+    void RemoveDocument(int document_id);
+
+    template <class ExecutionPolicy>
+    void RemoveDocument(ExecutionPolicy&& policy, int document_id) {
+        GetShard(document_id).index.RemoveDocument(policy, document_id);
+
+        std::lock_guard guard(documents_ids_mutex_);
+        documents_ids_.erase(document_id);
+    }
+
+    void RemoveDocuments(std::span<const int> document_ids);
+
+    // Every shard removes its part of the documents as one batch; the policy decides whether shards do so in parallel
+    // on the thread pool.
+    template <class ExecutionPolicy>
+    void RemoveDocuments(ExecutionPolicy&& policy, std::span<const int> document_ids) {
+        std::vector<std::vector<int>> shard_document_ids(shards_.size());
+
+        for (const int document_id : document_ids) {
+            shard_document_ids[static_cast<size_t>(document_id) % shards_.size()].push_back(document_id);
+        }
+
+        shards_.front()->index.ForEachWorker(policy, shards_.size(), [&](size_t shard_index) {
+            shards_[shard_index]->index.RemoveDocuments(shard_document_ids[shard_index]);
+        });
+
+        std::lock_guard guard(documents_ids_mutex_);
+
+        for (const int document_id : document_ids) {
+            documents_ids_.erase(document_id);
+        }
+    }
+
+    // Compacts the shards one after another, so that only one of them is held twice in memory at a time. Each shard
+    // goes on serving reads while it is compacted and its writers wait for it, as with SearchServer::Compact.
+    void Compact();
+
+    std::set<int>::const_iterator begin() const;
+
+    std::set<int>::const_iterator end() const;
+
+private:
+    struct Shard {
+        template <typename StopWords>
+        explicit Shard(const StopWords& stop_words) : index(stop_words) {}
+
+        SearchServer index;
+    };
+
+private:
+    [[nodiscard]] Shard& GetShard(int document_id);
+
+    [[nodiscard]] const Shard& GetShard(int document_id) const;
+
+    // Weights of every shard's query.plus_terms computed by the given function of the corpus size and the document
+    // frequency, both of the whole corpus as seen by the given versions of the shards. Term ids are local to a shard,
+    // so terms are matched across shards by their text.
+    [[nodiscard]] std::vector<std::vector<double>> ComputeInverseDocumentFrequencies(
+        const std::vector<std::shared_ptr<const SearchServer::Version>>& versions,
+        const std::vector<SearchServer::Query>& queries,
+        double (*compute_inverse_document_frequency)(size_t, size_t)) const;
+
+    [[nodiscard]] static CorpusStatistics GetCorpusStatistics(
+        const std::vector<std::shared_ptr<const SearchServer::Version>>& versions);
+
+private:
+    std::vector<std::unique_ptr<Shard>> shards_;
+    std::set<int> documents_ids_;
+    mutable std::mutex documents_ids_mutex_;
+};
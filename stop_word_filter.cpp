@@ -0,0 +1,45 @@
+#include "stop_word_filter.h"
+
+StopWordFilter::StopWordFilter() : StopWordFilter(std::set<std::string>()) {}
+
+StopWordFilter::StopWordFilter(const std::set<std::string>& words) : words_(words.begin(), words.end()) {
+    // A failed build is unlikely at two slots per word; doubling the slots makes the next attempt easier still.
+    for (size_t slot_count = perfect_hash::GetSlotCount(words_.size());; slot_count *= 2) {
+        seeds_.resize(perfect_hash::GetBucketCount(words_.size()));
+        slots_.resize(slot_count);
+
+        if (perfect_hash::Build(words_, seeds_, slots_)) {
+            break;
+        }
+    }
+}
+
+[[nodiscard]] bool StopWordFilter::Contains(std::string_view word) const {
+    const uint32_t index = slots_[perfect_hash::FindSlot(word, seeds_, slots_.size())];
+
+    return index != perfect_hash::kEmptySlot && words_[index] == word;
+}
+
+[[nodiscard]] std::vector<std::string>::const_iterator StopWordFilter::begin() const { return words_.begin(); }
+
+[[nodiscard]] std::vector<std::string>::const_iterator StopWordFilter::end() const { return words_.end(); }
+
+[[nodiscard]] size_t StopWordFilter::size() const { return words_.size(); }
+
+[[nodiscard]] MemoryUsage StopWordFilter::GetMemoryUsage() const {
+    MemoryUsage usage{sizeof(StopWordFilter), 0, 1};
+
+    usage += ::GetMemoryUsage(words_);
+
+    for (const std::string& word : words_) {
+        const MemoryUsage word_usage = ::GetMemoryUsage(word);
+
+        usage.bytes += word_usage.bytes;
+        usage.allocation_count += word_usage.allocation_count;
+    }
+    usage += ::GetMemoryUsage(seeds_);
+    usage += ::GetMemoryUsage(slots_);
+    usage.object_count = words_.size();
+
+    return usage;
+}
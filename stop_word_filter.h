@@ -0,0 +1,180 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <numeric>
+#include <set>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "memory_stats.h"
+
+// Perfect hashing of a fixed set of words by hash and displace. Words are first hashed into buckets; then, largest
+// bucket first, every bucket gets the first seed under which the second hash of each of its words lands in a slot no
+// other word took. Testing a word costs two hashes and one comparison, and nothing is allocated.
+namespace perfect_hash {
+
+inline constexpr uint32_t kEmptySlot = std::numeric_limits<uint32_t>::max();
+inline constexpr uint32_t kMaxSeed = 1 << 16;
+
+// FNV-1a followed by the MurmurHash3 finalizer, which spreads the hash over the low bits the tables are indexed by.
+constexpr uint64_t Hash(std::string_view word, uint64_t seed) {
+    uint64_t hash = 0xCBF29CE484222325 ^ (seed * 0x9E3779B97F4A7C15);
+
+    for (const char c : word) {
+        hash = (hash ^ static_cast<unsigned char>(c)) * 0x100000001B3;
+    }
+    hash ^= hash >> 33;
+    hash *= 0xFF51AFD7ED558CCD;
+    hash ^= hash >> 33;
+    hash *= 0xC4CEB9FE1A85EC53;
+    hash ^= hash >> 33;
+
+    return hash;
+}
+
+// Both table sizes are powers of two. Twice as many slots as words keeps every bucket's seed search short.
+constexpr size_t GetSlotCount(size_t word_count) { return std::bit_ceil(std::max<size_t>(1, word_count * 2)); }
+
+constexpr size_t GetBucketCount(size_t word_count) { return std::bit_ceil(std::max<size_t>(1, word_count / 2)); }
+
+// Index of the slot the word would occupy if it were in the set.
+constexpr size_t FindSlot(std::string_view word, std::span<const uint32_t> seeds, size_t slot_count) {
+    const uint32_t seed = seeds[Hash(word, 0) & (seeds.size() - 1)];
+
+    return Hash(word, seed) & (slot_count - 1);
+}
+
+// Assigns every word a slot, writing the index of the word into it, and every bucket its seed. The words must be
+// distinct. Returns false if some bucket finds no seed, in which case the caller retries with more slots.
+template <typename Words>
+constexpr bool Build(const Words& words, std::span<uint32_t> seeds, std::span<uint32_t> slots) {
+    std::vector<std::vector<uint32_t>> buckets(seeds.size());
+
+    for (uint32_t i = 0; i < words.size(); ++i) {
+        buckets[Hash(words[i], 0) & (seeds.size() - 1)].push_back(i);
+    }
+    std::vector<uint32_t> bucket_order(buckets.size());
+
+    std::iota(bucket_order.begin(), bucket_order.end(), 0);
+    std::sort(bucket_order.begin(), bucket_order.end(),
+              [&buckets](uint32_t lhs, uint32_t rhs) { return buckets[lhs].size() > buckets[rhs].size(); });
+    std::fill(seeds.begin(), seeds.end(), 0);
+    std::fill(slots.begin(), slots.end(), kEmptySlot);
+
+    std::vector<size_t> bucket_slots;
+
+    for (const uint32_t bucket : bucket_order) {
+        if (buckets[bucket].empty()) {
+            break;
+        }
+
+        for (uint32_t seed = 1;; ++seed) {
+            if (seed > kMaxSeed) {
+                return false;
+            }
+            bucket_slots.clear();
+
+            for (const uint32_t word : buckets[bucket]) {
+                const size_t slot = Hash(words[word], seed) & (slots.size() - 1);
+
+                if (slots[slot] != kEmptySlot ||
+                    std::find(bucket_slots.begin(), bucket_slots.end(), slot) != bucket_slots.end()) {
+                    break;
+                }
+                bucket_slots.push_back(slot);
+            }
+
+            if (bucket_slots.size() == buckets[bucket].size()) {
+                for (size_t i = 0; i < bucket_slots.size(); ++i) {
+                    slots[bucket_slots[i]] = buckets[bucket][i];
+                }
+                seeds[bucket] = seed;
+                break;
+            }
+        }
+    }
+
+    return true;
+}
+
+}  // namespace perfect_hash
+
+// Set of stop words built once and tested against string_views without allocating. Words are kept sorted, so
+// iterating yields them in the same order as the set they were built from.
+class StopWordFilter {
+public:
+    StopWordFilter();
+
+    explicit StopWordFilter(const std::set<std::string>& words);
+
+public:
+    [[nodiscard]] bool Contains(std::string_view word) const;
+
+    [[nodiscard]] std::vector<std::string>::const_iterator begin() const;
+
+    [[nodiscard]] std::vector<std::string>::const_iterator end() const;
+
+    [[nodiscard]] size_t size() const;
+
+    // Objects are words.
+    [[nodiscard]] MemoryUsage GetMemoryUsage() const;
+
+private:
+    std::vector<std::string> words_;
+    std::vector<uint32_t> seeds_;
+    std::vector<uint32_t> slots_;
+};
+
+// The same filter over a list fixed at build time, built during compilation:
+//
+//     constexpr StaticStopWordFilter kStopWords(std::to_array<std::string_view>({"a", "in", "the"}));
+//     static_assert(kStopWords.Contains("the"));
+//
+// A list with empty or repeated words does not compile. SearchServer accepts the filter as its stop words.
+template <size_t N>
+class StaticStopWordFilter {
+public:
+    constexpr explicit StaticStopWordFilter(const std::array<std::string_view, N>& words) : words_(words) {
+        std::array<std::string_view, N> sorted_words = words;
+
+        std::sort(sorted_words.begin(), sorted_words.end());
+
+        if (std::find(sorted_words.begin(), sorted_words.end(), std::string_view()) != sorted_words.end() ||
+            std::adjacent_find(sorted_words.begin(), sorted_words.end()) != sorted_words.end()) {
+            throw std::invalid_argument("Stop words must be non-empty and distinct");
+        }
+
+        if (!perfect_hash::Build(words_, seeds_, slots_)) {
+            throw std::logic_error("No perfect hash found for the stop words");
+        }
+    }
+
+public:
+    [[nodiscard]] constexpr bool Contains(std::string_view word) const {
+        const uint32_t index = slots_[perfect_hash::FindSlot(word, seeds_, kSlotCount)];
+
+        return index != perfect_hash::kEmptySlot && words_[index] == word;
+    }
+
+    [[nodiscard]] constexpr auto begin() const { return words_.begin(); }
+
+    [[nodiscard]] constexpr auto end() const { return words_.end(); }
+
+    [[nodiscard]] constexpr size_t size() const { return N; }
+
+private:
+    static constexpr size_t kSlotCount = perfect_hash::GetSlotCount(N);
+
+private:
+    std::array<std::string_view, N> words_;
+    std::array<uint32_t, perfect_hash::GetBucketCount(N)> seeds_{};
+    std::array<uint32_t, kSlotCount> slots_{};
+};
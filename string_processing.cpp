@@ -1,45 +1,162 @@
 #include "string_processing.h"
 
-#include <string_view>
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <immintrin.h>
+
+#define STRING_PROCESSING_HAS_X86_SIMD
+#endif
 
 namespace string_processing {
 
-std::vector<std::string> SplitIntoWords(const std::string& text) {
-    std::vector<std::string> words;
-    std::string word;
-    for (const char c : text) {
-        if (c == ' ') {
-            if (!word.empty()) {
-                words.push_back(word);
-                word.clear();
+namespace {
+
+// Turns per-block masks of separator positions into words. A word may span blocks, so the start of the word being
+// scanned carries over from one block to the next.
+class WordCollector {
+public:
+    WordCollector(std::string_view text, std::vector<std::string_view>& words) : text_(text), words_(words) {}
+
+public:
+    // Bit i of separators is set if the byte at block_begin + i is a space; bits at and above width are ignored.
+    void AddBlock(size_t block_begin, uint32_t separators, size_t width) {
+        const uint32_t width_mask = width == 32 ? ~uint32_t{0} : (uint32_t{1} << width) - 1;
+        // Bit i is set where byte i differs in kind from the byte before it, that is where a word starts or ends.
+        uint32_t changes = (separators ^ ((separators << 1) | (is_in_word_ ? 0 : 1))) & width_mask;
+
+        while (changes != 0) {
+            const int bit = std::countr_zero(changes);
+            const size_t position = block_begin + bit;
+
+            if ((separators >> bit) & 1) {
+                words_.push_back(text_.substr(word_begin_, position - word_begin_));
+                is_in_word_ = false;
+            } else {
+                word_begin_ = position;
+                is_in_word_ = true;
             }
-        } else {
-            word += c;
+            changes &= changes - 1;
         }
     }
-    if (!word.empty()) {
-        words.push_back(word);
+
+    void Finish() {
+        if (is_in_word_) {
+            words_.push_back(text_.substr(word_begin_));
+        }
     }
-    return words;
-}
 
-std::vector<std::string_view> SplitIntoWordsView(std::string_view text) {
-    std::vector<std::string_view> result;
-    int64_t pos = 0;
-    const int64_t pos_end = text.npos;
-
-    while (true) {
-        int64_t space = text.find(' ', pos);
-        result.push_back(space == pos_end ? text.substr(pos) : text.substr(pos, space - pos));
-
-        if (space == pos_end) {
-            break;
-        } else {
-            pos = space + 1;
+private:
+    std::string_view text_;
+    std::vector<std::string_view>& words_;
+    size_t word_begin_ = 0;
+    bool is_in_word_ = false;
+};
+
+// Scans the text from begin on and returns whether it contains a control character.
+bool ScanScalar(std::string_view text, size_t begin, WordCollector& collector) {
+    bool has_control_character = false;
+
+    for (size_t block_begin = begin; block_begin < text.size(); block_begin += 32) {
+        const size_t width = std::min<size_t>(32, text.size() - block_begin);
+        uint32_t separators = 0;
+
+        for (size_t i = 0; i < width; ++i) {
+            const auto byte = static_cast<unsigned char>(text[block_begin + i]);
+
+            separators |= static_cast<uint32_t>(byte == ' ') << i;
+            has_control_character |= byte < ' ';
         }
+        collector.AddBlock(block_begin, separators, width);
     }
 
-    return result;
+    return has_control_character;
+}
+
+#ifdef STRING_PROCESSING_HAS_X86_SIMD
+
+// A byte is a control character if its unsigned minimum with ' ' - 1 is the byte itself.
+bool ScanSse2(std::string_view text, WordCollector& collector) {
+    const __m128i spaces = _mm_set1_epi8(' ');
+    const __m128i max_control_characters = _mm_set1_epi8(' ' - 1);
+    __m128i control_characters = _mm_setzero_si128();
+    size_t block_begin = 0;
+
+    for (; block_begin + 16 <= text.size(); block_begin += 16) {
+        const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text.data() + block_begin));
+
+        control_characters = _mm_or_si128(control_characters,
+                                          _mm_cmpeq_epi8(_mm_min_epu8(bytes, max_control_characters), bytes));
+        collector.AddBlock(block_begin, static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, spaces))), 16);
+    }
+    const bool has_control_character = _mm_movemask_epi8(control_characters) != 0;
+
+    return ScanScalar(text, block_begin, collector) || has_control_character;
+}
+
+__attribute__((target("avx2"))) bool ScanAvx2(std::string_view text, WordCollector& collector) {
+    const __m256i spaces = _mm256_set1_epi8(' ');
+    const __m256i max_control_characters = _mm256_set1_epi8(' ' - 1);
+    __m256i control_characters = _mm256_setzero_si256();
+    size_t block_begin = 0;
+
+    for (; block_begin + 32 <= text.size(); block_begin += 32) {
+        const __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(text.data() + block_begin));
+
+        control_characters = _mm256_or_si256(
+            control_characters, _mm256_cmpeq_epi8(_mm256_min_epu8(bytes, max_control_characters), bytes));
+        collector.AddBlock(block_begin,
+                           static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(bytes, spaces))), 32);
+    }
+    const bool has_control_character = _mm256_movemask_epi8(control_characters) != 0;
+
+    return ScanScalar(text, block_begin, collector) || has_control_character;
+}
+
+#endif
+
+using ScanFunction = bool (*)(std::string_view, WordCollector&);
+
+ScanFunction SelectScan() {
+#ifdef STRING_PROCESSING_HAS_X86_SIMD
+    __builtin_cpu_init();
+
+    return __builtin_cpu_supports("avx2") ? ScanAvx2 : ScanSse2;
+#else
+    return [](std::string_view text, WordCollector& collector) { return ScanScalar(text, 0, collector); };
+#endif
+}
+
+}  // namespace
+
+std::vector<std::string> SplitIntoWords(const std::string& text) {
+    const std::vector<std::string_view> word_views = SplitIntoWordsView(text);
+
+    return std::vector<std::string>(word_views.begin(), word_views.end());
+}
+
+std::vector<std::string_view> SplitIntoWordsView(std::string_view text) {
+    std::vector<std::string_view> words;
+
+    static_cast<void>(SplitIntoWordsView(text, words));
+
+    return words;
+}
+
+[[nodiscard]] bool SplitIntoWordsView(std::string_view text, std::vector<std::string_view>& words) {
+    static const ScanFunction scan = SelectScan();
+
+    words.clear();
+
+    WordCollector collector(text, words);
+    const bool has_control_character = scan(text, collector);
+
+    collector.Finish();
+
+    return !has_control_character;
 }
 
-}  // namespace string_processing
\ No newline at end of file
+}  // namespace string_processing
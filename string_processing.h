@@ -3,6 +3,7 @@
 #include <iostream>
 #include <set>
 #include <string>
+#include <string_view>
 #include <vector>
 
 namespace string_processing {
@@ -11,6 +12,11 @@ std::vector<std::string> SplitIntoWords(const std::string& text);
 
 std::vector<std::string_view> SplitIntoWordsView(std::string_view text);
 
+// Replaces the contents of words with views of the words of the text: the non-empty runs of bytes between spaces.
+// Returns false if the text contains a control character (a byte below ' '), which the same pass detects. The text
+// is scanned 32 or 16 bytes at a time with AVX2 or SSE2, whichever the CPU supports, and byte by byte elsewhere.
+[[nodiscard]] bool SplitIntoWordsView(std::string_view text, std::vector<std::string_view>& words);
+
 template <typename StringContainer>
 std::set<std::string> MakeUniqueNonEmptyStrings(const StringContainer& strings) {
     std::set<std::string> non_empty_strings;
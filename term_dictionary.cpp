@@ -0,0 +1,123 @@
+#include "term_dictionary.h"
+
+static_assert(TermDictionary::kNoTerm == ConcurrentHashIndex<std::string_view>::kNotFound);
+
+TermId TermDictionary::Intern(std::string_view term, Epoch& epoch) {
+    if (const TermId term_id = Find(term); term_id != kNoTerm) {
+        return term_id;
+    }
+
+    const std::string& owned_term = owned_terms_.emplace_back(term.begin(), term.end());
+
+    owned_term_usage_ += ::GetMemoryUsage(owned_term);
+    owned_term_indices_.push_back(static_cast<uint32_t>(owned_terms_.size() - 1));
+
+    return Add(owned_term, epoch);
+}
+
+TermId TermDictionary::InternExternal(std::string_view term, Epoch& epoch) {
+    if (const TermId term_id = Find(term); term_id != kNoTerm) {
+        return term_id;
+    }
+    owned_term_indices_.push_back(kNotOwned);
+
+    return Add(term, epoch);
+}
+
+void TermDictionary::AttachSortedTerms(std::span<const uint64_t> offsets, std::span<const char> characters) {
+    sorted_term_offsets_ = offsets;
+    sorted_term_characters_ = characters;
+    sorted_term_count_ = static_cast<TermId>(offsets.size() - 1);
+}
+
+[[nodiscard]] TermId TermDictionary::Find(std::string_view term) const {
+    const TermId term_id = term_ids_.Find(term, [this](TermId id) { return terms_[id]; });
+
+    if (term_id != kNoTerm) {
+        return sorted_term_count_ + term_id;
+    }
+
+    return FindSorted(term);
+}
+
+std::shared_ptr<const void> TermDictionary::Remove(TermId term_id) {
+    if (term_id < sorted_term_count_) {
+        return nullptr;
+    }
+    const TermId index = term_id - sorted_term_count_;
+
+    term_ids_.Erase(terms_[index], [this](TermId id) { return terms_[id]; });
+
+    if (owned_term_indices_[index] == kNotOwned) {
+        return nullptr;
+    }
+    std::string& owned_term = owned_terms_[owned_term_indices_[index]];
+    const MemoryUsage usage = ::GetMemoryUsage(owned_term);
+
+    // Characters of a short term are kept in the string object itself, which stays in place.
+    if (usage.allocation_count == 0) {
+        return nullptr;
+    }
+    auto memory = std::make_shared<const std::string>(std::move(owned_term));
+
+    owned_term_usage_ -= usage;
+    owned_term_usage_ += ::GetMemoryUsage(owned_term);
+
+    return memory;
+}
+
+[[nodiscard]] std::string_view TermDictionary::GetTerm(TermId term_id) const {
+    return term_id < sorted_term_count_ ? GetSortedTerm(term_id) : terms_[term_id - sorted_term_count_];
+}
+
+[[nodiscard]] size_t TermDictionary::size() const { return sorted_term_count_ + terms_.size(); }
+
+[[nodiscard]] MemoryUsage TermDictionary::GetMemoryUsage() const {
+    // The deque allocates the string objects in blocks of about kDequeBlockSize bytes.
+    static constexpr size_t kDequeBlockSize = 512;
+
+    MemoryUsage usage = terms_.GetMemoryUsage();
+    const size_t owned_term_object_bytes = owned_terms_.size() * sizeof(std::string);
+
+    usage += term_ids_.GetMemoryUsage();
+    usage += ::GetMemoryUsage(owned_term_indices_);
+    usage.bytes += owned_term_usage_.bytes + owned_term_object_bytes;
+    usage.allocation_count += owned_term_usage_.allocation_count + owned_term_object_bytes / kDequeBlockSize + 1;
+    usage.object_count = sorted_term_count_ + term_ids_.size();
+
+    return usage;
+}
+
+TermId TermDictionary::Add(std::string_view term, Epoch& epoch) {
+    const auto index = static_cast<TermId>(terms_.size());
+
+    // The view is stored before the id is published, so a concurrent Find never sees an id without its term.
+    terms_.push_back(term);
+    term_ids_.Insert(term, index, [this](TermId id) { return terms_[id]; }, epoch);
+
+    return sorted_term_count_ + index;
+}
+
+[[nodiscard]] std::string_view TermDictionary::GetSortedTerm(TermId term_id) const {
+    const uint64_t begin = sorted_term_offsets_[term_id];
+
+    return {sorted_term_characters_.data() + begin, sorted_term_offsets_[term_id + 1] - begin};
+}
+
+[[nodiscard]] TermId TermDictionary::FindSorted(std::string_view term) const {
+    TermId first = 0;
+    TermId count = sorted_term_count_;
+
+    while (count > 0) {
+        const TermId half = count / 2;
+
+        if (GetSortedTerm(first + half) < term) {
+            first += half + 1;
+            count -= half + 1;
+        } else {
+            count = half;
+        }
+    }
+
+    return first < sorted_term_count_ && GetSortedTerm(first) == term ? first : kNoTerm;
+}
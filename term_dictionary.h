@@ -0,0 +1,93 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <limits>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "chunked_vector.h"
+#include "concurrent_hash_index.h"
+#include "epoch.h"
+#include "memory_stats.h"
+
+using TermId = uint32_t;
+
+// Interns every distinct word once and assigns it a dense id. Interned strings are owned by the dictionary and never
+// move, so the views it hands out stay valid until the term is removed. Terms read from a memory-mapped index file
+// are not copied: the dictionary keeps views into the mapping instead, and the sorted table of a current file is not
+// even hashed, only searched in place.
+//
+// One thread may intern terms while others call Find and GetTerm: lookups take no lock and see every term whose
+// interning finished before the lookup started. Readers of an index version ignore ids the version does not cover.
+class TermDictionary {
+public:
+    static constexpr TermId kNoTerm = std::numeric_limits<TermId>::max();
+
+public:
+    TermDictionary() = default;
+
+    // Views handed out by a dictionary point into its own storage, so it can be moved but not copied.
+    TermDictionary(const TermDictionary&) = delete;
+    TermDictionary(TermDictionary&&) = default;
+
+    TermDictionary& operator=(const TermDictionary&) = delete;
+    TermDictionary& operator=(TermDictionary&&) = default;
+
+public:
+    // Lookup memory the dictionary outgrows is retired to the epoch.
+    TermId Intern(std::string_view term, Epoch& epoch);
+
+    // Adds a term whose characters are owned by the caller and outlive the dictionary.
+    TermId InternExternal(std::string_view term, Epoch& epoch);
+
+    // Makes the terms of a table the first ids of an empty dictionary, in table order. Term i is the characters from
+    // offsets[i] to offsets[i + 1]; terms must be distinct and ascending, and the table must outlive the dictionary.
+    // They are found by binary search, so attaching reads nothing of the table.
+    void AttachSortedTerms(std::span<const uint64_t> offsets, std::span<const char> characters);
+
+    [[nodiscard]] TermId Find(std::string_view term) const;
+
+    // Makes Find miss the term, so interning it again assigns a new id; the id itself is not reused, and the slot of
+    // its view stays, so the dictionary and anything indexed by term id grow with every term ever interned until the
+    // dictionary is rebuilt, as SearchServer::Compact does. Terms of the sorted table stay where they are and get their
+    // id back when interned again. Only the thread interning terms may call it. Lookups running meanwhile may still
+    // read the characters, so the memory holding them is handed back, if the dictionary owned any, to be released once
+    // those lookups are done.
+    [[nodiscard]] std::shared_ptr<const void> Remove(TermId term_id);
+
+    [[nodiscard]] std::string_view GetTerm(TermId term_id) const;
+
+    [[nodiscard]] size_t size() const;
+
+    // Only the thread interning terms may call it. Objects are terms not removed, including those viewed in a mapped
+    // file; those of the sorted table are all counted.
+    [[nodiscard]] MemoryUsage GetMemoryUsage() const;
+
+private:
+    TermId Add(std::string_view term, Epoch& epoch);
+
+    [[nodiscard]] std::string_view GetSortedTerm(TermId term_id) const;
+
+    [[nodiscard]] TermId FindSorted(std::string_view term) const;
+
+private:
+    static constexpr uint32_t kNotOwned = std::numeric_limits<uint32_t>::max();
+
+private:
+    std::span<const uint64_t> sorted_term_offsets_;
+    std::span<const char> sorted_term_characters_;
+    // Terms of the sorted table, which take the ids below this; the rest are stored and hashed below.
+    TermId sorted_term_count_ = 0;
+    std::deque<std::string> owned_terms_;
+    // Index of the string of every term after the sorted ones in owned_terms_, or kNotOwned for a term viewed in
+    // external memory.
+    std::vector<uint32_t> owned_term_indices_;
+    // Heap memory of the characters of owned terms, kept up to date as they are interned.
+    MemoryUsage owned_term_usage_;
+    ChunkedVector<std::string_view> terms_;
+    ConcurrentHashIndex<std::string_view> term_ids_;
+};
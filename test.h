@@ -103,4 +103,48 @@ void TestRemoveDuplicates();
 
 void TestParallelQueries();
 
+void TestRemoveDocument();
+
+void TestParallelSearchMatchesSequential();
+
+void TestTopDocumentCount();
+
+void TestShardedSearchServer();
+
+void TestAddDocuments();
+
+void TestSegmentedIndex();
+
+void TestSaveAndOpenIndexFile();
+
+void TestDurableSearchServer();
+
+void TestConcurrentReadersDuringWrites();
+
+void TestQueryCache();
+
+void TestThreadPool();
+
+void TestBatchQueries();
+
+void TestTokenizer();
+
+void TestStopWordFilter();
+
+void TestScoringModels();
+
+void TestDocumentStore();
+
+void TestMemoryStats();
+
+void TestMetrics();
+
+void TestDuplicateDetection();
+
+void TestCompact();
+
+void TestMatchDocuments();
+
+void TestRequestStatistics();
+
 void TestSearchServer();
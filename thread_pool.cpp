@@ -0,0 +1,148 @@
+#include "thread_pool.h"
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include <utility>
+
+namespace {
+
+// Pool and worker index of the current thread, if it is a pool worker.
+thread_local const ThreadPool* current_pool = nullptr;
+thread_local size_t current_worker_index = 0;
+
+}  // namespace
+
+ThreadPool::ThreadPool() : ThreadPool(Options{}) {}
+
+ThreadPool::ThreadPool(Options options) {
+    for (size_t i = 0; i < options.worker_count; ++i) {
+        workers_.push_back(std::make_unique<Worker>());
+    }
+
+    for (size_t i = 0; i < workers_.size(); ++i) {
+        workers_[i]->thread = std::thread([this, i] { RunWorker(i); });
+
+#ifdef __linux__
+        if (options.pin_workers) {
+            cpu_set_t cpus;
+            CPU_ZERO(&cpus);
+            CPU_SET(i % std::max(1u, std::thread::hardware_concurrency()), &cpus);
+            pthread_setaffinity_np(workers_[i]->thread.native_handle(), sizeof(cpus), &cpus);
+        }
+#endif
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard guard(sleep_mutex_);
+        is_stopping_ = true;
+    }
+    wake_condition_.notify_all();
+
+    for (const auto& worker : workers_) {
+        worker->thread.join();
+    }
+}
+
+[[nodiscard]] ThreadPool& ThreadPool::GetDefault() {
+    static ThreadPool thread_pool;
+
+    return thread_pool;
+}
+
+[[nodiscard]] size_t ThreadPool::GetWorkerCount() const { return workers_.size(); }
+
+void ThreadPool::RunLoop(Loop& loop) {
+    for (size_t index = loop.next_index.fetch_add(1); index < loop.count; index = loop.next_index.fetch_add(1)) {
+        if (!loop.has_failed.load(std::memory_order_relaxed)) {
+            try {
+                loop.body(index);
+            } catch (...) {
+                std::lock_guard guard(loop.mutex);
+
+                if (!loop.error) {
+                    loop.error = std::current_exception();
+                    loop.has_failed = true;
+                }
+            }
+        }
+
+        if (loop.done_count.fetch_add(1) + 1 == loop.count) {
+            std::lock_guard guard(loop.mutex);
+            loop.done_condition.notify_all();
+        }
+    }
+}
+
+void ThreadPool::Submit(std::function<void()> task) {
+    size_t worker_index = current_worker_index;
+
+    if (current_pool != this) {
+        std::lock_guard guard(sleep_mutex_);
+        worker_index = next_worker_++ % workers_.size();
+    }
+    {
+        Worker& worker = *workers_[worker_index];
+        std::lock_guard guard(worker.mutex);
+        worker.tasks.push_back(std::move(task));
+    }
+    {
+        std::lock_guard guard(sleep_mutex_);
+        ++queued_task_count_;
+    }
+    wake_condition_.notify_one();
+}
+
+void ThreadPool::RunWorker(size_t worker_index) {
+    current_pool = this;
+    current_worker_index = worker_index;
+
+    std::function<void()> task;
+
+    while (true) {
+        if (TryTakeTask(worker_index, task)) {
+            task();
+            task = nullptr;
+            continue;
+        }
+        std::unique_lock lock(sleep_mutex_);
+        wake_condition_.wait(lock, [this] { return is_stopping_ || queued_task_count_ > 0; });
+
+        if (is_stopping_ && queued_task_count_ == 0) {
+            return;
+        }
+    }
+}
+
+[[nodiscard]] bool ThreadPool::TryTakeTask(size_t worker_index, std::function<void()>& task) {
+    bool is_taken = false;
+
+    for (size_t i = 0; i < workers_.size() && !is_taken; ++i) {
+        Worker& worker = *workers_[(worker_index + i) % workers_.size()];
+        std::lock_guard guard(worker.mutex);
+
+        if (worker.tasks.empty()) {
+            continue;
+        }
+
+        if (i == 0) {
+            task = std::move(worker.tasks.back());
+            worker.tasks.pop_back();
+        } else {
+            task = std::move(worker.tasks.front());
+            worker.tasks.pop_front();
+        }
+        is_taken = true;
+    }
+
+    if (is_taken) {
+        std::lock_guard guard(sleep_mutex_);
+        --queued_task_count_;
+    }
+
+    return is_taken;
+}
@@ -0,0 +1,120 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads running the parallel parts of the search layer: batches of queries as well as the
+// parallel overloads of SearchServer. Every worker owns a task deque; it takes its own tasks from the back and, once
+// out of work, steals from the front of the others'. A task submitted from a worker goes to that worker's deque, so
+// parallel loops nested in pool tasks stay on the pool instead of spawning threads of their own.
+//
+// ParallelFor hands out indices one at a time from a shared counter, and the calling thread claims indices too. The
+// caller therefore never waits for a task nobody has started, so nested loops cannot deadlock however busy the pool
+// is, and uneven iterations balance themselves.
+class ThreadPool {
+public:
+    struct Options {
+        // Workers besides the threads calling ParallelFor.
+        size_t worker_count = std::max(1u, std::thread::hardware_concurrency()) - 1;
+        // Pins worker i to CPU i modulo the number of CPUs, where the platform supports it.
+        bool pin_workers = false;
+    };
+
+public:
+    ThreadPool();
+
+    explicit ThreadPool(Options options);
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    ~ThreadPool();
+
+public:
+    // Pool shared by everything not given one explicitly, created on first use with default options.
+    [[nodiscard]] static ThreadPool& GetDefault();
+
+    [[nodiscard]] size_t GetWorkerCount() const;
+
+    // Calls body(index) for every index below count and returns once all calls are done. The first exception thrown
+    // by a call is rethrown here after the others finish; indices not yet claimed by then are skipped.
+    template <typename Body>
+    void ParallelFor(size_t count, Body&& body) {
+        if (count == 0) {
+            return;
+        }
+
+        if (count == 1 || workers_.empty()) {
+            for (size_t index = 0; index < count; ++index) {
+                body(index);
+            }
+            return;
+        }
+        auto loop = std::make_shared<Loop>();
+
+        loop->count = count;
+        loop->body = [&body](size_t index) { body(index); };
+
+        // Helpers beyond the first count - 1 would find nothing left to claim.
+        for (size_t i = 0; i < std::min(count - 1, workers_.size()); ++i) {
+            Submit([loop] { RunLoop(*loop); });
+        }
+        RunLoop(*loop);
+
+        std::unique_lock lock(loop->mutex);
+        loop->done_condition.wait(lock, [&loop] { return loop->done_count.load() == loop->count; });
+
+        if (loop->error) {
+            std::rethrow_exception(loop->error);
+        }
+    }
+
+private:
+    // Shared state of one ParallelFor call. Helper tasks may start after the call returned, so they own it jointly
+    // with the caller; body is only called for claimed indices, which keeps the caller waiting.
+    struct Loop {
+        size_t count = 0;
+        std::function<void(size_t)> body;
+        std::atomic<size_t> next_index = 0;
+        std::atomic<size_t> done_count = 0;
+        std::atomic<bool> has_failed = false;
+        // Guards error and waiting for completion.
+        std::mutex mutex;
+        std::condition_variable done_condition;
+        std::exception_ptr error;
+    };
+
+    struct Worker {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+        std::thread thread;
+    };
+
+private:
+    static void RunLoop(Loop& loop);
+
+    void Submit(std::function<void()> task);
+
+    void RunWorker(size_t worker_index);
+
+    // Takes a task from the back of the worker's own deque or from the front of another one.
+    [[nodiscard]] bool TryTakeTask(size_t worker_index, std::function<void()>& task);
+
+private:
+    std::vector<std::unique_ptr<Worker>> workers_;
+    // Guards sleeping: workers wait on the condition while no task is queued anywhere.
+    std::mutex sleep_mutex_;
+    std::condition_variable wake_condition_;
+    size_t queued_task_count_ = 0;
+    size_t next_worker_ = 0;
+    bool is_stopping_ = false;
+};
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "memory_stats.h"
+
+// Bitmap of the deleted documents of a segment, indexed by ordinal offset from the start of the segment. Deleting a
+// document only sets its bit; its postings stay in the segment until a merge rewrites it.
+class Tombstones {
+public:
+    Tombstones() = default;
+
+public:
+    void Set(size_t offset) {
+        if (words_.size() <= offset / kWordBits) {
+            words_.resize(offset / kWordBits + 1, 0);
+        }
+        uint64_t& word = words_[offset / kWordBits];
+        const uint64_t mask = uint64_t{1} << (offset % kWordBits);
+
+        count_ += (word & mask) == 0 ? 1 : 0;
+        word |= mask;
+    }
+
+    [[nodiscard]] bool Contains(size_t offset) const {
+        return offset / kWordBits < words_.size() && (words_[offset / kWordBits] >> (offset % kWordBits) & 1) != 0;
+    }
+
+    // Calls visitor(offset) for every set bit in ascending order.
+    template <typename Visitor>
+    void ForEach(Visitor visitor) const {
+        for (size_t i = 0; i < words_.size(); ++i) {
+            for (uint64_t word = words_[i]; word != 0; word &= word - 1) {
+                visitor(i * kWordBits + static_cast<size_t>(std::countr_zero(word)));
+            }
+        }
+    }
+
+    [[nodiscard]] size_t count() const { return count_; }
+
+    [[nodiscard]] MemoryUsage GetMemoryUsage() const { return ::GetMemoryUsage(words_); }
+
+private:
+    static constexpr size_t kWordBits = 64;
+
+private:
+    std::vector<uint64_t> words_;
+    size_t count_ = 0;
+};
@@ -0,0 +1,51 @@
+#include "top_documents.h"
+
+#include <algorithm>
+#include <limits>
+#include <utility>
+
+TopDocuments::TopDocuments(size_t capacity) : capacity_(capacity) { heap_.reserve(capacity_); }
+
+void TopDocuments::Add(const Document& document) {
+    if (heap_.size() < capacity_) {
+        heap_.push_back(document);
+        std::push_heap(heap_.begin(), heap_.end(), IsMoreRelevant);
+        return;
+    }
+
+    if (capacity_ == 0 || !IsMoreRelevant(document, heap_.front())) {
+        return;
+    }
+    std::pop_heap(heap_.begin(), heap_.end(), IsMoreRelevant);
+    heap_.back() = document;
+    std::push_heap(heap_.begin(), heap_.end(), IsMoreRelevant);
+}
+
+void TopDocuments::Merge(const TopDocuments& other) {
+    capacity_ = std::max(capacity_, other.capacity_);
+
+    for (const Document& document : other.heap_) {
+        Add(document);
+    }
+}
+
+[[nodiscard]] bool TopDocuments::IsFull() const { return heap_.size() >= capacity_; }
+
+[[nodiscard]] double TopDocuments::GetMinCompetitiveRelevance() const {
+    if (!IsFull()) {
+        return -std::numeric_limits<double>::infinity();
+    }
+
+    return capacity_ == 0 ? std::numeric_limits<double>::infinity() : heap_.front().relevance - kRelevanceAccuracy;
+}
+
+[[nodiscard]] size_t TopDocuments::size() const { return heap_.size(); }
+
+[[nodiscard]] std::vector<Document> TopDocuments::ExtractSorted() {
+    std::sort_heap(heap_.begin(), heap_.end(), IsMoreRelevant);
+
+    std::vector<Document> documents = std::move(heap_);
+    heap_.clear();
+
+    return documents;
+}
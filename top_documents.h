@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "document.h"
+
+// Bounded selection of the most relevant documents. Documents are kept in a heap of at most `capacity` entries with
+// the least relevant one on top, so adding a candidate costs O(log K) and never grows memory past K.
+class TopDocuments {
+public:
+    explicit TopDocuments(size_t capacity = 0);
+
+public:
+    void Add(const Document& document);
+
+    void Merge(const TopDocuments& other);
+
+    [[nodiscard]] bool IsFull() const;
+
+    // Lowest relevance a new document needs to have a chance to enter the selection. Documents within
+    // kRelevanceAccuracy of the least relevant one still compete on rating.
+    [[nodiscard]] double GetMinCompetitiveRelevance() const;
+
+    [[nodiscard]] size_t size() const;
+
+    // Returns the selected documents ordered by IsMoreRelevant and leaves the selection empty.
+    [[nodiscard]] std::vector<Document> ExtractSorted();
+
+private:
+    size_t capacity_ = 0;
+    std::vector<Document> heap_;
+};
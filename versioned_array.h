@@ -0,0 +1,101 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include "memory_stats.h"
+
+#include "epoch.h"
+
+// Array modified by one writer and read through immutable views published with index versions. Values live in
+// fixed-size chunks. A view keeps pointers to the chunks as they were when it was published; the first modification
+// of a chunk after that copies it and retires the old copy to the epoch, where it stays until no reader can hold a
+// view of it. Publishing copies one pointer per chunk, and a modification copies at most one chunk.
+template <typename T>
+class VersionedArray {
+public:
+    class View {
+    public:
+        View() = default;
+
+    public:
+        const T& operator[](size_t index) const { return chunks_[index / kChunkSize][index % kChunkSize]; }
+
+        [[nodiscard]] size_t size() const { return size_; }
+
+    private:
+        friend class VersionedArray;
+
+        std::vector<const T*> chunks_;
+        size_t size_ = 0;
+    };
+
+public:
+    VersionedArray() = default;
+
+public:
+    // Appends value-initialized elements; shrinking is not supported.
+    void resize(size_t size) {
+        while (chunks_.size() * kChunkSize < size) {
+            chunks_.push_back(std::make_shared<T[]>(kChunkSize));
+            is_published_.push_back(false);
+        }
+        size_ = std::max(size_, size);
+    }
+
+    T& GetMutable(size_t index, Epoch& epoch) {
+        const size_t chunk = index / kChunkSize;
+
+        if (is_published_[chunk]) {
+            auto copy = std::make_shared<T[]>(kChunkSize);
+
+            std::copy(chunks_[chunk].get(), chunks_[chunk].get() + kChunkSize, copy.get());
+            epoch.Retire(std::move(chunks_[chunk]));
+            chunks_[chunk] = std::move(copy);
+            is_published_[chunk] = false;
+        }
+
+        return chunks_[chunk][index % kChunkSize];
+    }
+
+    const T& operator[](size_t index) const { return chunks_[index / kChunkSize][index % kChunkSize]; }
+
+    [[nodiscard]] size_t size() const { return size_; }
+
+    // Current chunks only: copies retired to the epoch are released as readers move on.
+    [[nodiscard]] MemoryUsage GetMemoryUsage() const {
+        MemoryUsage usage = ::GetMemoryUsage(chunks_);
+
+        usage.bytes += chunks_.size() * kChunkSize * sizeof(T) + is_published_.capacity() / 8;
+        usage.object_count = size_;
+        usage.allocation_count += chunks_.size() + (is_published_.capacity() > 0 ? 1 : 0);
+
+        return usage;
+    }
+
+    // The returned view stays valid while the chunks it points to are not released: until the epoch the next
+    // modifications retire them to is released.
+    [[nodiscard]] View Publish() {
+        View view;
+
+        view.chunks_.reserve(chunks_.size());
+
+        for (const std::shared_ptr<T[]>& chunk : chunks_) {
+            view.chunks_.push_back(chunk.get());
+        }
+        view.size_ = size_;
+        std::fill(is_published_.begin(), is_published_.end(), true);
+
+        return view;
+    }
+
+private:
+    static constexpr size_t kChunkSize = 1024;
+
+private:
+    std::vector<std::shared_ptr<T[]>> chunks_;
+    std::vector<bool> is_published_;
+    size_t size_ = 0;
+};